@@ -0,0 +1,148 @@
+#include "Benchmark.h"
+
+#include "Controllers.h"
+#include "FrameTimeline.h"
+#include "Renderer.h"
+#include "Util.h"
+
+#include <fstream>
+
+namespace
+{
+constexpr const char* resultsFilename = "benchmark.csv";
+constexpr size_t minFramesInFlightCount = 1u, maxFramesInFlightCount = 4u;
+constexpr size_t warmupFrameCount = 90u; // Skipped after every change so that the pipeline can settle
+constexpr size_t measuredFrameCount = 900u;
+
+double toSeconds(std::chrono::high_resolution_clock::duration duration)
+{
+  return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) / 1e9;
+}
+} // namespace
+
+Benchmark::Benchmark(Renderer* renderer, const Controllers* controllers) : renderer(renderer), controllers(controllers)
+{
+  for (size_t framesInFlightCount = minFramesInFlightCount; framesInFlightCount <= maxFramesInFlightCount;
+       ++framesInFlightCount)
+  {
+    Result result;
+    result.framesInFlightCount = framesInFlightCount;
+    results.push_back(result);
+  }
+
+  if (!renderer->setFramesInFlightCount(results.front().framesInFlightCount))
+  {
+    valid = false;
+    return;
+  }
+
+  previousFrameEndTime = Clock::now();
+}
+
+void Benchmark::beginFrame()
+{
+  frameStartTime = Clock::now();
+
+  // Record the latency of all frames that have completed since the last check
+  const uint64_t completedFrame = renderer->getFrameTimeline()->getCompletedFrame();
+  while (!pendingFrames.empty() && pendingFrames.front().frame <= completedFrame)
+  {
+    Result& result = results.at(resultIndex);
+    result.latency += toSeconds(frameStartTime - pendingFrames.front().startTime);
+    ++result.latencySampleCount;
+    pendingFrames.pop_front();
+  }
+}
+
+bool Benchmark::endFrame()
+{
+  if (isFinished())
+  {
+    return true;
+  }
+
+  const Clock::time_point frameEndTime = Clock::now();
+
+  if (frameIndex >= warmupFrameCount)
+  {
+    Result& result = results.at(resultIndex);
+    result.frameDuration += toSeconds(frameEndTime - previousFrameEndTime);
+    result.waitDuration += static_cast<double>(renderer->getWaitDuration());
+    result.visibleDrawCount += static_cast<double>(renderer->getVisibleDrawCount());
+    result.uniformBytesWritten += static_cast<double>(renderer->getUniformBytesWritten());
+    result.syncCallCount += static_cast<double>(controllers->getSyncCallCount());
+    result.locateCallCount += static_cast<double>(controllers->getLocateCallCount());
+    ++result.frameCount;
+
+    pendingFrames.push_back({ renderer->getFrameTimeline()->getLastFrame(), frameStartTime });
+  }
+
+  ++frameIndex;
+  previousFrameEndTime = frameEndTime;
+
+  if (frameIndex < warmupFrameCount + measuredFrameCount)
+  {
+    return true;
+  }
+
+  // Move on to the next number of frames in flight, frames that are still pending are not counted as the renderer syncs
+  // when the number changes
+  pendingFrames.clear();
+  frameIndex = 0u;
+  ++resultIndex;
+
+  if (isFinished())
+  {
+    return writeResults();
+  }
+
+  if (!renderer->setFramesInFlightCount(results.at(resultIndex).framesInFlightCount))
+  {
+    return false;
+  }
+
+  previousFrameEndTime = Clock::now();
+  return true;
+}
+
+bool Benchmark::isFinished() const
+{
+  return resultIndex >= results.size();
+}
+
+bool Benchmark::isValid() const
+{
+  return valid;
+}
+
+bool Benchmark::writeResults() const
+{
+  std::ofstream file(resultsFilename);
+  if (!file.is_open())
+  {
+    util::error(Error::FileWriteFailure, resultsFilename);
+    return false;
+  }
+
+  file << "Frames in flight,CPU frame time (ms),CPU wait time (ms),CPU/GPU overlap (%),Latency (ms),Visible draws,"
+          "Uniform bytes written,OpenXR sync calls,OpenXR locate calls\n";
+  for (const Result& result : results)
+  {
+    const double frameCount = static_cast<double>(result.frameCount);
+    const double frameDuration = result.frameDuration / frameCount;
+    const double waitDuration = result.waitDuration / frameCount;
+    const double overlap = frameDuration > 0.0 ? 1.0 - waitDuration / frameDuration : 0.0;
+    const double latency =
+      result.latencySampleCount > 0u ? result.latency / static_cast<double>(result.latencySampleCount) : 0.0;
+    const double visibleDrawCount = result.visibleDrawCount / frameCount;
+    const double uniformBytesWritten = result.uniformBytesWritten / frameCount;
+    const double syncCallCount = result.syncCallCount / frameCount;
+    const double locateCallCount = result.locateCallCount / frameCount;
+
+    file << result.framesInFlightCount << "," << frameDuration * 1e3 << "," << waitDuration * 1e3 << ","
+         << overlap * 1e2 << "," << latency * 1e3 << "," << visibleDrawCount << "," << uniformBytesWritten << ","
+         << syncCallCount << "," << locateCallCount << "\n";
+  }
+
+  return true;
+}
\ No newline at end of file
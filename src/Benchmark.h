@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class Controllers;
+class Renderer;
+
+/*
+ * The benchmark class sweeps the number of frames in flight of the renderer and records for each value how much the CPU
+ * overlaps with the GPU against how much latency the additional frames add. The overlap is the share of the CPU frame
+ * time that is not spent waiting for a free render process. The latency is the time from the start of recording a frame
+ * until its completion on the frame timeline is observed, which happens once per frame so it is rounded up to the next
+ * frame. The number of draws that survived culling on the GPU is recorded along with it, as it affects the GPU frame
+ * time, and so is the number of bytes written into mapped memory for the per-frame constants, which grows with every
+ * render process that has to catch up on the world matrices. The number of OpenXR calls it takes to sync the controller
+ * actions and to late latch the controllers is recorded as well, as these calls are made on the simulation and render
+ * threads every frame. The results are written to a CSV file once the sweep is complete.
+ */
+class Benchmark final
+{
+public:
+  Benchmark(Renderer* renderer, const Controllers* controllers);
+
+  void beginFrame(); // Call right before rendering
+  bool endFrame();   // Call once the frame has been ended but before the next one begins, returns false on error
+  bool isFinished() const;
+
+  bool isValid() const;
+
+private:
+  using Clock = std::chrono::high_resolution_clock;
+
+  bool valid = true;
+
+  Renderer* renderer = nullptr;
+  const Controllers* controllers = nullptr;
+
+  struct Result
+  {
+    size_t framesInFlightCount = 0u;
+    size_t frameCount = 0u, latencySampleCount = 0u;
+    double frameDuration = 0.0, waitDuration = 0.0, latency = 0.0; // Accumulated, in seconds
+    double visibleDrawCount = 0.0, uniformBytesWritten = 0.0;       // Accumulated
+    double syncCallCount = 0.0, locateCallCount = 0.0;              // Accumulated, in OpenXR calls
+  };
+  std::vector<Result> results;
+  size_t resultIndex = 0u, frameIndex = 0u;
+
+  struct PendingFrame
+  {
+    uint64_t frame = 0u;
+    Clock::time_point startTime;
+  };
+  std::deque<PendingFrame> pendingFrames;
+  Clock::time_point frameStartTime, previousFrameEndTime;
+
+  bool writeResults() const;
+};
\ No newline at end of file
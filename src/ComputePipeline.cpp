@@ -0,0 +1,64 @@
+#include "ComputePipeline.h"
+
+#include "Context.h"
+#include "Util.h"
+
+#include <sstream>
+
+ComputePipeline::ComputePipeline(const Context* context,
+                                 VkPipelineLayout pipelineLayout,
+                                 const std::string& computeFilename)
+: context(context)
+{
+  const VkDevice device = context->getVkDevice();
+
+  // Load the compute shader
+  VkShaderModule computeShaderModule;
+  if (!util::loadShaderFromFile(device, computeFilename, computeShaderModule))
+  {
+    std::stringstream s;
+    s << "Compute shader \"" << computeFilename << "\"";
+    util::error(Error::FileMissing, s.str());
+    valid = false;
+    return;
+  }
+
+  VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfoCompute{
+    VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO
+  };
+  pipelineShaderStageCreateInfoCompute.module = computeShaderModule;
+  pipelineShaderStageCreateInfoCompute.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineShaderStageCreateInfoCompute.pName = "main";
+
+  VkComputePipelineCreateInfo computePipelineCreateInfo{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+  computePipelineCreateInfo.layout = pipelineLayout;
+  computePipelineCreateInfo.stage = pipelineShaderStageCreateInfoCompute;
+  if (vkCreateComputePipelines(device, nullptr, 1u, &computePipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
+  }
+
+  // This shader module can now be destroyed
+  vkDestroyShaderModule(device, computeShaderModule, nullptr);
+}
+
+ComputePipeline::~ComputePipeline()
+{
+  const VkDevice device = context->getVkDevice();
+  if (device && pipeline)
+  {
+    vkDestroyPipeline(device, pipeline, nullptr);
+  }
+}
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer) const
+{
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+}
+
+bool ComputePipeline::isValid() const
+{
+  return valid;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+
+class Context;
+
+/*
+ * The compute pipeline class wraps a Vulkan compute pipeline for convenience. Unlike the pipeline class it does not
+ * describe a rendering technique, but a single compute shader that prepares work for the GPU, such as culling models
+ * before they are drawn.
+ */
+class ComputePipeline final
+{
+public:
+  ComputePipeline(const Context* context, VkPipelineLayout pipelineLayout, const std::string& computeFilename);
+  ~ComputePipeline();
+
+  void bind(VkCommandBuffer commandBuffer) const;
+
+  bool isValid() const;
+
+private:
+  bool valid = true;
+
+  const Context* context = nullptr;
+  VkPipeline pipeline = nullptr;
+};
\ No newline at end of file
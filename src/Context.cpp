@@ -4,6 +4,7 @@
 
 #include <glfw/glfw3.h>
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <sstream>
@@ -12,9 +13,28 @@
   #include <iostream>
 #endif
 
+#ifdef _WIN32
+  #define NOMINMAX
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <ctime>
+#endif
+
 namespace
 {
-constexpr XrViewConfigurationType viewType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+#ifdef _WIN32
+constexpr const char* convertTimeExtensionName = "XR_KHR_win32_convert_performance_counter_time";
+constexpr const char* convertTimeFunctionName = "xrConvertWin32PerformanceCounterToTimeKHR";
+using ConvertTimeFunction = XrResult(XRAPI_PTR*)(XrInstance instance, const LARGE_INTEGER* counter, XrTime* time);
+#else
+constexpr const char* convertTimeExtensionName = "XR_KHR_convert_timespec_time";
+constexpr const char* convertTimeFunctionName = "xrConvertTimespecTimeToTimeKHR";
+using ConvertTimeFunction = XrResult(XRAPI_PTR*)(XrInstance instance, const timespec* timespecTime, XrTime* time);
+#endif
+
+constexpr uint32_t preferredFragmentDensityTexelSize = 16u; // In pixels, along both axes
+
 constexpr XrEnvironmentBlendMode environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
 
 const std::string applicationName = "OpenXR Vulkan Example";
@@ -77,6 +97,33 @@ Context::Context()
 
     std::vector<const char*> extensions = { XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME };
 
+    // Add the optional OpenXR instance extensions if available, one to locate many spaces in a single call, which is
+    // core in OpenXR 1.1, one to query the current time in the OpenXR time domain, one for headsets that render a
+    // high resolution inset view for each eye in addition to the regular stereo views, one to query the area of each
+    // eye that cannot be seen through the lenses, and one to track where the user is looking
+    const std::array optionalExtensions = { XR_KHR_LOCATE_SPACES_EXTENSION_NAME, convertTimeExtensionName,
+                                            XR_VARJO_QUAD_VIEWS_EXTENSION_NAME, XR_KHR_VISIBILITY_MASK_EXTENSION_NAME,
+                                            XR_EXT_EYE_GAZE_INTERACTION_EXTENSION_NAME };
+    for (const char* extension : optionalExtensions)
+    {
+      for (const XrExtensionProperties& supportedExtension : supportedOpenXRInstanceExtensions)
+      {
+        if (strcmp(extension, supportedExtension.extensionName) == 0)
+        {
+          extensions.push_back(extension);
+          if (strcmp(extension, XR_VARJO_QUAD_VIEWS_EXTENSION_NAME) == 0)
+          {
+            quadViewsSupported = true;
+          }
+          else if (strcmp(extension, XR_EXT_EYE_GAZE_INTERACTION_EXTENSION_NAME) == 0)
+          {
+            eyeGazeSupported = true; // Until the system says otherwise
+          }
+          break;
+        }
+      }
+    }
+
 #ifdef DEBUG
     // Add the OpenXR debug instance extension
     extensions.push_back(XR_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -151,6 +198,24 @@ Context::Context()
     return;
   }
 
+  // Load the optional OpenXR extension functions, they are only present if their extensions have been enabled
+  if (!util::loadXrExtensionFunction(xrInstance, "xrLocateSpacesKHR",
+                                     reinterpret_cast<PFN_xrVoidFunction*>(&xrLocateSpacesKHR)))
+  {
+    xrLocateSpacesKHR = nullptr; // Locate the spaces one by one instead
+  }
+
+  if (!util::loadXrExtensionFunction(xrInstance, convertTimeFunctionName, &xrConvertTimeKHR))
+  {
+    xrConvertTimeKHR = nullptr; // The current time cannot be queried
+  }
+
+  if (!util::loadXrExtensionFunction(xrInstance, "xrGetVisibilityMaskKHR",
+                                     reinterpret_cast<PFN_xrVoidFunction*>(&xrGetVisibilityMaskKHR)))
+  {
+    xrGetVisibilityMaskKHR = nullptr; // Render the whole image of each eye
+  }
+
 #ifdef DEBUG
   // Create an OpenXR debug utils messenger for validation
   {
@@ -216,6 +281,74 @@ Context::Context()
     return;
   }
 
+  // Check whether the system can actually track the eyes, the extension alone does not guarantee it
+  if (eyeGazeSupported)
+  {
+    XrSystemEyeGazeInteractionPropertiesEXT eyeGazeInteractionProperties{
+      XR_TYPE_SYSTEM_EYE_GAZE_INTERACTION_PROPERTIES_EXT
+    };
+    XrSystemProperties systemProperties{ XR_TYPE_SYSTEM_PROPERTIES };
+    systemProperties.next = &eyeGazeInteractionProperties;
+    result = xrGetSystemProperties(xrInstance, systemId, &systemProperties);
+    if (XR_FAILED(result))
+    {
+      util::error(Error::GenericOpenXR);
+      valid = false;
+      return;
+    }
+
+    eyeGazeSupported = (eyeGazeInteractionProperties.supportsEyeGazeInteraction == XR_TRUE);
+  }
+
+  // Pick the view configuration, quad views are preferred if the system supports them and stereo is required otherwise
+  {
+    uint32_t viewTypeCount;
+    result = xrEnumerateViewConfigurations(xrInstance, systemId, 0u, &viewTypeCount, nullptr);
+    if (XR_FAILED(result))
+    {
+      util::error(Error::GenericOpenXR);
+      valid = false;
+      return;
+    }
+
+    std::vector<XrViewConfigurationType> supportedViewTypes(viewTypeCount);
+    result = xrEnumerateViewConfigurations(xrInstance, systemId, viewTypeCount, &viewTypeCount,
+                                           supportedViewTypes.data());
+    if (XR_FAILED(result))
+    {
+      util::error(Error::GenericOpenXR);
+      valid = false;
+      return;
+    }
+
+    bool stereoFound = false;
+    for (const XrViewConfigurationType& supportedViewType : supportedViewTypes)
+    {
+      if (quadViewsSupported && supportedViewType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO)
+      {
+        viewType = supportedViewType;
+        break;
+      }
+
+      if (supportedViewType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO)
+      {
+        stereoFound = true;
+      }
+    }
+
+    if (viewType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO)
+    {
+      if (!stereoFound)
+      {
+        util::error(Error::FeatureNotSupported, "OpenXR stereo view configuration");
+        valid = false;
+        return;
+      }
+
+      viewType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+    }
+  }
+
   // Check the supported environment blend modes
   {
     uint32_t environmentBlendModeCount;
@@ -545,6 +678,10 @@ bool Context::createDevice(VkSurfaceKHR mirrorSurface)
       {
         drawQueueFamilyIndex = static_cast<uint32_t>(queueFamilyIndexCandidate);
         drawQueueFamilyIndexFound = true;
+
+        // Timestamps wrap around after the valid bits, a queue family without any can't write them at all
+        const uint32_t timestampValidBits = queueFamilyCandidate.timestampValidBits;
+        timestampMask = (timestampValidBits >= 64u) ? ~uint64_t(0u) : (uint64_t(1u) << timestampValidBits) - 1u;
         break;
       }
     }
@@ -556,7 +693,9 @@ bool Context::createDevice(VkSurfaceKHR mirrorSurface)
     }
   }
 
-  // Pick the present queue family index
+  // Pick the present queue family index, without a mirror view window the draw queue family is used
+  presentQueueFamilyIndex = drawQueueFamilyIndex;
+  if (mirrorSurface)
   {
     // Retrieve the queue families
     std::vector<VkQueueFamilyProperties> queueFamilies;
@@ -621,7 +760,48 @@ bool Context::createDevice(VkSurfaceKHR mirrorSurface)
   }
 
   // Require the swapchain extension for the mirror view
-  constexpr std::array vulkanDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+  std::vector<const char*> vulkanDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+
+  // Enable the external memory and semaphore file descriptor extensions if available, they are only needed to export
+  // the mirror image to a viewer process
+  {
+    constexpr std::array mirrorExportExtensions = { VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+                                                    VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME };
+
+    mirrorExportSupported = true;
+    for (const char* extension : mirrorExportExtensions)
+    {
+      bool extensionSupported = false;
+      for (const VkExtensionProperties& supportedExtension : supportedVulkanDeviceExtensions)
+      {
+        if (strcmp(extension, supportedExtension.extensionName) == 0)
+        {
+          extensionSupported = true;
+          break;
+        }
+      }
+
+      mirrorExportSupported = mirrorExportSupported && extensionSupported;
+    }
+
+    if (mirrorExportSupported)
+    {
+      vulkanDeviceExtensions.insert(vulkanDeviceExtensions.end(), mirrorExportExtensions.begin(),
+                                    mirrorExportExtensions.end());
+    }
+  }
+
+  // Enable the fragment density map extension if available, it is only needed to render the headset views foveated
+  {
+    for (const VkExtensionProperties& supportedExtension : supportedVulkanDeviceExtensions)
+    {
+      if (strcmp(VK_EXT_FRAGMENT_DENSITY_MAP_EXTENSION_NAME, supportedExtension.extensionName) == 0)
+      {
+        foveationSupported = true; // Until the features say otherwise
+        break;
+      }
+    }
+  }
 
   // Check that all Vulkan device extensions are supported
   {
@@ -650,9 +830,42 @@ bool Context::createDevice(VkSurfaceKHR mirrorSurface)
   // Create a device
   {
     // Retrieve the physical device properties
-    VkPhysicalDeviceProperties physicalDeviceProperties;
-    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+    VkPhysicalDeviceVulkan11Properties physicalDeviceVulkan11Properties{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_PROPERTIES
+    };
+    VkPhysicalDeviceFragmentDensityMapPropertiesEXT physicalDeviceFragmentDensityMapProperties{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_PROPERTIES_EXT
+    };
+    VkPhysicalDeviceProperties2 physicalDeviceProperties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+    physicalDeviceProperties2.pNext = &physicalDeviceVulkan11Properties;
+    if (foveationSupported)
+    {
+      physicalDeviceVulkan11Properties.pNext = &physicalDeviceFragmentDensityMapProperties;
+    }
+    vkGetPhysicalDeviceProperties2(physicalDevice, &physicalDeviceProperties2);
+    const VkPhysicalDeviceProperties& physicalDeviceProperties = physicalDeviceProperties2.properties;
+    maxMultiviewViewCount = physicalDeviceVulkan11Properties.maxMultiviewViewCount;
+
+    // Prefer a density map texel that covers 16x16 pixels, which is fine enough for the foveal regions
+    if (foveationSupported)
+    {
+      const VkExtent2D& minTexelSize = physicalDeviceFragmentDensityMapProperties.minFragmentDensityTexelSize;
+      const VkExtent2D& maxTexelSize = physicalDeviceFragmentDensityMapProperties.maxFragmentDensityTexelSize;
+      fragmentDensityTexelSize.width = std::clamp(preferredFragmentDensityTexelSize, minTexelSize.width,
+                                                  maxTexelSize.width);
+      fragmentDensityTexelSize.height = std::clamp(preferredFragmentDensityTexelSize, minTexelSize.height,
+                                                   maxTexelSize.height);
+    }
+
     uniformBufferOffsetAlignment = physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+    maxStorageBufferRange = static_cast<VkDeviceSize>(physicalDeviceProperties.limits.maxStorageBufferRange);
+
+    // Timestamps are only used to measure the GPU frame cost, so they are optional, the draw queue can support them
+    // even if not all graphics and compute queues do
+    if (timestampMask != 0u)
+    {
+      timestampPeriod = physicalDeviceProperties.limits.timestampPeriod;
+    }
 
     // Determine the best supported multisample count, up to 4x MSAA
     const VkSampleCountFlags sampleCountFlags = physicalDeviceProperties.limits.framebufferColorSampleCounts &
@@ -675,11 +888,34 @@ bool Context::createDevice(VkSurfaceKHR mirrorSurface)
       return false;
     }
 
+    if (!physicalDeviceFeatures.multiDrawIndirect)
+    {
+      util::error(Error::FeatureNotSupported, "Vulkan physical device feature \"multiDrawIndirect\"");
+      return false;
+    }
+
+    if (!physicalDeviceFeatures.drawIndirectFirstInstance)
+    {
+      util::error(Error::FeatureNotSupported, "Vulkan physical device feature \"drawIndirectFirstInstance\"");
+      return false;
+    }
+
     VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
     VkPhysicalDeviceMultiviewFeatures physicalDeviceMultiviewFeatures{
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES
     };
+    VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+    };
+    VkPhysicalDeviceFragmentDensityMapFeaturesEXT physicalDeviceFragmentDensityMapFeatures{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_FEATURES_EXT
+    };
     physicalDeviceFeatures2.pNext = &physicalDeviceMultiviewFeatures;
+    physicalDeviceMultiviewFeatures.pNext = &physicalDeviceVulkan12Features;
+    if (foveationSupported)
+    {
+      physicalDeviceVulkan12Features.pNext = &physicalDeviceFragmentDensityMapFeatures;
+    }
     vkGetPhysicalDeviceFeatures2(physicalDevice, &physicalDeviceFeatures2);
     if (!physicalDeviceMultiviewFeatures.multiview)
     {
@@ -687,8 +923,36 @@ bool Context::createDevice(VkSurfaceKHR mirrorSurface)
       return false;
     }
 
+    if (!physicalDeviceVulkan12Features.drawIndirectCount)
+    {
+      util::error(Error::FeatureNotSupported, "Vulkan physical device feature \"drawIndirectCount\"");
+      return false;
+    }
+
+    if (!physicalDeviceVulkan12Features.timelineSemaphore)
+    {
+      util::error(Error::FeatureNotSupported, "Vulkan physical device feature \"timelineSemaphore\"");
+      return false;
+    }
+
     physicalDeviceFeatures.shaderStorageImageMultisample = VK_TRUE; // Needed for some OpenXR implementations
+    physicalDeviceFeatures.multiDrawIndirect = VK_TRUE;             // Needed for indirect drawing
+    physicalDeviceFeatures.drawIndirectFirstInstance = VK_TRUE;     // Needed to index per-draw data
     physicalDeviceMultiviewFeatures.multiview = VK_TRUE;            // Needed for stereo rendering
+    physicalDeviceVulkan12Features.drawIndirectCount = VK_TRUE;     // Needed for GPU culling
+    physicalDeviceVulkan12Features.timelineSemaphore = VK_TRUE;     // Needed for frame synchronization
+
+    // Foveated rendering also needs to write to the regular images that the runtime provides for the swapchain
+    foveationSupported = foveationSupported && physicalDeviceFragmentDensityMapFeatures.fragmentDensityMap &&
+                         physicalDeviceFragmentDensityMapFeatures.fragmentDensityMapNonSubsampledImages;
+    if (foveationSupported)
+    {
+      vulkanDeviceExtensions.push_back(VK_EXT_FRAGMENT_DENSITY_MAP_EXTENSION_NAME);
+    }
+    else
+    {
+      physicalDeviceVulkan12Features.pNext = nullptr;
+    }
 
     constexpr float queuePriority = 1.0f;
 
@@ -813,6 +1077,48 @@ XrSystemId Context::getXrSystemId() const
   return systemId;
 }
 
+PFN_xrLocateSpacesKHR Context::getXrLocateSpacesFunction() const
+{
+  return xrLocateSpacesKHR;
+}
+
+PFN_xrGetVisibilityMaskKHR Context::getXrGetVisibilityMaskFunction() const
+{
+  return xrGetVisibilityMaskKHR;
+}
+
+bool Context::isEyeGazeSupported() const
+{
+  return eyeGazeSupported;
+}
+
+bool Context::getCurrentXrTime(XrTime& time) const
+{
+  if (!xrConvertTimeKHR)
+  {
+    return false;
+  }
+
+  const ConvertTimeFunction convertTime = reinterpret_cast<ConvertTimeFunction>(xrConvertTimeKHR);
+
+#ifdef _WIN32
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  const XrResult result = convertTime(xrInstance, &counter, &time);
+#else
+  timespec timespecTime;
+  clock_gettime(CLOCK_MONOTONIC, &timespecTime);
+  const XrResult result = convertTime(xrInstance, &timespecTime, &time);
+#endif
+
+  if (XR_FAILED(result))
+  {
+    return false;
+  }
+
+  return true;
+}
+
 VkInstance Context::getVkInstance() const
 {
   return vkInstance;
@@ -848,6 +1154,41 @@ VkDeviceSize Context::getUniformBufferOffsetAlignment() const
   return uniformBufferOffsetAlignment;
 }
 
+VkDeviceSize Context::getMaxStorageBufferRange() const
+{
+  return maxStorageBufferRange;
+}
+
+float Context::getTimestampPeriod() const
+{
+  return timestampPeriod;
+}
+
+uint64_t Context::getTimestampMask() const
+{
+  return timestampMask;
+}
+
+uint32_t Context::getMaxMultiviewViewCount() const
+{
+  return maxMultiviewViewCount;
+}
+
+bool Context::isMirrorExportSupported() const
+{
+  return mirrorExportSupported;
+}
+
+bool Context::isFoveationSupported() const
+{
+  return foveationSupported;
+}
+
+VkExtent2D Context::getFragmentDensityTexelSize() const
+{
+  return fragmentDensityTexelSize;
+}
+
 VkSampleCountFlagBits Context::getMultisampleCount() const
 {
   return multisampleCount;
@@ -19,7 +19,7 @@ public:
   Context();
   ~Context();
 
-  bool createDevice(VkSurfaceKHR mirrorSurface);
+  bool createDevice(VkSurfaceKHR mirrorSurface); // The surface is optional, pass nullptr without a mirror view window
   void sync() const;
 
   bool isValid() const;
@@ -27,6 +27,10 @@ public:
   XrViewConfigurationType getXrViewType() const;
   XrInstance getXrInstance() const;
   XrSystemId getXrSystemId() const;
+  PFN_xrLocateSpacesKHR getXrLocateSpacesFunction() const; // Optional, nullptr without XR_KHR_locate_spaces support
+  PFN_xrGetVisibilityMaskKHR getXrGetVisibilityMaskFunction() const; // Optional, likewise for XR_KHR_visibility_mask
+  bool isEyeGazeSupported() const; // Whether the system can track where the user is looking
+  bool getCurrentXrTime(XrTime& time) const; // Returns false if the runtime cannot convert the time of the platform
 
   VkInstance getVkInstance() const;
   VkPhysicalDevice getVkPhysicalDevice() const;
@@ -36,6 +40,13 @@ public:
   VkQueue getVkPresentQueue() const;
 
   VkDeviceSize getUniformBufferOffsetAlignment() const;
+  VkDeviceSize getMaxStorageBufferRange() const;
+  float getTimestampPeriod() const; // In nanoseconds per tick, zero if timestamps are not supported
+  uint64_t getTimestampMask() const; // Of the bits that are valid in timestamps written on the draw queue
+  uint32_t getMaxMultiviewViewCount() const;
+  bool isMirrorExportSupported() const; // Whether the mirror image can be shared with a viewer process
+  bool isFoveationSupported() const;    // Whether the headset views can be rendered with a fragment density map
+  VkExtent2D getFragmentDensityTexelSize() const; // In pixels per texel of the fragment density map
   VkSampleCountFlagBits getMultisampleCount() const;
 
 #ifdef DEBUG
@@ -50,16 +61,26 @@ private:
   PFN_xrCreateVulkanDeviceKHR xrCreateVulkanDeviceKHR = nullptr;
   PFN_xrGetVulkanGraphicsDevice2KHR xrGetVulkanGraphicsDevice2KHR = nullptr;
   PFN_xrGetVulkanGraphicsRequirements2KHR xrGetVulkanGraphicsRequirements2KHR = nullptr;
+  PFN_xrLocateSpacesKHR xrLocateSpacesKHR = nullptr;           // Optional
+  PFN_xrVoidFunction xrConvertTimeKHR = nullptr;               // Optional, converts platform time to OpenXR time
+  PFN_xrGetVisibilityMaskKHR xrGetVisibilityMaskKHR = nullptr; // Optional
 
   XrInstance xrInstance = nullptr;
   XrSystemId systemId = 0u;
+  XrViewConfigurationType viewType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+  bool quadViewsSupported = false, eyeGazeSupported = false;
 
   VkInstance vkInstance = nullptr;
   VkPhysicalDevice physicalDevice = nullptr;
   uint32_t drawQueueFamilyIndex = 0u, presentQueueFamilyIndex = 0u;
   VkDevice device = nullptr;
   VkQueue drawQueue = nullptr, presentQueue = nullptr;
-  VkDeviceSize uniformBufferOffsetAlignment = 0u;
+  VkDeviceSize uniformBufferOffsetAlignment = 0u, maxStorageBufferRange = 0u;
+  float timestampPeriod = 0.0f;
+  uint64_t timestampMask = 0u;
+  uint32_t maxMultiviewViewCount = 0u;
+  bool mirrorExportSupported = false, foveationSupported = false;
+  VkExtent2D fragmentDensityTexelSize = { 0u, 0u };
   VkSampleCountFlagBits multisampleCount = VK_SAMPLE_COUNT_1_BIT;
 
 #ifdef DEBUG
@@ -5,6 +5,7 @@
 
 #include <glm/mat4x4.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 
@@ -16,8 +17,11 @@ const std::string actionSetName = "actionset";
 const std::string localizedActionSetName = "Actions";
 } // namespace
 
-Controllers::Controllers(XrInstance instance, XrSession session) : session(session)
+Controllers::Controllers(const Context* context, XrSession session) : session(session)
 {
+  const XrInstance instance = context->getXrInstance();
+  xrLocateSpacesKHR = context->getXrLocateSpacesFunction();
+
   // Create an action set
   XrActionSetCreateInfo actionSetCreateInfo{ XR_TYPE_ACTION_SET_CREATE_INFO };
 
@@ -53,6 +57,14 @@ Controllers::Controllers(XrInstance instance, XrSession session) : session(sessi
     return;
   }
 
+  if (context->isEyeGazeSupported() &&
+      !util::createAction(actionSet, {}, "gazepose", "Gaze Pose", XR_ACTION_TYPE_POSE_INPUT, gazeAction))
+  {
+    util::error(Error::GenericOpenXR);
+    valid = false;
+    return;
+  }
+
   // Create spaces
   spaces.resize(controllerCount);
   for (size_t controllerIndex = 0u; controllerIndex < controllerCount; ++controllerIndex)
@@ -73,6 +85,26 @@ Controllers::Controllers(XrInstance instance, XrSession session) : session(sessi
     }
   }
 
+  // Create a space for the gaze, which is located along with the controllers
+  if (gazeAction)
+  {
+    XrActionSpaceCreateInfo actionSpaceCreateInfo{ XR_TYPE_ACTION_SPACE_CREATE_INFO };
+    actionSpaceCreateInfo.action = gazeAction;
+    actionSpaceCreateInfo.poseInActionSpace = util::makeIdentity();
+
+    XrSpace gazeSpace;
+    result = xrCreateActionSpace(session, &actionSpaceCreateInfo, &gazeSpace);
+    if (XR_FAILED(result))
+    {
+      util::error(Error::GenericOpenXR);
+      valid = false;
+      return;
+    }
+
+    gazeSpaceIndex = spaces.size();
+    spaces.push_back(gazeSpace);
+  }
+
   // Suggest simple controller binding (generic)
   const std::array<XrActionSuggestedBinding, 4u> bindings = {
     { { poseAction, util::stringToPath(instance, "/user/hand/left/input/aim/pose") },
@@ -97,6 +129,25 @@ Controllers::Controllers(XrInstance instance, XrSession session) : session(sessi
     return;
   }
 
+  // Suggest the eye gaze binding, which uses an interaction profile of its own
+  if (gazeAction)
+  {
+    const XrActionSuggestedBinding gazeBinding = { gazeAction,
+                                                   util::stringToPath(instance, "/user/eyes_ext/input/gaze_ext/pose") };
+    interactionProfileSuggestedBinding.interactionProfile =
+      util::stringToPath(instance, "/interaction_profiles/ext/eye_gaze_interaction");
+    interactionProfileSuggestedBinding.suggestedBindings = &gazeBinding;
+    interactionProfileSuggestedBinding.countSuggestedBindings = 1u;
+
+    result = xrSuggestInteractionProfileBindings(instance, &interactionProfileSuggestedBinding);
+    if (XR_FAILED(result))
+    {
+      util::error(Error::GenericOpenXR);
+      valid = false;
+      return;
+    }
+  }
+
   // Attach the controller action set
   XrSessionActionSetsAttachInfo sessionActionSetsAttachInfo{ XR_TYPE_SESSION_ACTION_SETS_ATTACH_INFO };
   sessionActionSetsAttachInfo.countActionSets = 1u;
@@ -110,7 +161,9 @@ Controllers::Controllers(XrInstance instance, XrSession session) : session(sessi
     return;
   }
 
-  poses.resize(controllerCount);
+  poses.resize(spaces.size());
+  locations.resize(spaces.size());
+  lateLocations.resize(spaces.size());
   flySpeeds.resize(controllerCount);
 }
 
@@ -121,6 +174,11 @@ Controllers::~Controllers()
     xrDestroySpace(space);
   }
 
+  if (gazeAction)
+  {
+    xrDestroyAction(gazeAction);
+  }
+
   if (flyAction)
   {
     xrDestroyAction(flyAction);
@@ -155,46 +213,37 @@ bool Controllers::sync(XrSpace space, XrTime time)
     return false;
   }
 
-  // Update the actions
-  for (size_t controllerIndex = 0u; controllerIndex < controllerCount; ++controllerIndex)
+  size_t callCount = 1u; // Including the sync
+
+  // Locate all tracked spaces, inactive pose actions are never located as tracked
+  if (!util::locateSpaces(session, xrLocateSpacesKHR, space, time, spaces, locations, callCount))
   {
-    const XrPath& path = paths.at(controllerIndex);
+    util::error(Error::GenericOpenXR);
+    return false;
+  }
 
-    // Pose
-    XrActionStatePose poseState{ XR_TYPE_ACTION_STATE_POSE };
-    if (!util::updateActionStatePose(session, poseAction, path, poseState))
+  for (size_t spaceIndex = 0u; spaceIndex < spaces.size(); ++spaceIndex)
+  {
+    const XrSpaceLocationData& location = locations.at(spaceIndex);
+    if (util::isTracked(location.locationFlags))
     {
-      util::error(Error::GenericOpenXR);
-      return false;
+      poses.at(spaceIndex) = util::poseToMatrix(location.pose);
     }
+  }
 
-    if (poseState.isActive)
-    {
-      XrSpaceLocation spaceLocation{ XR_TYPE_SPACE_LOCATION };
-      result = xrLocateSpace(spaces.at(controllerIndex), space, time, &spaceLocation);
-      if (XR_FAILED(result))
-      {
-        util::error(Error::GenericOpenXR);
-        return false;
-      }
-
-      // Check that the position and orientation are valid and tracked
-      constexpr XrSpaceLocationFlags checkFlags =
-        XR_SPACE_LOCATION_POSITION_VALID_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT |
-        XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
-      if ((spaceLocation.locationFlags & checkFlags) == checkFlags)
-      {
-        poses.at(controllerIndex) = util::poseToMatrix(spaceLocation.pose);
-      }
-    }
+  // Unlike the controllers, the gaze is not held when tracking is lost, as it would foveate the wrong area
+  gazeTracked = gazeAction && util::isTracked(locations.at(gazeSpaceIndex).locationFlags);
 
-    // Fly speed
+  // Update the fly speeds, OpenXR offers no way to query several action states at once
+  for (size_t controllerIndex = 0u; controllerIndex < controllerCount; ++controllerIndex)
+  {
     XrActionStateFloat flySpeedState{ XR_TYPE_ACTION_STATE_FLOAT };
-    if (!util::updateActionStateFloat(session, flyAction, path, flySpeedState))
+    if (!util::updateActionStateFloat(session, flyAction, paths.at(controllerIndex), flySpeedState))
     {
       util::error(Error::GenericOpenXR);
       return false;
     }
+    ++callCount;
 
     if (flySpeedState.isActive)
     {
@@ -202,6 +251,31 @@ bool Controllers::sync(XrSpace space, XrTime time)
     }
   }
 
+  syncCallCount.store(callCount, std::memory_order_relaxed);
+  return true;
+}
+
+bool Controllers::locatePoses(XrSpace space, XrTime time, std::vector<glm::mat4>& poses) const
+{
+  size_t callCount = 0u;
+  if (!util::locateSpaces(session, xrLocateSpacesKHR, space, time, spaces, lateLocations, callCount))
+  {
+    util::error(Error::GenericOpenXR);
+    return false;
+  }
+
+  // Keep the given poses unless the located ones are valid and tracked
+  const size_t poseCount = std::min(poses.size(), lateLocations.size());
+  for (size_t poseIndex = 0u; poseIndex < poseCount; ++poseIndex)
+  {
+    const XrSpaceLocationData& location = lateLocations.at(poseIndex);
+    if (util::isTracked(location.locationFlags))
+    {
+      poses.at(poseIndex) = util::poseToMatrix(location.pose);
+    }
+  }
+
+  locateCallCount.store(callCount, std::memory_order_relaxed);
   return true;
 }
 
@@ -215,7 +289,33 @@ glm::mat4 Controllers::getPose(size_t controllerIndex) const
   return poses.at(controllerIndex);
 }
 
+bool Controllers::getGazePose(glm::mat4& pose) const
+{
+  if (!gazeTracked)
+  {
+    return false;
+  }
+
+  pose = poses.at(gazeSpaceIndex);
+  return true;
+}
+
 float Controllers::getFlySpeed(size_t controllerIndex) const
 {
   return flySpeeds.at(controllerIndex);
 }
+
+const std::vector<XrSpace>& Controllers::getXrSpaces() const
+{
+  return spaces;
+}
+
+size_t Controllers::getSyncCallCount() const
+{
+  return syncCallCount.load(std::memory_order_relaxed);
+}
+
+size_t Controllers::getLocateCallCount() const
+{
+  return locateCallCount.load(std::memory_order_relaxed);
+}
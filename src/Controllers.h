@@ -4,37 +4,59 @@
 
 #include <openxr/openxr.h>
 
+#include <atomic>
 #include <vector>
 
+class Context;
+
 /*
  * The controllers class handles OpenXR controller support. It represents the controller system as a whole, not an
  * individual controller. This is more convenient due to the OpenXR API. It allows the application to retrieve the
  * current pose of a controller, which is then used to accurately pose the hand models in the scene. It also exposes the
- * current fly speed, which is used to fly the camera in the direction of the controller.
+ * current fly speed, which is used to fly the camera in the direction of the controller. The poses can be located again
+ * without syncing the actions, which is safe to do from another thread and returns the newest poses for late latching.
+ * All tracked spaces are located in a single call if the runtime supports XR_KHR_locate_spaces, so the number of OpenXR
+ * calls per frame does not grow with the number of tracked objects. The pose action state is not queried separately as
+ * the location of an inactive action space is never valid. If the system supports XR_EXT_eye_gaze_interaction, the gaze
+ * of the user is tracked as another pose that is located together with the controllers.
  */
 class Controllers final
 {
 public:
-  Controllers(XrInstance instance, XrSession session);
+  Controllers(const Context* context, XrSession session);
   ~Controllers();
 
   bool sync(XrSpace space, XrTime time);
+  bool locatePoses(XrSpace space, XrTime time, std::vector<glm::mat4>& poses) const; // Only overwrites tracked poses
 
   bool isValid() const;
 
   glm::mat4 getPose(size_t controllerIndex) const;
+  bool getGazePose(glm::mat4& pose) const; // Of the last sync, returns false without eye tracking or an untracked gaze
   float getFlySpeed(size_t controllerIndex) const;
+  const std::vector<XrSpace>& getXrSpaces() const; // All tracked spaces, in the order of their poses
+  size_t getSyncCallCount() const;   // Of the last sync, in OpenXR calls
+  size_t getLocateCallCount() const; // Of the last pose location, in OpenXR calls
 
 private:
   bool valid = true;
 
   XrSession session = nullptr;
   std::vector<XrPath> paths;
-  std::vector<XrSpace> spaces;
+  std::vector<XrSpace> spaces; // All tracked spaces, located together
+  std::vector<XrSpaceLocationData> locations;
+  mutable std::vector<XrSpaceLocationData> lateLocations; // Only used to locate the poses, possibly concurrently
 
   std::vector<glm::mat4> poses;
+  size_t gazeSpaceIndex = 0u; // Follows the controllers, only with eye tracking
+  bool gazeTracked = false;
   std::vector<float> flySpeeds;
 
   XrActionSet actionSet = nullptr;
-  XrAction poseAction = nullptr, flyAction = nullptr;
+  XrAction poseAction = nullptr, flyAction = nullptr, gazeAction = nullptr; // The gaze action is optional
+
+  PFN_xrLocateSpacesKHR xrLocateSpacesKHR = nullptr; // Optional
+
+  std::atomic<size_t> syncCallCount = 0u;
+  mutable std::atomic<size_t> locateCallCount = 0u;
 };
\ No newline at end of file
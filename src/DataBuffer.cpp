@@ -128,6 +128,21 @@ void DataBuffer::unmap() const
   vkUnmapMemory(context->getVkDevice(), deviceMemory);
 }
 
+bool DataBuffer::invalidate() const
+{
+  VkMappedMemoryRange mappedMemoryRange{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+  mappedMemoryRange.memory = deviceMemory;
+  mappedMemoryRange.offset = 0u;
+  mappedMemoryRange.size = VK_WHOLE_SIZE;
+  if (vkInvalidateMappedMemoryRanges(context->getVkDevice(), 1u, &mappedMemoryRange) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  return true;
+}
+
 bool DataBuffer::isValid() const
 {
   return valid;
@@ -21,6 +21,7 @@ public:
   bool copyTo(const DataBuffer& target, VkCommandBuffer commandBuffer, VkQueue queue) const;
   void* map() const;
   void unmap() const;
+  bool invalidate() const; // Makes device writes visible to the mapped memory, unless it is host coherent
 
   bool isValid() const;
   VkBuffer getBuffer() const;
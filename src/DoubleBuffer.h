@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+
+/*
+ * The double buffer class passes values from one producing thread to one consuming thread through two slots, so that
+ * the producer can write the next value while the consumer still reads the current one. The producer never gets more
+ * than one value ahead of the consumer, writing blocks until the slot has been read. Values are read in the order they
+ * were written.
+ */
+template<typename T>
+class DoubleBuffer final
+{
+public:
+  // Returns the slot to write the next value into, blocks until it is free and returns nullptr when stopped
+  T* beginWrite()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return stopRequested || slotStates.at(writeIndex) == SlotState::Free; });
+    return stopRequested ? nullptr : &slots.at(writeIndex);
+  }
+
+  void endWrite()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      slotStates.at(writeIndex) = SlotState::Written;
+      writeIndex = (writeIndex + 1u) % slots.size();
+    }
+    condition.notify_all();
+  }
+
+  // Returns the slot with the next value to read, blocks until it has been written and returns nullptr when stopped
+  const T* beginRead()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return stopRequested || slotStates.at(readIndex) == SlotState::Written; });
+    return stopRequested ? nullptr : &slots.at(readIndex);
+  }
+
+  void endRead()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      slotStates.at(readIndex) = SlotState::Free;
+      readIndex = (readIndex + 1u) % slots.size();
+    }
+    condition.notify_all();
+  }
+
+  // Wakes up and returns from all blocked calls
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopRequested = true;
+    }
+    condition.notify_all();
+  }
+
+private:
+  enum class SlotState
+  {
+    Free,
+    Written
+  };
+
+  std::array<T, 2u> slots;
+  std::array<SlotState, 2u> slotStates = { SlotState::Free, SlotState::Free };
+  size_t writeIndex = 0u, readIndex = 0u;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopRequested = false;
+};
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr float minScale = 0.5f, scaleStep = 0.05f;
+constexpr float budgetShare = 0.85f;   // Of the display period that the GPU may take
+constexpr float raiseThreshold = 0.7f; // Of the budget, the GPU needs to stay below it before the scale is raised
+constexpr float smoothing = 0.1f;      // How much each new GPU time contributes to the smoothed one
+constexpr size_t lowerDelayFrameCount = 5u;  // Until the GPU times of frames at a new scale are known
+constexpr size_t raiseDelayFrameCount = 60u; // Of spare GPU time before the scale is raised
+} // namespace
+
+void DynamicResolution::update(float gpuDuration, XrDuration predictedDisplayPeriod)
+{
+  ++framesSinceChange;
+  if (gpuDuration <= 0.0f || predictedDisplayPeriod <= 0)
+  {
+    return;
+  }
+
+  smoothedGpuDuration =
+    (smoothedGpuDuration > 0.0f ? smoothedGpuDuration + (gpuDuration - smoothedGpuDuration) * smoothing : gpuDuration);
+
+  // Only react once the GPU times are those of frames at the current scale, frames in flight keep reporting the old one
+  if (framesSinceChange < lowerDelayFrameCount)
+  {
+    return;
+  }
+
+  // The scale that would make the GPU time fit the budget, assuming that it grows with the number of pixels
+  const float budget = static_cast<float>(predictedDisplayPeriod) / 1e9f * budgetShare;
+  float newScale = scale;
+  if (gpuDuration > budget)
+  {
+    // Lower the scale right away on the first frame over the budget, so that no frames are missed
+    newScale = std::floor(scale * std::sqrt(budget / gpuDuration) / scaleStep) * scaleStep;
+  }
+  else if (smoothedGpuDuration < budget * raiseThreshold && framesSinceChange >= raiseDelayFrameCount)
+  {
+    // Raise the scale by a single step at a time, so that it does not overshoot
+    newScale = scale + scaleStep;
+  }
+
+  newScale = std::clamp(newScale, minScale, 1.0f);
+  if (newScale != scale)
+  {
+    scale = newScale;
+    framesSinceChange = 0u;
+  }
+}
+
+float DynamicResolution::getScale() const
+{
+  return scale;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <openxr/openxr.h>
+
+/*
+ * The dynamic resolution class decides at which scale of the full resolution the headset views are rendered, so that
+ * the GPU keeps up with the display instead of missing frames. It compares the GPU time of recent frames against a
+ * budget that is a share of the predicted display period. As the GPU time grows roughly with the number of pixels, the
+ * scale is lowered right away to the one that would fit into the budget once a frame exceeds it, and raised again in
+ * small steps after the GPU has had spare time for a while. The scale moves in fixed steps, so that the cached draws
+ * only have to be recorded again when it actually changes.
+ */
+class DynamicResolution final
+{
+public:
+  // Call once per frame before rendering with the newest known GPU time in seconds, which is zero if there is none
+  void update(float gpuDuration, XrDuration predictedDisplayPeriod);
+
+  float getScale() const; // Along both axes, between the minimum scale and one
+
+private:
+  float scale = 1.0f;
+  float smoothedGpuDuration = 0.0f; // In seconds
+  size_t framesSinceChange = 0u;
+};
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "FrameCapture.h"
+
+#include "Context.h"
+#include "DataBuffer.h"
+#include "FrameTimeline.h"
+#include "Headset.h"
+#include "RenderTarget.h"
+#include "Renderer.h"
+#include "SpectatorView.h"
+#include "Util.h"
+
+#include <vector>
+
+namespace
+{
+constexpr size_t mirrorEyeIndex = 1u; // Eye index to capture without a spectator view, 0 = left, 1 = right
+constexpr VkDeviceSize bytesPerPixel = 4u;
+
+bool isMemoryTypeSupported(VkPhysicalDevice physicalDevice, VkMemoryPropertyFlags properties)
+{
+  VkPhysicalDeviceMemoryProperties supportedMemoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &supportedMemoryProperties);
+
+  for (uint32_t memoryTypeIndex = 0u; memoryTypeIndex < supportedMemoryProperties.memoryTypeCount; ++memoryTypeIndex)
+  {
+    const VkMemoryPropertyFlags propertyFlags = supportedMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    if ((propertyFlags & properties) == properties)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+} // namespace
+
+FrameCapture::FrameCapture(const Context* context, const std::string& filename) : context(context), filename(filename)
+{
+  file.open(filename, std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    util::error(Error::FileWriteFailure, filename);
+    valid = false;
+    return;
+  }
+
+  thread = std::thread(&FrameCapture::writerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+  if (thread.joinable())
+  {
+    Job job;
+    job.stop = true;
+    queue.push(job); // There is always room for the stop job
+    thread.join();
+  }
+
+  for (ReadbackBuffer& readbackBuffer : readbackBuffers)
+  {
+    if (readbackBuffer.dataBuffer)
+    {
+      if (readbackBuffer.data)
+      {
+        readbackBuffer.dataBuffer->unmap();
+      }
+
+      delete readbackBuffer.dataBuffer;
+    }
+  }
+}
+
+bool FrameCapture::connect(const Headset* headset, const Renderer* renderer, const SpectatorView* spectatorView)
+{
+  this->headset = headset;
+  this->renderer = renderer;
+  this->spectatorView = spectatorView;
+
+  resolution = (spectatorView ? spectatorView->getResolution() : headset->getEyeResolution(mirrorEyeIndex));
+  frameSize = static_cast<VkDeviceSize>(resolution.width) * resolution.height * bytesPerPixel;
+
+  // Create the readback buffers in cached memory, which is much faster to read from on the CPU but is not necessarily
+  // coherent, so it is invalidated before each read. Fall back to coherent memory, which every device offers
+  VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+  invalidateReadbackBuffers = isMemoryTypeSupported(context->getVkPhysicalDevice(), memoryProperties);
+  if (!invalidateReadbackBuffers)
+  {
+    memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  }
+
+  for (ReadbackBuffer& readbackBuffer : readbackBuffers)
+  {
+    readbackBuffer.dataBuffer =
+      new DataBuffer(context, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryProperties, frameSize);
+    if (!readbackBuffer.dataBuffer->isValid())
+    {
+      valid = false;
+      return false;
+    }
+
+    readbackBuffer.data = static_cast<const char*>(readbackBuffer.dataBuffer->map());
+    if (!readbackBuffer.data)
+    {
+      valid = false;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+FrameCapture::CaptureResult FrameCapture::capture(uint32_t swapchainImageIndex, size_t& readbackBufferIndex)
+{
+  if (!collectCompletedFrames())
+  {
+    return CaptureResult::Error;
+  }
+
+  if (writeFailed.load(std::memory_order_acquire))
+  {
+    util::error(Error::FileWriteFailure, filename);
+    return CaptureResult::Error;
+  }
+
+  // Only capture when the spectator view has been updated, it is the same image otherwise
+  if (spectatorView && !renderer->isSpectatorViewUpdated())
+  {
+    return CaptureResult::Skipped;
+  }
+
+  // Drop the frame instead of waiting if the oldest readback buffer is still being copied into or written to disk
+  ReadbackBuffer& readbackBuffer = readbackBuffers.at(nextReadbackBufferIndex);
+  if (readbackBuffer.state.load(std::memory_order_acquire) != State::Free)
+  {
+    ++droppedFrameCount;
+    return CaptureResult::Skipped;
+  }
+
+  const VkCommandBuffer commandBuffer = renderer->getCurrentCommandBuffer();
+  const VkImage sourceImage =
+    (spectatorView ? spectatorView->getImage() : headset->getRenderTarget(swapchainImageIndex)->getImage());
+  const uint32_t sourceLayer = (spectatorView ? 0u : static_cast<uint32_t>(mirrorEyeIndex));
+
+  // Transition the source layer to the transfer source optimal layout unless it is the spectator view, which is in
+  // that layout already
+  if (!spectatorView)
+  {
+    VkImageMemoryBarrier imageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    imageMemoryBarrier.image = sourceImage;
+    imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageMemoryBarrier.subresourceRange.layerCount = 1u;
+    imageMemoryBarrier.subresourceRange.baseArrayLayer = sourceLayer;
+    imageMemoryBarrier.subresourceRange.levelCount = 1u;
+    imageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0u, 0u, nullptr, 0u, nullptr, 1u, &imageMemoryBarrier);
+  }
+
+  // Copy the source into the readback buffer, tightly packed
+  VkBufferImageCopy bufferImageCopy{};
+  bufferImageCopy.bufferOffset = 0u;
+  bufferImageCopy.bufferRowLength = 0u;
+  bufferImageCopy.bufferImageHeight = 0u;
+  bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  bufferImageCopy.imageSubresource.mipLevel = 0u;
+  bufferImageCopy.imageSubresource.baseArrayLayer = sourceLayer;
+  bufferImageCopy.imageSubresource.layerCount = 1u;
+  bufferImageCopy.imageExtent = { resolution.width, resolution.height, 1u };
+  vkCmdCopyImageToBuffer(commandBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         readbackBuffer.dataBuffer->getBuffer(), 1u, &bufferImageCopy);
+
+  // Make the copy available to the host and transition the source layer back to the color attachment optimal layout
+  {
+    VkBufferMemoryBarrier bufferMemoryBarrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+    bufferMemoryBarrier.buffer = readbackBuffer.dataBuffer->getBuffer();
+    bufferMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferMemoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferMemoryBarrier.offset = 0u;
+    bufferMemoryBarrier.size = VK_WHOLE_SIZE;
+
+    VkImageMemoryBarrier imageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    imageMemoryBarrier.image = sourceImage;
+    imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageMemoryBarrier.subresourceRange.layerCount = 1u;
+    imageMemoryBarrier.subresourceRange.baseArrayLayer = sourceLayer;
+    imageMemoryBarrier.subresourceRange.levelCount = 1u;
+    imageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    const VkPipelineStageFlags dstStageMask =
+      VK_PIPELINE_STAGE_HOST_BIT | (spectatorView ? 0u : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0u, 0u, nullptr, 1u,
+                         &bufferMemoryBarrier, spectatorView ? 0u : 1u, &imageMemoryBarrier);
+  }
+
+  readbackBuffer.state.store(State::Copying, std::memory_order_release);
+  readbackBufferIndex = nextReadbackBufferIndex;
+  nextReadbackBufferIndex = (nextReadbackBufferIndex + 1u) % readbackBuffers.size();
+  return CaptureResult::Captured;
+}
+
+void FrameCapture::markSubmitted(size_t readbackBufferIndex, uint64_t frame)
+{
+  ReadbackBuffer& readbackBuffer = readbackBuffers.at(readbackBufferIndex);
+  readbackBuffer.frame = frame;
+  readbackBuffer.state.store(State::Submitted, std::memory_order_release);
+}
+
+bool FrameCapture::finish()
+{
+  if (!thread.joinable())
+  {
+    return false;
+  }
+
+  // Hand over the last frames, which have all completed now, and wait for the writer thread to write them
+  const bool collected = collectCompletedFrames();
+
+  Job job;
+  job.stop = true;
+  queue.push(job);
+  thread.join();
+
+  file.close();
+  if (!collected || writeFailed.load(std::memory_order_acquire) || file.fail())
+  {
+    util::error(Error::FileWriteFailure, filename);
+    return false;
+  }
+
+  // Describe the capture in a text file next to it
+  const std::string descriptionFilename = filename + ".txt";
+  std::ofstream descriptionFile(descriptionFilename);
+  if (!descriptionFile.is_open())
+  {
+    util::error(Error::FileWriteFailure, descriptionFilename);
+    return false;
+  }
+
+  descriptionFile << "Resolution: " << resolution.width << "x" << resolution.height << "\n";
+  descriptionFile << "Pixel format: rgba, 8 bits per channel, sRGB\n";
+  descriptionFile << "Frames written: " << writtenFrameCount.load() << "\n";
+  descriptionFile << "Frames dropped: " << droppedFrameCount << "\n";
+  descriptionFile << "Convert with: ffmpeg -f rawvideo -pixel_format rgba -video_size " << resolution.width << "x"
+                  << resolution.height << " -i \"" << filename << "\" capture.mp4\n";
+
+  return true;
+}
+
+bool FrameCapture::isValid() const
+{
+  return valid;
+}
+
+size_t FrameCapture::getWrittenFrameCount() const
+{
+  return writtenFrameCount.load(std::memory_order_relaxed);
+}
+
+size_t FrameCapture::getDroppedFrameCount() const
+{
+  return droppedFrameCount;
+}
+
+bool FrameCapture::collectCompletedFrames()
+{
+  const FrameTimeline* frameTimeline = renderer->getFrameTimeline();
+
+  // Frames complete in order, so go through the readback buffers from the oldest one and stop at the first frame that
+  // has not been submitted or has not completed yet
+  for (size_t offset = 0u; offset < readbackBuffers.size(); ++offset)
+  {
+    const size_t readbackBufferIndex = (nextReadbackBufferIndex + offset) % readbackBuffers.size();
+    ReadbackBuffer& readbackBuffer = readbackBuffers.at(readbackBufferIndex);
+    const State state = readbackBuffer.state.load(std::memory_order_acquire);
+    if (state == State::Free || state == State::Writing)
+    {
+      continue;
+    }
+
+    if (state == State::Copying || !frameTimeline->isFrameComplete(readbackBuffer.frame))
+    {
+      break;
+    }
+
+    if (invalidateReadbackBuffers && !readbackBuffer.dataBuffer->invalidate())
+    {
+      return false;
+    }
+
+    readbackBuffer.state.store(State::Writing, std::memory_order_release);
+
+    Job job;
+    job.readbackBufferIndex = readbackBufferIndex;
+    queue.push(job); // There is room for every readback buffer
+  }
+
+  return true;
+}
+
+void FrameCapture::writerLoop()
+{
+  while (true)
+  {
+    Job job;
+    while (!queue.pop(job))
+    {
+      queue.waitUntilNotEmpty();
+    }
+
+    if (job.stop)
+    {
+      return;
+    }
+
+    // Keep handing the readback buffers back after a failed write, so that frames are dropped instead of stalling
+    ReadbackBuffer& readbackBuffer = readbackBuffers.at(job.readbackBufferIndex);
+    if (!writeFailed.load(std::memory_order_relaxed))
+    {
+      file.write(readbackBuffer.data, static_cast<std::streamsize>(frameSize));
+      if (file.good())
+      {
+        writtenFrameCount.fetch_add(1u, std::memory_order_relaxed);
+      }
+      else
+      {
+        writeFailed.store(true, std::memory_order_release);
+      }
+    }
+
+    readbackBuffer.state.store(State::Free, std::memory_order_release);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "SpscQueue.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+
+class Context;
+class DataBuffer;
+class Headset;
+class Renderer;
+class SpectatorView;
+
+/*
+ * The frame capture class records what is shown in the mirror view, an eye or the spectator view, into a raw video file
+ * without stalling any frame. Each captured frame is copied into one of a ring of host-visible readback buffers as part
+ * of the frame's command buffer, and the buffer remembers the value that the frame signals on the frame timeline. A few
+ * frames later, the buffers of the completed frames are handed to a writer thread that appends them to the file. A
+ * frame is dropped rather than waited for when all readback buffers are still in use, which happens when the disk
+ * cannot keep up. The frames are written back to back as raw 8-bit RGBA pixels, a text file next to the capture
+ * describes them and reports the number of frames that were dropped.
+ */
+class FrameCapture final
+{
+public:
+  FrameCapture(const Context* context, const std::string& filename);
+  ~FrameCapture();
+
+  bool connect(const Headset* headset, const Renderer* renderer, const SpectatorView* spectatorView); // Optional view
+
+  enum class CaptureResult
+  {
+    Error,    // An error occurred
+    Captured, // The frame was copied into the given readback buffer, mark it once the frame has been submitted
+    Skipped   // The frame was dropped or there was nothing new to capture
+  };
+  CaptureResult capture(uint32_t swapchainImageIndex, size_t& readbackBufferIndex);
+  void markSubmitted(size_t readbackBufferIndex, uint64_t frame); // With the frame value of the captured frame
+  bool finish(); // Call once the GPU is idle, writes the remaining frames and the description of the capture
+
+  bool isValid() const;
+  size_t getWrittenFrameCount() const;
+  size_t getDroppedFrameCount() const;
+
+private:
+  static constexpr size_t readbackBufferCount = 4u;
+
+  bool valid = true;
+
+  const Context* context = nullptr;
+  const Headset* headset = nullptr;
+  const Renderer* renderer = nullptr;
+  const SpectatorView* spectatorView = nullptr;
+
+  std::string filename;
+  std::ofstream file;
+  VkExtent2D resolution = { 0u, 0u };
+  VkDeviceSize frameSize = 0u; // In bytes
+  bool invalidateReadbackBuffers = false; // True for cached memory, which is not necessarily coherent
+
+  enum class State
+  {
+    Free,      // Can be copied into
+    Copying,   // Copied into by a frame that has not been submitted yet
+    Submitted, // Copied into by a submitted frame that may not have completed yet
+    Writing    // Owned by the writer thread
+  };
+  struct ReadbackBuffer
+  {
+    DataBuffer* dataBuffer = nullptr;
+    const char* data = nullptr; // Persistently mapped
+    uint64_t frame = 0u;        // The frame value of the frame that copied into the buffer, set once it is submitted
+    std::atomic<State> state = State::Free;
+  };
+  std::array<ReadbackBuffer, readbackBufferCount> readbackBuffers;
+  size_t nextReadbackBufferIndex = 0u;
+
+  struct Job
+  {
+    size_t readbackBufferIndex = 0u;
+    bool stop = false;
+  };
+  SpscQueue<Job, readbackBufferCount + 1u> queue; // Room for every buffer and the stop job
+  std::thread thread;
+  std::atomic<bool> writeFailed = false;
+
+  std::atomic<size_t> writtenFrameCount = 0u;
+  size_t droppedFrameCount = 0u;
+
+  bool collectCompletedFrames(); // Hands completed readback buffers over to the writer thread
+  void writerLoop();
+};
\ No newline at end of file
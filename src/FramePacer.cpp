@@ -0,0 +1,105 @@
+#include "FramePacer.h"
+
+FramePacer::FramePacer(Headset* headset) : headset(headset)
+{
+  thread = std::thread(&FramePacer::pacingLoop, this);
+}
+
+FramePacer::~FramePacer()
+{
+  stop();
+  thread.join();
+}
+
+bool FramePacer::waitForSimulation(Frame& frame)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait(lock, [this] { return stopRequested || !simulationFrames.empty(); });
+  if (stopRequested)
+  {
+    return false;
+  }
+
+  frame = simulationFrames.front();
+  simulationFrames.pop_front();
+  return true;
+}
+
+bool FramePacer::acquireFrame(Frame& frame)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait(lock, [this] { return stopRequested || renderFramePending; });
+  if (stopRequested)
+  {
+    return false;
+  }
+
+  frame = renderFrame;
+  renderFramePending = false;
+  renderFrameAcquired = true;
+  return true;
+}
+
+void FramePacer::releaseFrame()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    renderFrameAcquired = false;
+  }
+  condition.notify_all();
+}
+
+void FramePacer::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopRequested = true;
+  }
+  condition.notify_all();
+}
+
+void FramePacer::pacingLoop()
+{
+  while (true)
+  {
+    // Wait for the next frame, this overlaps with rendering the previous frame
+    XrFrameState frameState;
+    Frame frame;
+    frame.result = headset->waitFrame(frameState);
+    frame.predictedDisplayTime = frameState.predictedDisplayTime;
+    frame.predictedDisplayPeriod = frameState.predictedDisplayPeriod;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      simulationFrames.push_back(frame);
+      condition.notify_all();
+
+      // Wait until the previous frame has been released, which happens once it has been ended as the runtime requires
+      // this before the next frame can begin
+      condition.wait(lock, [this] { return stopRequested || (!renderFramePending && !renderFrameAcquired); });
+      if (stopRequested)
+      {
+        return;
+      }
+    }
+
+    // Begin the frame, frames that are skipped fully are neither begun nor ended
+    if (frame.result == Headset::BeginFrameResult::RenderFully ||
+        frame.result == Headset::BeginFrameResult::SkipRender)
+    {
+      frame.result = headset->beginFrame(frameState, frame.swapchainImageIndex);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      renderFrame = frame;
+      renderFramePending = true;
+    }
+    condition.notify_all();
+
+    if (frame.result == Headset::BeginFrameResult::Error)
+    {
+      return;
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Headset.h"
+
+#include <openxr/openxr.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/*
+ * The frame pacer class runs the OpenXR frame cycle of the headset on its own thread. It waits for the next frame while
+ * the current one is still being rendered and only begins the next frame once the current one has been released, which
+ * happens after it has been ended. Each frame is handed to the simulation thread as soon as its wait has returned, so
+ * that the scene can be simulated for its predicted display time, and to the render thread once it has begun. Every
+ * frame is handed to both in the same order exactly once.
+ */
+class FramePacer final
+{
+public:
+  FramePacer(Headset* headset);
+  ~FramePacer();
+
+  struct Frame
+  {
+    Headset::BeginFrameResult result = Headset::BeginFrameResult::SkipFully;
+    XrTime predictedDisplayTime = 0;
+    XrDuration predictedDisplayPeriod = 0;
+    uint32_t swapchainImageIndex = 0u; // Only valid once the frame has begun
+  };
+
+  bool waitForSimulation(Frame& frame); // Blocks until the next frame can be simulated, returns false when stopped
+  bool acquireFrame(Frame& frame);      // Blocks until the next frame has begun, returns false when stopped
+  void releaseFrame();                  // Call once the acquired frame has been ended or skipped
+  void stop();
+
+private:
+  Headset* headset = nullptr;
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<Frame> simulationFrames;
+  Frame renderFrame;
+  bool renderFramePending = false, renderFrameAcquired = false;
+  bool stopRequested = false;
+
+  void pacingLoop();
+};
\ No newline at end of file
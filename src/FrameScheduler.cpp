@@ -0,0 +1,52 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr size_t recentFrameCount = 60u;
+constexpr float safetyMargin = 0.002f; // In seconds
+constexpr size_t backOffFrameCount = 90u;
+} // namespace
+
+void FrameScheduler::addFrameCost(float cpuDuration, float gpuDuration)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  frameCosts.push_back(cpuDuration + gpuDuration);
+  if (frameCosts.size() > recentFrameCount)
+  {
+    frameCosts.pop_front();
+  }
+}
+
+float FrameScheduler::getStartDelay(XrTime predictedDisplayTime, XrDuration predictedDisplayPeriod)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // A frame was missed if the predicted display time skipped ahead by more than a period, back off immediately and
+  // forget the costs that led to it
+  const XrTime displayTimeStep = predictedDisplayTime - previousDisplayTime;
+  if (previousDisplayTime != 0 && displayTimeStep > predictedDisplayPeriod + predictedDisplayPeriod / 2)
+  {
+    backOffFramesLeft = backOffFrameCount;
+    frameCosts.clear();
+  }
+  previousDisplayTime = predictedDisplayTime;
+
+  if (backOffFramesLeft > 0u)
+  {
+    --backOffFramesLeft;
+    return 0.0f;
+  }
+
+  if (frameCosts.empty())
+  {
+    return 0.0f;
+  }
+
+  // Leave enough time for the most expensive recent frame
+  const float displayPeriod = static_cast<float>(predictedDisplayPeriod) / 1e9f;
+  const float frameCost = *std::max_element(frameCosts.begin(), frameCosts.end());
+  return std::max(displayPeriod - frameCost - safetyMargin, 0.0f);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <openxr/openxr.h>
+
+#include <deque>
+#include <mutex>
+
+/*
+ * The frame scheduler class decides how long to wait after the runtime has released a frame before starting any CPU
+ * work on it, so that the frame starts as late as possible while still being ready in time for display. It keeps the
+ * combined CPU and GPU costs of recent frames and delays the start so that the most expensive of them would still fit
+ * into the predicted display period with a safety margin to spare. As soon as a frame is missed it backs off and starts
+ * frames immediately for a while before it tries to delay them again.
+ */
+class FrameScheduler final
+{
+public:
+  void addFrameCost(float cpuDuration, float gpuDuration); // In seconds, from the start of the frame to its submission
+  float getStartDelay(XrTime predictedDisplayTime, XrDuration predictedDisplayPeriod); // In seconds
+
+private:
+  std::mutex mutex;
+  std::deque<float> frameCosts; // Of the most recent frames, in seconds
+  XrTime previousDisplayTime = 0;
+  size_t backOffFramesLeft = 0u;
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "FrameTimeline.h"
+
+#include "Context.h"
+#include "Util.h"
+
+FrameTimeline::FrameTimeline(const Context* context) : context(context)
+{
+  VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+  semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  semaphoreTypeCreateInfo.initialValue = lastFrame;
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+  semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+  if (vkCreateSemaphore(context->getVkDevice(), &semaphoreCreateInfo, nullptr, &semaphore) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
+  }
+}
+
+FrameTimeline::~FrameTimeline()
+{
+  const VkDevice device = context->getVkDevice();
+  if (device && semaphore)
+  {
+    vkDestroySemaphore(device, semaphore, nullptr);
+  }
+}
+
+uint64_t FrameTimeline::nextFrame()
+{
+  return ++lastFrame;
+}
+
+bool FrameTimeline::isFrameComplete(uint64_t frame) const
+{
+  return getCompletedFrame() >= frame;
+}
+
+bool FrameTimeline::waitForFrame(uint64_t frame) const
+{
+  VkSemaphoreWaitInfo semaphoreWaitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+  semaphoreWaitInfo.semaphoreCount = 1u;
+  semaphoreWaitInfo.pSemaphores = &semaphore;
+  semaphoreWaitInfo.pValues = &frame;
+  return vkWaitSemaphores(context->getVkDevice(), &semaphoreWaitInfo, UINT64_MAX) == VK_SUCCESS;
+}
+
+bool FrameTimeline::isValid() const
+{
+  return valid;
+}
+
+VkSemaphore FrameTimeline::getSemaphore() const
+{
+  return semaphore;
+}
+
+uint64_t FrameTimeline::getLastFrame() const
+{
+  return lastFrame;
+}
+
+uint64_t FrameTimeline::getCompletedFrame() const
+{
+  uint64_t completedFrame = 0u;
+  if (vkGetSemaphoreCounterValue(context->getVkDevice(), semaphore, &completedFrame) != VK_SUCCESS)
+  {
+    return 0u;
+  }
+
+  return completedFrame;
+}
\ No newline at end of file
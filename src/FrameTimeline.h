@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+class Context;
+
+/*
+ * The frame timeline class tracks the progress of the GPU with a single Vulkan timeline semaphore. Every submitted
+ * frame signals the semaphore with a frame value that is one larger than that of the previous frame, so a frame has
+ * completed once the counter value of the semaphore has reached its frame value. Any resource that is used by a frame
+ * can remember the frame value and be reused as soon as that frame has completed, which can be queried without
+ * blocking. Frame zero is considered to be complete from the start.
+ */
+class FrameTimeline final
+{
+public:
+  FrameTimeline(const Context* context);
+  ~FrameTimeline();
+
+  uint64_t nextFrame(); // Returns the value that the next submitted frame signals
+  bool isFrameComplete(uint64_t frame) const;
+  bool waitForFrame(uint64_t frame) const;
+
+  bool isValid() const;
+  VkSemaphore getSemaphore() const;
+  uint64_t getLastFrame() const; // The value of the last submitted frame
+  uint64_t getCompletedFrame() const;
+
+private:
+  bool valid = true;
+
+  const Context* context = nullptr;
+  VkSemaphore semaphore = nullptr;
+  uint64_t lastFrame = 0u;
+};
\ No newline at end of file
@@ -5,9 +5,12 @@
 #include "RenderTarget.h"
 #include "Util.h"
 
-#include <glm/mat4x4.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 
 #if DEBUG
   #include <sstream>
@@ -18,17 +21,166 @@ namespace
 constexpr XrReferenceSpaceType spaceType = XR_REFERENCE_SPACE_TYPE_STAGE;
 constexpr VkFormat colorFormat = VK_FORMAT_R8G8B8A8_SRGB;
 constexpr VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
+constexpr VkFormat densityMapFormat = VK_FORMAT_R8G8_UNORM; // Always supported with fragment density maps
+constexpr size_t mockVisibilityMaskSegmentCount = 32u; // A multiple of 8 so that the corners are covered exactly
+constexpr float insetFovScale = 0.5f; // Of the tangents of the field of view of the eye that an inset belongs to
+constexpr float multiResolutionScale = 0.5f; // Of the eye resolution that the full eye is rendered at with an inset
+
+// Scales a resolution, rounded to the nearest pixel and never below a single pixel
+VkExtent2D scaleResolution(const VkExtent2D& resolution, float scale)
+{
+  const float width = std::round(static_cast<float>(resolution.width) * scale);
+  const float height = std::round(static_cast<float>(resolution.height) * scale);
+  return { std::max(static_cast<uint32_t>(width), 1u), std::max(static_cast<uint32_t>(height), 1u) };
+}
+
+// Creates a mask that hides everything outside the ellipse that touches all four edges of a field of view, which is
+// roughly what a lens hides, as a ring of quads between the ellipse and the edges
+void createMockVisibilityMask(const XrFovf& fov, std::vector<glm::vec2>& vertices, std::vector<uint32_t>& indices)
+{
+  const glm::vec2 minimum = { std::tan(fov.angleLeft), std::tan(fov.angleDown) };
+  const glm::vec2 maximum = { std::tan(fov.angleRight), std::tan(fov.angleUp) };
+  const glm::vec2 center = (minimum + maximum) * 0.5f;
+  const glm::vec2 extent = (maximum - minimum) * 0.5f;
+
+  vertices.clear();
+  indices.clear();
+  for (size_t segmentIndex = 0u; segmentIndex < mockVisibilityMaskSegmentCount; ++segmentIndex)
+  {
+    const float angle = glm::two_pi<float>() * static_cast<float>(segmentIndex) /
+                        static_cast<float>(mockVisibilityMaskSegmentCount);
+    const glm::vec2 direction = { std::cos(angle), std::sin(angle) };
+    const glm::vec2 edgeDirection = direction / std::max(std::abs(direction.x), std::abs(direction.y));
+    vertices.push_back(center + extent * direction);     // On the ellipse
+    vertices.push_back(center + extent * edgeDirection); // On the edge
+  }
+
+  const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+  for (uint32_t vertexIndex = 0u; vertexIndex < vertexCount; vertexIndex += 2u)
+  {
+    const uint32_t nextVertexIndex = (vertexIndex + 2u) % vertexCount;
+    indices.insert(indices.end(), { vertexIndex, vertexIndex + 1u, nextVertexIndex + 1u });
+    indices.insert(indices.end(), { vertexIndex, nextVertexIndex + 1u, nextVertexIndex });
+  }
+}
+
+// Narrows a field of view around its center, the way the inset of a quad view headset covers the middle of an eye
+XrFovf createInsetFov(const XrFovf& fov)
+{
+  const float centerX = (std::tan(fov.angleLeft) + std::tan(fov.angleRight)) * 0.5f;
+  const float centerY = (std::tan(fov.angleDown) + std::tan(fov.angleUp)) * 0.5f;
+
+  XrFovf insetFov;
+  insetFov.angleLeft = std::atan(centerX + (std::tan(fov.angleLeft) - centerX) * insetFovScale);
+  insetFov.angleRight = std::atan(centerX + (std::tan(fov.angleRight) - centerX) * insetFovScale);
+  insetFov.angleDown = std::atan(centerY + (std::tan(fov.angleDown) - centerY) * insetFovScale);
+  insetFov.angleUp = std::atan(centerY + (std::tan(fov.angleUp) - centerY) * insetFovScale);
+  return insetFov;
+}
 } // namespace
 
-Headset::Headset(const Context* context) : context(context)
+Headset::Headset(const Context* context, bool mockVisibilityMask, bool mockQuadViews, bool foveationRequested)
+: context(context), mockVisibilityMask(mockVisibilityMask),
+  foveated(foveationRequested && context->isFoveationSupported())
 {
+  xrGetVisibilityMaskKHR = context->getXrGetVisibilityMaskFunction();
+
   const VkDevice device = context->getVkDevice();
   const VkSampleCountFlagBits multisampleCount = context->getMultisampleCount();
 
+  const XrInstance xrInstance = context->getXrInstance();
+  const XrSystemId xrSystemId = context->getXrSystemId();
+  const XrViewConfigurationType viewType = context->getXrViewType();
+
+  // Get the number of eyes, which is also the number of views that are rendered in a single multiview pass
+  XrResult result = xrEnumerateViewConfigurationViews(xrInstance, xrSystemId, viewType, 0u,
+                                                      reinterpret_cast<uint32_t*>(&eyeCount), nullptr);
+  if (XR_FAILED(result))
+  {
+    util::error(Error::GenericOpenXR);
+    valid = false;
+    return;
+  }
+
+  // Get the eye image info per eye
+  eyeImageInfos.resize(eyeCount);
+  for (XrViewConfigurationView& eyeInfo : eyeImageInfos)
+  {
+    eyeInfo.type = XR_TYPE_VIEW_CONFIGURATION_VIEW;
+    eyeInfo.next = nullptr;
+  }
+
+  result =
+    xrEnumerateViewConfigurationViews(xrInstance, xrSystemId, viewType, static_cast<uint32_t>(eyeImageInfos.size()),
+                                      reinterpret_cast<uint32_t*>(&eyeCount), eyeImageInfos.data());
+  if (XR_FAILED(result))
+  {
+    util::error(Error::GenericOpenXR);
+    valid = false;
+    return;
+  }
+
+  // Without fragment density maps, foveate stereo views by rendering each eye at a lower resolution along with an inset
+  // at the pixel density of the eye, which are composited into the swapchain images after the render pass
+  multiResolution = foveationRequested && !foveated && !mockQuadViews &&
+                    viewType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+
+  // Add a mock inset for each stereo eye, at the same resolution as the eye so with a higher pixel density, or a real
+  // inset for multi-resolution rendering, at the part of the eye resolution that it covers
+  runtimeEyeCount = eyeCount;
+  if ((mockQuadViews || multiResolution) && viewType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO)
+  {
+    std::vector<XrViewConfigurationView> insetImageInfos = eyeImageInfos;
+    if (multiResolution)
+    {
+      for (XrViewConfigurationView& insetImageInfo : insetImageInfos)
+      {
+        const VkExtent2D insetResolution =
+          scaleResolution({ insetImageInfo.recommendedImageRectWidth, insetImageInfo.recommendedImageRectHeight },
+                          insetFovScale);
+        insetImageInfo.recommendedImageRectWidth = insetResolution.width;
+        insetImageInfo.recommendedImageRectHeight = insetResolution.height;
+      }
+    }
+
+    eyeImageInfos.insert(eyeImageInfos.end(), insetImageInfos.begin(), insetImageInfos.end());
+    eyeCount = eyeImageInfos.size();
+  }
+
+  if (eyeCount == 0u || eyeCount > static_cast<size_t>(context->getMaxMultiviewViewCount()))
+  {
+    util::error(Error::FeatureNotSupported, "Vulkan multiview view count");
+    valid = false;
+    return;
+  }
+
+  // All eyes render into layers of the same images, which are as large as the largest rendered eye resolution, each eye
+  // only uses the part of its layer that matches its own resolution. The swapchain images are as large as the largest
+  // eye resolution, which only differs with multi-resolution rendering
+  for (size_t eyeIndex = 0u; eyeIndex < eyeCount; ++eyeIndex)
+  {
+    const VkExtent2D renderedEyeResolution = getRenderedEyeResolution(eyeIndex);
+    renderResolution.width = std::max(renderResolution.width, renderedEyeResolution.width);
+    renderResolution.height = std::max(renderResolution.height, renderedEyeResolution.height);
+
+    const VkExtent2D eyeResolution = getEyeResolution(eyeIndex);
+    swapchainResolution.width = std::max(swapchainResolution.width, eyeResolution.width);
+    swapchainResolution.height = std::max(swapchainResolution.height, eyeResolution.height);
+  }
+
+  // Each texel of the fragment density map covers a block of pixels in the layer of an eye
+  if (foveated)
+  {
+    const VkExtent2D texelSize = context->getFragmentDensityTexelSize();
+    densityMapResolution.width = (renderResolution.width + texelSize.width - 1u) / texelSize.width;
+    densityMapResolution.height = (renderResolution.height + texelSize.height - 1u) / texelSize.height;
+  }
+
   // Create a render pass
   {
-    constexpr uint32_t viewMask = 0b00000011;
-    constexpr uint32_t correlationMask = 0b00000011;
+    // Render to every eye in a single pass, all eyes are spatially correlated
+    const uint32_t viewMask = (1u << static_cast<uint32_t>(eyeCount)) - 1u;
+    const uint32_t correlationMask = viewMask;
 
     VkRenderPassMultiviewCreateInfo renderPassMultiviewCreateInfo{
       VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO
@@ -80,6 +232,24 @@ Headset::Headset(const Context* context) : context(context)
     resolveAttachmentReference.attachment = 2u;
     resolveAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    // The fragment density map is only read, it is uploaded by the renderer before the render pass whenever it changes
+    VkAttachmentDescription densityMapAttachmentDescription{};
+    densityMapAttachmentDescription.format = densityMapFormat;
+    densityMapAttachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+    densityMapAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    densityMapAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    densityMapAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    densityMapAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    densityMapAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_FRAGMENT_DENSITY_MAP_OPTIMAL_EXT;
+    densityMapAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_FRAGMENT_DENSITY_MAP_OPTIMAL_EXT;
+
+    VkRenderPassFragmentDensityMapCreateInfoEXT renderPassFragmentDensityMapCreateInfo{
+      VK_STRUCTURE_TYPE_RENDER_PASS_FRAGMENT_DENSITY_MAP_CREATE_INFO_EXT
+    };
+    renderPassFragmentDensityMapCreateInfo.fragmentDensityMapAttachment.attachment = 3u;
+    renderPassFragmentDensityMapCreateInfo.fragmentDensityMapAttachment.layout =
+      VK_IMAGE_LAYOUT_FRAGMENT_DENSITY_MAP_OPTIMAL_EXT;
+
     // This subpass dependency waits with the transition to the color attachment optimal layout that takes place when
     // calling vkCmdBeginRenderPass() until the draw calls in the render pass are in the appropriate pipeline stages
     VkSubpassDependency subpassDependencyRenderPassBegin;
@@ -114,8 +284,13 @@ Headset::Headset(const Context* context) : context(context)
     subpassDescription.pDepthStencilAttachment = &depthAttachmentReference;
     subpassDescription.pResolveAttachments = &resolveAttachmentReference;
 
-    const std::array attachments = { colorAttachmentDescription, depthAttachmentDescription,
-                                     resolveAttachmentDescription };
+    std::vector<VkAttachmentDescription> attachments = { colorAttachmentDescription, depthAttachmentDescription,
+                                                         resolveAttachmentDescription };
+    if (foveated)
+    {
+      attachments.push_back(densityMapAttachmentDescription);
+      renderPassMultiviewCreateInfo.pNext = &renderPassFragmentDensityMapCreateInfo;
+    }
 
     const std::array subpassDependencies = { subpassDependencyRenderPassBegin, subpassDependencyRenderPassEnd };
 
@@ -145,8 +320,6 @@ Headset::Headset(const Context* context) : context(context)
 #endif
   }
 
-  const XrInstance xrInstance = context->getXrInstance();
-  const XrSystemId xrSystemId = context->getXrSystemId();
   const VkPhysicalDevice vkPhysicalDevice = context->getVkPhysicalDevice();
   const uint32_t vkDrawQueueFamilyIndex = context->getVkDrawQueueFamilyIndex();
 
@@ -161,7 +334,7 @@ Headset::Headset(const Context* context) : context(context)
   XrSessionCreateInfo sessionCreateInfo{ XR_TYPE_SESSION_CREATE_INFO };
   sessionCreateInfo.next = &graphicsBinding;
   sessionCreateInfo.systemId = xrSystemId;
-  XrResult result = xrCreateSession(xrInstance, &sessionCreateInfo, &session);
+  result = xrCreateSession(xrInstance, &sessionCreateInfo, &session);
   if (XR_FAILED(result))
   {
     util::error(Error::GenericOpenXR);
@@ -181,29 +354,9 @@ Headset::Headset(const Context* context) : context(context)
     return;
   }
 
-  const XrViewConfigurationType viewType = context->getXrViewType();
-
-  // Get the number of eyes
-  result = xrEnumerateViewConfigurationViews(xrInstance, xrSystemId, viewType, 0u,
-                                             reinterpret_cast<uint32_t*>(&eyeCount), nullptr);
-  if (XR_FAILED(result))
-  {
-    util::error(Error::GenericOpenXR);
-    valid = false;
-    return;
-  }
-
-  // Get the eye image info per eye
-  eyeImageInfos.resize(eyeCount);
-  for (XrViewConfigurationView& eyeInfo : eyeImageInfos)
-  {
-    eyeInfo.type = XR_TYPE_VIEW_CONFIGURATION_VIEW;
-    eyeInfo.next = nullptr;
-  }
-
-  result =
-    xrEnumerateViewConfigurationViews(xrInstance, xrSystemId, viewType, static_cast<uint32_t>(eyeImageInfos.size()),
-                                      reinterpret_cast<uint32_t*>(&eyeCount), eyeImageInfos.data());
+  // Create a view space, which tracks the head, to move the eyes along with a newer head pose when late latching
+  referenceSpaceCreateInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW;
+  result = xrCreateReferenceSpace(session, &referenceSpaceCreateInfo, &viewSpace);
   if (XR_FAILED(result))
   {
     util::error(Error::GenericOpenXR);
@@ -211,13 +364,14 @@ Headset::Headset(const Context* context) : context(context)
     return;
   }
 
-  // Allocate the eye poses
-  eyePoses.resize(eyeCount);
+  // Allocate the eye poses, which are only located for the eyes of the runtime
+  eyePoses.resize(runtimeEyeCount);
   for (XrView& eyePose : eyePoses)
   {
     eyePose.type = XR_TYPE_VIEW;
     eyePose.next = nullptr;
   }
+  eyeHeadMatrices.resize(runtimeEyeCount);
 
   // Verify that the desired color format is supported
   {
@@ -257,11 +411,9 @@ Headset::Headset(const Context* context) : context(context)
     }
   }
 
-  const VkExtent2D eyeResolution = getEyeResolution(0u);
-
   // Create a color buffer
-  colorBuffer = new ImageBuffer(context, eyeResolution, colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-                                context->getMultisampleCount(), VK_IMAGE_ASPECT_COLOR_BIT, 2u);
+  colorBuffer = new ImageBuffer(context, renderResolution, colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                context->getMultisampleCount(), VK_IMAGE_ASPECT_COLOR_BIT, eyeCount);
   if (!colorBuffer->isValid())
   {
     valid = false;
@@ -269,28 +421,58 @@ Headset::Headset(const Context* context) : context(context)
   }
 
   // Create a depth buffer
-  depthBuffer = new ImageBuffer(context, eyeResolution, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                                context->getMultisampleCount(), VK_IMAGE_ASPECT_DEPTH_BIT, 2u);
+  depthBuffer = new ImageBuffer(context, renderResolution, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                context->getMultisampleCount(), VK_IMAGE_ASPECT_DEPTH_BIT, eyeCount);
   if (!depthBuffer->isValid())
   {
     valid = false;
     return;
   }
 
+  // Create a fragment density map with a layer per eye, which makes the GPU shade coarser away from the foveal centers
+  if (foveated)
+  {
+    densityMap = new ImageBuffer(context, densityMapResolution, densityMapFormat,
+                                 VK_IMAGE_USAGE_FRAGMENT_DENSITY_MAP_BIT_EXT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                 VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT, eyeCount);
+    if (!densityMap->isValid())
+    {
+      valid = false;
+      return;
+    }
+  }
+
+  // Create a multi-resolution buffer that the render pass resolves into instead of the swapchain images
+  if (multiResolution)
+  {
+    multiResolutionBuffer = new ImageBuffer(context, renderResolution, colorFormat,
+                                            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                            VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT, eyeCount);
+    if (!multiResolutionBuffer->isValid())
+    {
+      valid = false;
+      return;
+    }
+  }
+
   // Create a swapchain and render targets
   {
     const XrViewConfigurationView& eyeImageInfo = eyeImageInfos.at(0u);
 
-    // Create a swapchain
+    // Create a swapchain, with multi-resolution rendering it only holds the composited eyes of the runtime
     XrSwapchainCreateInfo swapchainCreateInfo{ XR_TYPE_SWAPCHAIN_CREATE_INFO };
     swapchainCreateInfo.format = colorFormat;
     swapchainCreateInfo.sampleCount = eyeImageInfo.recommendedSwapchainSampleCount;
-    swapchainCreateInfo.width = eyeImageInfo.recommendedImageRectWidth;
-    swapchainCreateInfo.height = eyeImageInfo.recommendedImageRectHeight;
-    swapchainCreateInfo.arraySize = static_cast<uint32_t>(eyeCount);
+    swapchainCreateInfo.width = swapchainResolution.width;
+    swapchainCreateInfo.height = swapchainResolution.height;
+    swapchainCreateInfo.arraySize = static_cast<uint32_t>(multiResolution ? runtimeEyeCount : eyeCount);
     swapchainCreateInfo.faceCount = 1u;
     swapchainCreateInfo.mipCount = 1u;
     swapchainCreateInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_TRANSFER_SRC_BIT;
+    if (multiResolution)
+    {
+      swapchainCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+    }
 
     result = xrCreateSwapchain(session, &swapchainCreateInfo, &swapchain);
     if (XR_FAILED(result))
@@ -336,7 +518,9 @@ Headset::Headset(const Context* context) : context(context)
 
       const VkImage image = swapchainImages.at(renderTargetIndex).image;
       renderTarget = new RenderTarget(device, image, colorBuffer->getImageView(), depthBuffer->getImageView(),
-                                      eyeResolution, colorFormat, renderPass, 2u);
+                                      renderResolution, colorFormat, renderPass, static_cast<uint32_t>(eyeCount),
+                                      densityMap ? densityMap->getImageView() : nullptr,
+                                      multiResolutionBuffer ? multiResolutionBuffer->getImageView() : nullptr);
       if (!renderTarget->isValid())
       {
         valid = false;
@@ -396,6 +580,11 @@ Headset::~Headset()
     delete renderTarget;
   }
 
+  if (viewSpace)
+  {
+    xrDestroySpace(viewSpace);
+  }
+
   if (space)
   {
     xrDestroySpace(space);
@@ -407,6 +596,16 @@ Headset::~Headset()
   }
 
   // Clean up Vulkan
+  if (multiResolutionBuffer)
+  {
+    delete multiResolutionBuffer;
+  }
+
+  if (densityMap)
+  {
+    delete densityMap;
+  }
+
   if (depthBuffer)
   {
     delete depthBuffer;
@@ -424,7 +623,7 @@ Headset::~Headset()
   }
 }
 
-Headset::BeginFrameResult Headset::beginFrame(uint32_t& swapchainImageIndex)
+Headset::BeginFrameResult Headset::waitFrame(XrFrameState& frameState)
 {
   const XrInstance instance = context->getXrInstance();
 
@@ -464,6 +663,9 @@ Headset::BeginFrameResult Headset::beginFrame(uint32_t& swapchainImageIndex)
 
       break;
     }
+    case XR_TYPE_EVENT_DATA_VISIBILITY_MASK_CHANGED_KHR:
+      ++visibilityMaskGeneration;
+      break;
     }
 
     buffer.type = XR_TYPE_EVENT_DATA_BUFFER;
@@ -480,16 +682,28 @@ Headset::BeginFrameResult Headset::beginFrame(uint32_t& swapchainImageIndex)
   // Wait for the new frame
   frameState.type = XR_TYPE_FRAME_STATE;
   XrFrameWaitInfo frameWaitInfo{ XR_TYPE_FRAME_WAIT_INFO };
-  XrResult result = xrWaitFrame(session, &frameWaitInfo, &frameState);
+  const XrResult result = xrWaitFrame(session, &frameWaitInfo, &frameState);
   if (XR_FAILED(result))
   {
     util::error(Error::GenericOpenXR);
     return BeginFrameResult::Error;
   }
 
+  if (!frameState.shouldRender)
+  {
+    return BeginFrameResult::SkipRender;
+  }
+
+  return BeginFrameResult::RenderFully;
+}
+
+Headset::BeginFrameResult Headset::beginFrame(const XrFrameState& frameState, uint32_t& swapchainImageIndex)
+{
+  this->frameState = frameState;
+
   // Begin the new frame
   XrFrameBeginInfo frameBeginInfo{ XR_TYPE_FRAME_BEGIN_INFO };
-  result = xrBeginFrame(session, &frameBeginInfo);
+  XrResult result = xrBeginFrame(session, &frameBeginInfo);
   if (XR_FAILED(result))
   {
     util::error(Error::GenericOpenXR);
@@ -497,78 +711,109 @@ Headset::BeginFrameResult Headset::beginFrame(uint32_t& swapchainImageIndex)
   }
 
   // Update the eye poses
+  if (!updateEyePoses())
+  {
+    return BeginFrameResult::Error;
+  }
+
+  // Acquire the swapchain image
+  XrSwapchainImageAcquireInfo swapchainImageAcquireInfo{ XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
+  result = xrAcquireSwapchainImage(swapchain, &swapchainImageAcquireInfo, &swapchainImageIndex);
+  if (XR_FAILED(result))
+  {
+    util::error(Error::GenericOpenXR);
+    return BeginFrameResult::Error;
+  }
+
+  // Wait for the swapchain image
+  XrSwapchainImageWaitInfo swapchainImageWaitInfo{ XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
+  swapchainImageWaitInfo.timeout = XR_INFINITE_DURATION;
+  result = xrWaitSwapchainImage(swapchain, &swapchainImageWaitInfo);
+  if (XR_FAILED(result))
+  {
+    util::error(Error::GenericOpenXR);
+    return BeginFrameResult::Error;
+  }
+
+  if (!frameState.shouldRender)
+  {
+    return BeginFrameResult::SkipRender;
+  }
+
+  return BeginFrameResult::RenderFully;
+}
+
+bool Headset::updateEyePoses()
+{
   viewState.type = XR_TYPE_VIEW_STATE;
   uint32_t viewCount;
   XrViewLocateInfo viewLocateInfo{ XR_TYPE_VIEW_LOCATE_INFO };
   viewLocateInfo.viewConfigurationType = context->getXrViewType();
   viewLocateInfo.displayTime = frameState.predictedDisplayTime;
   viewLocateInfo.space = space;
-  result = xrLocateViews(session, &viewLocateInfo, &viewState, static_cast<uint32_t>(eyePoses.size()), &viewCount,
-                         eyePoses.data());
+  XrResult result = xrLocateViews(session, &viewLocateInfo, &viewState, static_cast<uint32_t>(eyePoses.size()),
+                                  &viewCount, eyePoses.data());
   if (XR_FAILED(result))
   {
     util::error(Error::GenericOpenXR);
-    return BeginFrameResult::Error;
+    return false;
   }
 
-  if (viewCount != eyeCount)
+  if (viewCount != runtimeEyeCount)
   {
     util::error(Error::GenericOpenXR);
-    return BeginFrameResult::Error;
+    return false;
   }
 
   if ((viewState.viewStateFlags & XR_VIEW_STATE_POSITION_VALID_BIT) == 0)
   {
     util::error(Error::GenericOpenXR);
-    return BeginFrameResult::Error;
+    return false;
   }
 
   if ((viewState.viewStateFlags & XR_VIEW_STATE_ORIENTATION_VALID_BIT) == 0)
   {
     util::error(Error::GenericOpenXR);
-    return BeginFrameResult::Error;
+    return false;
   }
 
-  // Update the eye render infos, view and projection matrices
-  for (size_t eyeIndex = 0u; eyeIndex < eyeCount; ++eyeIndex)
+  // Remember where the eyes are relative to the head, so that they can be moved along with a newer head pose
+  XrSpaceLocation headLocation{ XR_TYPE_SPACE_LOCATION };
+  result = xrLocateSpace(viewSpace, space, frameState.predictedDisplayTime, &headLocation);
+  if (XR_FAILED(result))
   {
-    // Copy the eye poses into the eye render infos
-    XrCompositionLayerProjectionView& eyeRenderInfo = eyeRenderInfos.at(eyeIndex);
-    const XrView& eyePose = eyePoses.at(eyeIndex);
-    eyeRenderInfo.pose = eyePose.pose;
-    eyeRenderInfo.fov = eyePose.fov;
-
-    // Update the view and projection matrices
-    const XrPosef& pose = eyeRenderInfo.pose;
-    eyeViewMatrices.at(eyeIndex) = glm::inverse(util::poseToMatrix(pose));
-    eyeProjectionMatrices.at(eyeIndex) = util::createProjectionMatrix(eyeRenderInfo.fov, 0.01f, 250.0f);
+    util::error(Error::GenericOpenXR);
+    return false;
   }
 
-  // Acquire the swapchain image
-  XrSwapchainImageAcquireInfo swapchainImageAcquireInfo{ XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
-  result = xrAcquireSwapchainImage(swapchain, &swapchainImageAcquireInfo, &swapchainImageIndex);
-  if (XR_FAILED(result))
+  eyeHeadMatricesValid = util::isTracked(headLocation.locationFlags);
+  if (eyeHeadMatricesValid)
   {
-    util::error(Error::GenericOpenXR);
-    return BeginFrameResult::Error;
+    const glm::mat4 inverseHeadMatrix = glm::inverse(util::poseToMatrix(headLocation.pose));
+    for (size_t eyeIndex = 0u; eyeIndex < runtimeEyeCount; ++eyeIndex)
+    {
+      eyeHeadMatrices.at(eyeIndex) = inverseHeadMatrix * util::poseToMatrix(eyePoses.at(eyeIndex).pose);
+    }
   }
 
-  // Wait for the swapchain image
-  XrSwapchainImageWaitInfo swapchainImageWaitInfo{ XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
-  swapchainImageWaitInfo.timeout = XR_INFINITE_DURATION;
-  result = xrWaitSwapchainImage(swapchain, &swapchainImageWaitInfo);
-  if (XR_FAILED(result))
+  updateEyeMatrices();
+  return true;
+}
+
+bool Headset::latchEyePoses(const glm::mat4& headPose)
+{
+  if (!eyeHeadMatricesValid)
   {
-    util::error(Error::GenericOpenXR);
-    return BeginFrameResult::Error;
+    return false;
   }
 
-  if (!frameState.shouldRender)
+  for (size_t eyeIndex = 0u; eyeIndex < runtimeEyeCount; ++eyeIndex)
   {
-    return BeginFrameResult::SkipRender;
+    eyePoses.at(eyeIndex).pose = util::matrixToPose(headPose * eyeHeadMatrices.at(eyeIndex));
   }
 
-  return BeginFrameResult::RenderFully;
+  updateEyeMatrices();
+  return true;
 }
 
 void Headset::endFrame() const
@@ -585,7 +830,7 @@ void Headset::endFrame() const
   // End the frame
   XrCompositionLayerProjection compositionLayerProjection{ XR_TYPE_COMPOSITION_LAYER_PROJECTION };
   compositionLayerProjection.space = space;
-  compositionLayerProjection.viewCount = static_cast<uint32_t>(eyeRenderInfos.size());
+  compositionLayerProjection.viewCount = static_cast<uint32_t>(runtimeEyeCount); // Without the mock insets
   compositionLayerProjection.views = eyeRenderInfos.data();
 
   std::vector<XrCompositionLayerBaseHeader*> layers;
@@ -648,6 +893,29 @@ VkExtent2D Headset::getEyeResolution(size_t eyeIndex) const
   return { eyeInfo.recommendedImageRectWidth, eyeInfo.recommendedImageRectHeight };
 }
 
+void Headset::setResolutionScale(float scale)
+{
+  resolutionScale = scale;
+
+  // Tell the runtime which part of its layer each eye has been rendered to
+  for (size_t eyeIndex = 0u; eyeIndex < eyeRenderInfos.size(); ++eyeIndex)
+  {
+    const VkExtent2D eyeResolution = getScaledEyeResolution(eyeIndex);
+    eyeRenderInfos.at(eyeIndex).subImage.imageRect.extent = { static_cast<int32_t>(eyeResolution.width),
+                                                              static_cast<int32_t>(eyeResolution.height) };
+  }
+}
+
+VkExtent2D Headset::getScaledEyeResolution(size_t eyeIndex) const
+{
+  return scaleResolution(getEyeResolution(eyeIndex), resolutionScale);
+}
+
+VkExtent2D Headset::getScaledRenderResolution() const
+{
+  return scaleResolution(renderResolution, resolutionScale);
+}
+
 glm::mat4 Headset::getEyeViewMatrix(size_t eyeIndex) const
 {
   return eyeViewMatrices.at(eyeIndex);
@@ -658,11 +926,296 @@ glm::mat4 Headset::getEyeProjectionMatrix(size_t eyeIndex) const
   return eyeProjectionMatrices.at(eyeIndex);
 }
 
+bool Headset::getVisibilityMask(size_t eyeIndex,
+                                std::vector<glm::vec2>& vertices,
+                                std::vector<uint32_t>& indices) const
+{
+  // An inset only covers the middle of its eye, where nothing is hidden by the lens
+  if (eyeIndex >= runtimeEyeCount)
+  {
+    vertices.clear();
+    indices.clear();
+    return true;
+  }
+
+  if (!xrGetVisibilityMaskKHR)
+  {
+    if (mockVisibilityMask)
+    {
+      createMockVisibilityMask(eyeRenderInfos.at(eyeIndex).fov, vertices, indices);
+    }
+    else
+    {
+      vertices.clear();
+      indices.clear();
+    }
+
+    return true;
+  }
+
+  // Get the number of vertices and indices
+  XrVisibilityMaskKHR visibilityMask{ XR_TYPE_VISIBILITY_MASK_KHR };
+  XrResult result =
+    xrGetVisibilityMaskKHR(session, context->getXrViewType(), static_cast<uint32_t>(eyeIndex),
+                           XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR, &visibilityMask);
+  if (XR_FAILED(result))
+  {
+    util::error(Error::GenericOpenXR);
+    return false;
+  }
+
+  // Retrieve the vertices and indices, glm::vec2 matches the layout of XrVector2f
+  vertices.resize(visibilityMask.vertexCountOutput);
+  indices.resize(visibilityMask.indexCountOutput);
+  visibilityMask.vertexCapacityInput = visibilityMask.vertexCountOutput;
+  visibilityMask.vertices = reinterpret_cast<XrVector2f*>(vertices.data());
+  visibilityMask.indexCapacityInput = visibilityMask.indexCountOutput;
+  visibilityMask.indices = indices.data();
+  result = xrGetVisibilityMaskKHR(session, context->getXrViewType(), static_cast<uint32_t>(eyeIndex),
+                                  XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR, &visibilityMask);
+  if (XR_FAILED(result))
+  {
+    util::error(Error::GenericOpenXR);
+    return false;
+  }
+
+  vertices.resize(visibilityMask.vertexCountOutput);
+  indices.resize(visibilityMask.indexCountOutput);
+  return true;
+}
+
+size_t Headset::getVisibilityMaskGeneration() const
+{
+  return visibilityMaskGeneration;
+}
+
+bool Headset::isFoveated() const
+{
+  return foveated;
+}
+
+VkImage Headset::getDensityMapImage() const
+{
+  return densityMap ? densityMap->getImage() : nullptr;
+}
+
+VkExtent2D Headset::getDensityMapResolution() const
+{
+  return densityMapResolution;
+}
+
+bool Headset::isMultiResolution() const
+{
+  return multiResolution;
+}
+
+void Headset::recordMultiResolutionComposite(VkCommandBuffer commandBuffer, size_t swapchainImageIndex) const
+{
+  const VkImage sourceImage = multiResolutionBuffer->getImage();
+  const VkImage destinationImage = swapchainRenderTargets.at(swapchainImageIndex)->getImage();
+
+  // Transition the multi-resolution buffer to the transfer source optimal layout and the layers of the OpenXR swapchain
+  // image to the transfer destination optimal layout. Also ensure that all color attachment write access in the color
+  // attachment output stage has concluded in the multi-resolution buffer before allowing any transfer read access in
+  // the transfer stage.
+  {
+    VkImageMemoryBarrier sourceImageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    sourceImageMemoryBarrier.image = sourceImage;
+    sourceImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    sourceImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sourceImageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    sourceImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    sourceImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    sourceImageMemoryBarrier.subresourceRange.layerCount = static_cast<uint32_t>(eyeCount);
+    sourceImageMemoryBarrier.subresourceRange.baseArrayLayer = 0u;
+    sourceImageMemoryBarrier.subresourceRange.levelCount = 1u;
+    sourceImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    VkImageMemoryBarrier destinationImageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    destinationImageMemoryBarrier.image = destinationImage;
+    destinationImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    destinationImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    destinationImageMemoryBarrier.srcAccessMask = VK_ACCESS_NONE;
+    destinationImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    destinationImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    destinationImageMemoryBarrier.subresourceRange.layerCount = static_cast<uint32_t>(runtimeEyeCount);
+    destinationImageMemoryBarrier.subresourceRange.baseArrayLayer = 0u;
+    destinationImageMemoryBarrier.subresourceRange.levelCount = 1u;
+    destinationImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    const std::array imageMemoryBarriers = { sourceImageMemoryBarrier, destinationImageMemoryBarrier };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_DEPENDENCY_BY_REGION_BIT, 0u, nullptr, 0u, nullptr,
+                         static_cast<uint32_t>(imageMemoryBarriers.size()), imageMemoryBarriers.data());
+  }
+
+  // Upscale the low resolution image of each eye into its layer, only the part at the current resolution scale has
+  // been rendered
+  std::vector<VkImageBlit> eyeBlits(runtimeEyeCount), insetBlits(runtimeEyeCount);
+  for (size_t eyeIndex = 0u; eyeIndex < runtimeEyeCount; ++eyeIndex)
+  {
+    const VkExtent2D sourceExtent = scaleResolution(getRenderedEyeResolution(eyeIndex), resolutionScale);
+    const VkExtent2D destinationExtent = getScaledEyeResolution(eyeIndex);
+
+    VkImageBlit& eyeBlit = eyeBlits.at(eyeIndex);
+    eyeBlit.srcOffsets[0] = { 0, 0, 0 };
+    eyeBlit.srcOffsets[1] = { static_cast<int32_t>(sourceExtent.width), static_cast<int32_t>(sourceExtent.height), 1 };
+    eyeBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    eyeBlit.srcSubresource.mipLevel = 0u;
+    eyeBlit.srcSubresource.baseArrayLayer = static_cast<uint32_t>(eyeIndex);
+    eyeBlit.srcSubresource.layerCount = 1u;
+
+    eyeBlit.dstOffsets[0] = { 0, 0, 0 };
+    eyeBlit.dstOffsets[1] = { static_cast<int32_t>(destinationExtent.width),
+                              static_cast<int32_t>(destinationExtent.height), 1 };
+    eyeBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    eyeBlit.dstSubresource.layerCount = 1u;
+    eyeBlit.dstSubresource.baseArrayLayer = static_cast<uint32_t>(eyeIndex);
+    eyeBlit.dstSubresource.mipLevel = 0u;
+
+    // The inset covers the middle of its eye, at about the same pixel density
+    const size_t insetIndex = runtimeEyeCount + eyeIndex;
+    const VkExtent2D insetExtent = getScaledEyeResolution(insetIndex);
+    const glm::vec2 insetMinimum = glm::vec2(destinationExtent.width, destinationExtent.height) *
+                                   (1.0f - insetFovScale) * 0.5f;
+    const glm::vec2 insetMaximum = glm::vec2(destinationExtent.width, destinationExtent.height) *
+                                   (1.0f + insetFovScale) * 0.5f;
+
+    VkImageBlit& insetBlit = insetBlits.at(eyeIndex);
+    insetBlit.srcOffsets[0] = { 0, 0, 0 };
+    insetBlit.srcOffsets[1] = { static_cast<int32_t>(insetExtent.width), static_cast<int32_t>(insetExtent.height), 1 };
+    insetBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    insetBlit.srcSubresource.mipLevel = 0u;
+    insetBlit.srcSubresource.baseArrayLayer = static_cast<uint32_t>(insetIndex);
+    insetBlit.srcSubresource.layerCount = 1u;
+
+    insetBlit.dstOffsets[0] = { static_cast<int32_t>(std::round(insetMinimum.x)),
+                                static_cast<int32_t>(std::round(insetMinimum.y)), 0 };
+    insetBlit.dstOffsets[1] = { static_cast<int32_t>(std::round(insetMaximum.x)),
+                                static_cast<int32_t>(std::round(insetMaximum.y)), 1 };
+    insetBlit.dstSubresource = eyeBlit.dstSubresource;
+  }
+
+  vkCmdBlitImage(commandBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destinationImage,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(eyeBlits.size()), eyeBlits.data(),
+                 VK_FILTER_LINEAR);
+
+  // Ensure that the upscaled eyes have been written before the insets overwrite their middle
+  {
+    VkImageMemoryBarrier destinationImageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    destinationImageMemoryBarrier.image = destinationImage;
+    destinationImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    destinationImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    destinationImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    destinationImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    destinationImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    destinationImageMemoryBarrier.subresourceRange.layerCount = static_cast<uint32_t>(runtimeEyeCount);
+    destinationImageMemoryBarrier.subresourceRange.baseArrayLayer = 0u;
+    destinationImageMemoryBarrier.subresourceRange.levelCount = 1u;
+    destinationImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_DEPENDENCY_BY_REGION_BIT, 0u, nullptr, 0u, nullptr, 1u, &destinationImageMemoryBarrier);
+  }
+
+  vkCmdBlitImage(commandBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destinationImage,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(insetBlits.size()), insetBlits.data(),
+                 VK_FILTER_LINEAR);
+
+  // Transition both images back to the color attachment optimal layout. Also ensure that all transfer access in the
+  // transfer stage has concluded before the next render pass writes to the multi-resolution buffer again, and before
+  // the swapchain image is mirrored or handed to the runtime.
+  {
+    VkImageMemoryBarrier sourceImageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    sourceImageMemoryBarrier.image = sourceImage;
+    sourceImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sourceImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    sourceImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    sourceImageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    sourceImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    sourceImageMemoryBarrier.subresourceRange.layerCount = static_cast<uint32_t>(eyeCount);
+    sourceImageMemoryBarrier.subresourceRange.baseArrayLayer = 0u;
+    sourceImageMemoryBarrier.subresourceRange.levelCount = 1u;
+    sourceImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    VkImageMemoryBarrier destinationImageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    destinationImageMemoryBarrier.image = destinationImage;
+    destinationImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    destinationImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    destinationImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    destinationImageMemoryBarrier.dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+    destinationImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    destinationImageMemoryBarrier.subresourceRange.layerCount = static_cast<uint32_t>(runtimeEyeCount);
+    destinationImageMemoryBarrier.subresourceRange.baseArrayLayer = 0u;
+    destinationImageMemoryBarrier.subresourceRange.levelCount = 1u;
+    destinationImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    const std::array imageMemoryBarriers = { sourceImageMemoryBarrier, destinationImageMemoryBarrier };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_DEPENDENCY_BY_REGION_BIT, 0u, nullptr, 0u, nullptr,
+                         static_cast<uint32_t>(imageMemoryBarriers.size()), imageMemoryBarriers.data());
+  }
+}
+
+size_t Headset::getRenderTargetCount() const
+{
+  return swapchainRenderTargets.size();
+}
+
 RenderTarget* Headset::getRenderTarget(size_t swapchainImageIndex) const
 {
   return swapchainRenderTargets.at(swapchainImageIndex);
 }
 
+void Headset::updateEyeMatrices()
+{
+  for (size_t eyeIndex = 0u; eyeIndex < eyeCount; ++eyeIndex)
+  {
+    // Copy the eye poses into the eye render infos, an inset shares the pose of its eye
+    XrCompositionLayerProjectionView& eyeRenderInfo = eyeRenderInfos.at(eyeIndex);
+    if (eyeIndex < runtimeEyeCount)
+    {
+      const XrView& eyePose = eyePoses.at(eyeIndex);
+      eyeRenderInfo.pose = eyePose.pose;
+      eyeRenderInfo.fov = eyePose.fov;
+    }
+    else
+    {
+      const XrView& eyePose = eyePoses.at(eyeIndex - runtimeEyeCount);
+      eyeRenderInfo.pose = eyePose.pose;
+      eyeRenderInfo.fov = createInsetFov(eyePose.fov);
+    }
+
+    // Update the view and projection matrices
+    const XrPosef& pose = eyeRenderInfo.pose;
+    eyeViewMatrices.at(eyeIndex) = glm::inverse(util::poseToMatrix(pose));
+    eyeProjectionMatrices.at(eyeIndex) = util::createProjectionMatrix(eyeRenderInfo.fov, 0.01f, 250.0f);
+
+    // Squeeze the image of an eye with a lower resolution into its part of the shared viewport
+    const VkExtent2D eyeResolution = getRenderedEyeResolution(eyeIndex);
+    if (eyeResolution.width != renderResolution.width || eyeResolution.height != renderResolution.height)
+    {
+      const glm::vec2 rectScale = glm::vec2(eyeResolution.width, eyeResolution.height) /
+                                  glm::vec2(renderResolution.width, renderResolution.height);
+      const glm::mat4 viewportMatrix =
+        glm::scale(glm::translate(glm::mat4(1.0f), { rectScale - 1.0f, 0.0f }), { rectScale, 1.0f });
+      eyeProjectionMatrices.at(eyeIndex) = viewportMatrix * eyeProjectionMatrices.at(eyeIndex);
+    }
+  }
+}
+
+VkExtent2D Headset::getRenderedEyeResolution(size_t eyeIndex) const
+{
+  const VkExtent2D eyeResolution = getEyeResolution(eyeIndex);
+  if (multiResolution && eyeIndex < runtimeEyeCount)
+  {
+    return scaleResolution(eyeResolution, multiResolutionScale);
+  }
+
+  return eyeResolution;
+}
+
 bool Headset::beginSession() const
 {
   // Start the session
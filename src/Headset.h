@@ -6,6 +6,7 @@
 
 #include <vulkan/vulkan.h>
 
+#include <atomic>
 #include <vector>
 
 class Context;
@@ -16,12 +17,24 @@ class RenderTarget;
  * The headset class facilitates rendering into the device. It holds functionality to begin and end rendering a frame,
  * to find out when the user has quit the application through the headset's operating system, as opposed to the mirror
  * view window, and to retrieve the current orientation of the device. It relies on both OpenXR and Vulkan to provide
- * these features.
+ * these features. Waiting for a frame is separate from beginning it, so that the wait for the next frame can overlap
+ * with rendering the current one. It also provides the area of each eye that cannot be seen through the lenses, which
+ * the runtime may change at any time, or a mock of it that hides the corners of each eye if requested. Likewise, stereo
+ * views can be extended by two mock inset views with a narrower field of view, which are rendered like the insets of a
+ * quad view headset but not handed to the runtime. If the device supports fragment density maps, the headset views can
+ * be rendered foveated, the density map with a layer per eye is attached to the render pass and is written by the
+ * renderer. Otherwise stereo views fall back to multi-resolution rendering, each eye is rendered at a lower resolution
+ * along with a real inset, and both are composited into the swapchain images after the render pass. The images are
+ * allocated at the full resolution, but each frame may only render to a part of them at a lower resolution scale, which
+ * is passed on to the runtime.
  */
 class Headset final
 {
 public:
-  Headset(const Context* context);
+  Headset(const Context* context,
+          bool mockVisibilityMask,  // Only mocked if the runtime provides no mask
+          bool mockQuadViews,       // Only mocked if the runtime provides stereo views
+          bool foveationRequested); // Falls back to multi-resolution rendering without fragment density maps
   ~Headset();
 
   enum class BeginFrameResult
@@ -31,43 +44,80 @@ public:
     SkipRender,  // Process this frame but skip rendering
     SkipFully    // Skip processing this frame entirely without ending it
   };
-  BeginFrameResult beginFrame(uint32_t& swapchainImageIndex);
-  void endFrame() const;
+  BeginFrameResult waitFrame(XrFrameState& frameState); // Polls events and blocks until the next frame should start
+  BeginFrameResult beginFrame(const XrFrameState& frameState, uint32_t& swapchainImageIndex);
+  bool updateEyePoses(); // Locates the eyes for the frame that was last begun again, call late to use the newest poses
+  // Moves the eyes of the frame that was last begun along with a newer head pose in stage space, without any OpenXR
+  // calls, returns false if the head could not be located when the eyes were last located
+  bool latchEyePoses(const glm::mat4& headPose);
+  void endFrame() const; // Ends the frame that was last begun
 
   bool isValid() const;
   bool isExitRequested() const;
 
   XrSession getXrSession() const;
   XrSpace getXrSpace() const;
-  XrFrameState getXrFrameState() const;
+  XrFrameState getXrFrameState() const; // Of the frame that was last begun
 
   VkRenderPass getVkRenderPass() const;
 
   size_t getEyeCount() const;
-  VkExtent2D getEyeResolution(size_t eyeIndex) const;
+  VkExtent2D getEyeResolution(size_t eyeIndex) const; // The part of the shared images that the eye covers
+
+  // Renders the current frame into the top left part of the images only, call from the render thread before recording
+  void setResolutionScale(float scale);
+  VkExtent2D getScaledEyeResolution(size_t eyeIndex) const; // The part of the eye resolution that is rendered
+  VkExtent2D getScaledRenderResolution() const;             // The part of the render resolution that is rendered
+
   glm::mat4 getEyeViewMatrix(size_t eyeIndex) const;
   glm::mat4 getEyeProjectionMatrix(size_t eyeIndex) const;
 
+  // Returns the hidden triangles of an eye in view space on the plane z = -1, which are empty if there is no mask, or
+  // false on error. Call from the render thread after beginning a frame, the mock depends on the field of view
+  bool getVisibilityMask(size_t eyeIndex, std::vector<glm::vec2>& vertices, std::vector<uint32_t>& indices) const;
+  size_t getVisibilityMaskGeneration() const; // Increases whenever the mask of any eye changes
+
+  bool isFoveated() const;
+  VkImage getDensityMapImage() const; // Only if foveated, with two 8-bit normalized densities per texel
+  VkExtent2D getDensityMapResolution() const;
+
+  bool isMultiResolution() const;
+  // Upscales each eye into its layer of the swapchain image and draws its inset on top, call after the render pass
+  void recordMultiResolutionComposite(VkCommandBuffer commandBuffer, size_t swapchainImageIndex) const;
+
+  size_t getRenderTargetCount() const;
   RenderTarget* getRenderTarget(size_t swapchainImageIndex) const;
 
 private:
   bool valid = true;
-  bool exitRequested = false;
+  std::atomic<bool> exitRequested = false; // Set on the frame pacing thread
 
   const Context* context = nullptr;
-
-  size_t eyeCount = 0u;
+  PFN_xrGetVisibilityMaskKHR xrGetVisibilityMaskKHR = nullptr; // Optional
+  bool mockVisibilityMask = false;
+  std::atomic<size_t> visibilityMaskGeneration = 1u; // Set on the frame pacing thread
+  bool foveated = false;
+  bool multiResolution = false;
+
+  size_t eyeCount = 0u;        // Also the number of views, such as four with a high resolution inset per eye
+  size_t runtimeEyeCount = 0u; // The eyes that the runtime provides, the insets follow them
+  VkExtent2D renderResolution = { 0u, 0u };
+  VkExtent2D swapchainResolution = { 0u, 0u };
+  float resolutionScale = 1.0f; // Of the current frame
   std::vector<glm::mat4> eyeViewMatrices;
   std::vector<glm::mat4> eyeProjectionMatrices;
 
   XrSession session = nullptr;
   XrSessionState sessionState = XR_SESSION_STATE_UNKNOWN;
   XrSpace space = nullptr;
+  XrSpace viewSpace = nullptr; // Tracks the head
   XrFrameState frameState = {};
   XrViewState viewState = {};
 
   std::vector<XrViewConfigurationView> eyeImageInfos;
   std::vector<XrView> eyePoses;
+  std::vector<glm::mat4> eyeHeadMatrices; // Transform from each eye of the runtime to the head, when last located
+  bool eyeHeadMatricesValid = false;
   std::vector<XrCompositionLayerProjectionView> eyeRenderInfos;
 
   XrSwapchain swapchain = nullptr;
@@ -76,7 +126,12 @@ private:
   VkRenderPass renderPass = nullptr;
 
   ImageBuffer *colorBuffer = nullptr, *depthBuffer = nullptr;
+  ImageBuffer* densityMap = nullptr;            // Optional
+  ImageBuffer* multiResolutionBuffer = nullptr; // Optional, resolved into instead of the swapchain images
+  VkExtent2D densityMapResolution = { 0u, 0u };
 
+  VkExtent2D getRenderedEyeResolution(size_t eyeIndex) const; // Lower than the eye resolution with multi-resolution
+  void updateEyeMatrices(); // Updates the eye render infos, view and projection matrices from the eye poses
   bool beginSession() const;
   bool endSession() const;
 };
\ No newline at end of file
@@ -117,6 +117,11 @@ bool ImageBuffer::isValid() const
   return valid;
 }
 
+VkImage ImageBuffer::getImage() const
+{
+  return image;
+}
+
 VkImageView ImageBuffer::getImageView() const
 {
   return imageView;
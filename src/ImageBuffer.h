@@ -20,6 +20,7 @@ public:
 
   bool isValid() const;
 
+  VkImage getImage() const;
   VkImageView getImageView() const;
 
 private:
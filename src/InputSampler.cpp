@@ -0,0 +1,217 @@
+#include "InputSampler.h"
+
+#include "Context.h"
+#include "Controllers.h"
+#include "Headset.h"
+#include "Util.h"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+constexpr XrDuration maxPredictionLead = 100'000'000; // In nanoseconds, runtimes predict poses this far ahead at most
+constexpr XrDuration maxExtrapolation = 20'000'000;   // In nanoseconds, poses are held beyond this
+constexpr XrDuration minVelocityWindow = 10'000'000;  // In nanoseconds, extrapolate from samples this far apart
+
+glm::vec3 toVector(const XrVector3f& vector)
+{
+  return glm::vec3(vector.x, vector.y, vector.z);
+}
+
+glm::quat toQuaternion(const XrQuaternionf& quaternion)
+{
+  return glm::quat(quaternion.w, quaternion.x, quaternion.y, quaternion.z);
+}
+} // namespace
+
+InputSampler::InputSampler(const Context* context,
+                           const Headset* headset,
+                           const Controllers* controllers,
+                           float sampleRate)
+: context(context), headset(headset)
+{
+  // Make sure the runtime can convert platform time, which the sampler uses to know the OpenXR time of each sample
+  XrTime time;
+  if (!context->getCurrentXrTime(time))
+  {
+    util::error(Error::FeatureNotSupported, "OpenXR time conversion");
+    valid = false;
+    return;
+  }
+
+  // Create a view space that tracks the head
+  XrReferenceSpaceCreateInfo referenceSpaceCreateInfo{ XR_TYPE_REFERENCE_SPACE_CREATE_INFO };
+  referenceSpaceCreateInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW;
+  referenceSpaceCreateInfo.poseInReferenceSpace = util::makeIdentity();
+  const XrResult result = xrCreateReferenceSpace(headset->getXrSession(), &referenceSpaceCreateInfo, &headSpace);
+  if (XR_FAILED(result))
+  {
+    util::error(Error::GenericOpenXR);
+    valid = false;
+    return;
+  }
+
+  // Sample the head first, followed by all controllers
+  spaces.push_back(headSpace);
+  const std::vector<XrSpace>& controllerSpaces = controllers->getXrSpaces();
+  spaces.insert(spaces.end(), controllerSpaces.begin(), controllerSpaces.end());
+  if (spaces.size() > maxTrackedObjectCount)
+  {
+    util::error(Error::FeatureNotSupported, "Too many tracked objects for input sampling");
+    valid = false;
+    return;
+  }
+
+  samplePeriod = 1.0f / sampleRate;
+  thread = std::thread(&InputSampler::samplingLoop, this);
+}
+
+InputSampler::~InputSampler()
+{
+  stopRequested = true;
+  if (thread.joinable())
+  {
+    thread.join();
+  }
+
+  if (headSpace)
+  {
+    xrDestroySpace(headSpace);
+  }
+}
+
+bool InputSampler::getHeadPose(XrTime time, glm::mat4& pose)
+{
+  return getPose(0u, time, pose);
+}
+
+bool InputSampler::getControllerPose(size_t controllerIndex, XrTime time, glm::mat4& pose)
+{
+  return getPose(controllerIndex + 1u, time, pose);
+}
+
+bool InputSampler::getPose(size_t trackedObjectIndex, XrTime time, glm::mat4& pose)
+{
+  // Walk back from the newest sample until two tracked samples bracket the time. If the time is ahead of the newest
+  // tracked sample, walk on until a tracked sample far enough back to extrapolate from is found
+  const size_t count = sampleCount.load(std::memory_order_acquire);
+  const size_t availableCount = std::min(count, historySize);
+
+  Sample newer, older;
+  bool newestRead = false, newerFound = false, olderFound = false;
+  for (size_t offset = 0u; offset < availableCount; ++offset)
+  {
+    Sample sample;
+    if (!readSample(count - 1u - offset, sample))
+    {
+      break; // This and all older samples have been overwritten
+    }
+
+    // Locate ahead by the time from locating the newest sample until the requested time, tracked or not
+    if (!newestRead)
+    {
+      predictionLead.store(std::clamp<XrDuration>(time - sample.sampledTime, 0, maxPredictionLead),
+                           std::memory_order_relaxed);
+      newestRead = true;
+    }
+
+    if (!util::isTracked(sample.locations.at(trackedObjectIndex).locationFlags))
+    {
+      continue;
+    }
+
+    if (!newerFound || (newer.time > time && sample.time > time))
+    {
+      newer = sample;
+      newerFound = true;
+      continue;
+    }
+
+    older = sample;
+    olderFound = true;
+    if (newer.time > time || newer.time - older.time >= minVelocityWindow)
+    {
+      break;
+    }
+  }
+
+  if (!newerFound)
+  {
+    return false;
+  }
+
+  const XrPosef& newerPose = newer.locations.at(trackedObjectIndex).pose;
+  if (!olderFound || newer.time <= older.time)
+  {
+    // Hold the only tracked sample, or the oldest one if the time lies before the history
+    pose = util::poseToMatrix(newerPose);
+    return true;
+  }
+
+  // Interpolate between the samples or extrapolate beyond the newer one, for a limited time only
+  const XrTime clampedTime = std::min(time, newer.time + maxExtrapolation);
+  const float t = static_cast<float>(static_cast<double>(clampedTime - older.time) /
+                                     static_cast<double>(newer.time - older.time));
+
+  const XrPosef& olderPose = older.locations.at(trackedObjectIndex).pose;
+  const glm::vec3 position = glm::mix(toVector(olderPose.position), toVector(newerPose.position), t);
+  const glm::quat orientation =
+    glm::normalize(glm::slerp(toQuaternion(olderPose.orientation), toQuaternion(newerPose.orientation), t));
+
+  XrPosef interpolatedPose;
+  interpolatedPose.position = { position.x, position.y, position.z };
+  interpolatedPose.orientation = { orientation.x, orientation.y, orientation.z, orientation.w };
+  pose = util::poseToMatrix(interpolatedPose);
+  return true;
+}
+
+void InputSampler::samplingLoop()
+{
+  const XrSession session = headset->getXrSession();
+  const XrSpace baseSpace = headset->getXrSpace();
+  const PFN_xrLocateSpacesKHR xrLocateSpacesKHR = context->getXrLocateSpacesFunction();
+
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<float>(samplePeriod));
+  auto nextSampleTime = std::chrono::steady_clock::now();
+
+  std::vector<XrSpaceLocationData> locations;
+  XrDuration lead = 0; // Smoothed, so that the predicted times of consecutive samples stay in order
+  while (!stopRequested)
+  {
+    lead += (predictionLead.load(std::memory_order_relaxed) - lead) / 8;
+
+    XrTime sampledTime;
+    size_t callCount = 0u;
+    if (context->getCurrentXrTime(sampledTime) &&
+        util::locateSpaces(session, xrLocateSpacesKHR, baseSpace, sampledTime + lead, spaces, locations, callCount))
+    {
+      // Write the sample under the sequence lock, readers of this slot retry or skip it while the sequence is odd
+      const size_t index = sampleCount.load(std::memory_order_relaxed);
+      Slot& slot = slots.at(index % historySize);
+      const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+      slot.sequence.store(sequence + 1u, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      slot.sample.time = sampledTime + lead;
+      slot.sample.sampledTime = sampledTime;
+      std::copy(locations.begin(), locations.end(), slot.sample.locations.begin());
+
+      slot.sequence.store(sequence + 2u, std::memory_order_release);
+      sampleCount.store(index + 1u, std::memory_order_release);
+    }
+
+    // Sample at a fixed rate, but do not try to catch up in a burst after falling behind
+    nextSampleTime += period;
+    const auto now = std::chrono::steady_clock::now();
+    if (nextSampleTime < now)
+    {
+      nextSampleTime = now;
+    }
+    std::this_thread::sleep_until(nextSampleTime);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glm/fwd.hpp>
+
+#include <openxr/openxr.h>
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class Context;
+class Controllers;
+class Headset;
+
+/*
+ * The input sampler class samples the poses of the head and all controllers on its own thread at a fixed rate, which
+ * can be much higher than the frame rate, into a lock-free ring of timestamped samples. Each sample is located ahead of
+ * time by the same lead that the poses are requested with, the time from requesting a pose until it is displayed. The
+ * newest samples therefore bracket the requested time, so the pose of any tracked object can be interpolated between
+ * two samples that the runtime predicted, for late latching for example, without any OpenXR calls on the calling
+ * thread. A pose is only extrapolated, for a short time, while the lead settles. Samples are written with a sequence
+ * lock, so a reader never blocks the sampler and simply retries a sample that was overwritten while it was being read.
+ * All poses are in stage space. Sampling requires the runtime to convert the time of the platform into an OpenXR time.
+ */
+class InputSampler final
+{
+public:
+  InputSampler(const Context* context, const Headset* headset, const Controllers* controllers, float sampleRate);
+  ~InputSampler();
+
+  // Return false if there are no tracked samples to use, also update the lead that the sampler locates ahead by
+  bool getHeadPose(XrTime time, glm::mat4& pose);
+  bool getControllerPose(size_t controllerIndex, XrTime time, glm::mat4& pose);
+
+  bool isValid() const;
+
+private:
+  static constexpr size_t historySize = 256u;       // In samples, half a second at 500 Hz
+  static constexpr size_t maxTrackedObjectCount = 8u; // Including the head
+
+  struct Sample
+  {
+    XrTime time = 0;        // The predicted time that the poses were located at
+    XrTime sampledTime = 0; // The time that the poses were located
+    std::array<XrSpaceLocationData, maxTrackedObjectCount> locations = {};
+  };
+
+  struct Slot
+  {
+    std::atomic<uint64_t> sequence = 0u; // Odd while the sample is being written
+    Sample sample;
+  };
+
+  bool valid = true;
+
+  const Context* context = nullptr;
+  const Headset* headset = nullptr;
+  XrSpace headSpace = nullptr;
+  std::vector<XrSpace> spaces; // The head first, followed by all spaces of the controllers
+  float samplePeriod = 0.0f;                  // In seconds
+  std::atomic<XrDuration> predictionLead = 0; // In nanoseconds, from requesting a pose until it is displayed
+
+  std::array<Slot, historySize> slots;
+  std::atomic<size_t> sampleCount = 0u; // Total number of samples written, the newest is in slot (count - 1) % size
+
+  std::thread thread;
+  std::atomic<bool> stopRequested = false;
+
+  bool readSample(size_t sampleIndex, Sample& sample) const; // Returns false if the sample has been overwritten
+  bool getPose(size_t trackedObjectIndex, XrTime time, glm::mat4& pose);
+  void samplingLoop();
+};
\ No newline at end of file
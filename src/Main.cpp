@@ -1,23 +1,131 @@
+#include "Benchmark.h"
 #include "Context.h"
 #include "Controllers.h"
+#include "DoubleBuffer.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "FrameScheduler.h"
 #include "Headset.h"
+#include "InputSampler.h"
 #include "MeshData.h"
+#include "MirrorExport.h"
 #include "MirrorView.h"
 #include "Model.h"
 #include "Renderer.h"
+#include "SpectatorView.h"
+#include "Submitter.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace
 {
 constexpr float flySpeedMultiplier = 2.5f;
+constexpr float staticBatchCellSize = 10.0f; // In meters
+constexpr size_t defaultFramesInFlightCount = 2u;
+constexpr VkExtent2D defaultSpectatorResolution = { 1280u, 720u };
+constexpr float defaultSpectatorRefreshRate = 30.0f; // In Hz
+constexpr double idlePollInterval = 0.1; // In seconds, how often OpenXR events are polled while the session is idle
+
+// The scene state that the simulation hands over to rendering for a single frame
+struct SceneSnapshot
+{
+  bool valid = true; // False if the simulation failed
+  std::chrono::high_resolution_clock::time_point startTime; // When the CPU started working on the frame
+  glm::mat4 cameraMatrix, bikeMatrix;
+  std::vector<glm::mat4> controllerPoses = std::vector<glm::mat4>(2u); // In stage space
+  glm::mat4 gazePose;       // In stage space
+  bool gazeTracked = false; // Whether the gaze pose is valid
+  float time = 0.0f;
+};
+
+// Places the hand models at the controller poses, which are given in stage space
+void placeHands(Model& handModelLeft,
+                Model& handModelRight,
+                const glm::mat4& cameraMatrix,
+                const std::vector<glm::mat4>& controllerPoses)
+{
+  const glm::mat4 inverseCameraMatrix = glm::inverse(cameraMatrix);
+  handModelLeft.worldMatrix = inverseCameraMatrix * controllerPoses.at(0u);
+  handModelRight.worldMatrix = inverseCameraMatrix * controllerPoses.at(1u);
+  handModelRight.worldMatrix = glm::scale(handModelRight.worldMatrix, { -1.0f, 1.0f, 1.0f });
 }
 
-int main()
+// Returns the object that an optional holds, or nullptr if it holds none
+template<typename T>
+T* toPointer(std::optional<T>& object)
 {
-  glm::mat4 cameraMatrix = glm::mat4(1.0f); // Transform from world to stage space
+  return object ? &object.value() : nullptr;
+}
+}
+
+// See the readme for the command line options
+int main(int argc, char* argv[])
+{
+  size_t framesInFlightCount = defaultFramesInFlightCount;
+  bool benchmarkMode = false, spectatorMode = false, mockVisibilityMask = false, mockQuadViews = false;
+  bool foveation = true, dynamicResolutionMode = true;
+  VkExtent2D spectatorResolution = defaultSpectatorResolution;
+  float spectatorRefreshRate = defaultSpectatorRefreshRate;
+  std::string mirrorExportPath, captureFilename;
+  float inputSampleRate = 0.0f; // In Hz, zero if poses are not sampled on a separate thread
+  for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex)
+  {
+    if (std::strcmp(argv[argumentIndex], "--benchmark") == 0)
+    {
+      benchmarkMode = true;
+    }
+    else if (std::strcmp(argv[argumentIndex], "--frames-in-flight") == 0 && argumentIndex + 1 < argc)
+    {
+      framesInFlightCount = static_cast<size_t>(std::strtoul(argv[++argumentIndex], nullptr, 10));
+    }
+    else if (std::strcmp(argv[argumentIndex], "--spectator") == 0)
+    {
+      spectatorMode = true;
+      if (argumentIndex + 3 < argc && std::strncmp(argv[argumentIndex + 1], "--", 2) != 0)
+      {
+        spectatorResolution.width = static_cast<uint32_t>(std::strtoul(argv[++argumentIndex], nullptr, 10));
+        spectatorResolution.height = static_cast<uint32_t>(std::strtoul(argv[++argumentIndex], nullptr, 10));
+        spectatorRefreshRate = std::strtof(argv[++argumentIndex], nullptr);
+      }
+    }
+    else if (std::strcmp(argv[argumentIndex], "--export-mirror") == 0 && argumentIndex + 1 < argc)
+    {
+      mirrorExportPath = argv[++argumentIndex];
+    }
+    else if (std::strcmp(argv[argumentIndex], "--capture") == 0 && argumentIndex + 1 < argc)
+    {
+      captureFilename = argv[++argumentIndex];
+    }
+    else if (std::strcmp(argv[argumentIndex], "--input-rate") == 0 && argumentIndex + 1 < argc)
+    {
+      inputSampleRate = std::strtof(argv[++argumentIndex], nullptr);
+    }
+    else if (std::strcmp(argv[argumentIndex], "--mock-visibility-mask") == 0)
+    {
+      mockVisibilityMask = true;
+    }
+    else if (std::strcmp(argv[argumentIndex], "--mock-quad-views") == 0)
+    {
+      mockQuadViews = true;
+    }
+    else if (std::strcmp(argv[argumentIndex], "--no-foveation") == 0)
+    {
+      foveation = false;
+    }
+    else if (std::strcmp(argv[argumentIndex], "--no-dynamic-resolution") == 0)
+    {
+      dynamicResolutionMode = false;
+    }
+  }
 
   Context context;
   if (!context.isValid())
@@ -25,24 +133,39 @@ int main()
     return EXIT_FAILURE;
   }
 
-  MirrorView mirrorView(&context);
-  if (!mirrorView.isValid())
+  // The mirror window is only needed when the mirror view is not exported to a viewer process
+  std::optional<MirrorView> mirrorView;
+  if (mirrorExportPath.empty())
   {
-    return EXIT_FAILURE;
+    mirrorView.emplace(&context);
+    if (!mirrorView->isValid())
+    {
+      return EXIT_FAILURE;
+    }
   }
 
-  if (!context.createDevice(mirrorView.getSurface()))
+  if (!context.createDevice(mirrorView ? mirrorView->getSurface() : nullptr))
   {
     return EXIT_FAILURE;
   }
 
-  Headset headset(&context);
+  std::optional<MirrorExport> mirrorExport;
+  if (!mirrorExportPath.empty())
+  {
+    mirrorExport.emplace(&context, mirrorExportPath);
+    if (!mirrorExport->isValid())
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  Headset headset(&context, mockVisibilityMask, mockQuadViews, foveation);
   if (!headset.isValid())
   {
     return EXIT_FAILURE;
   }
 
-  Controllers controllers(context.getXrInstance(), headset.getXrSession());
+  Controllers controllers(&context, headset.getXrSession());
   if (!controllers.isValid())
   {
     return EXIT_FAILURE;
@@ -53,6 +176,10 @@ int main()
   std::vector<Model*> models = { &gridModel, &ruinsModel,    &carModelLeft,   &carModelRight, &beetleModel,
                                  &bikeModel, &handModelLeft, &handModelRight, &logoModel };
 
+  gridModel.technique = Model::Technique::Grid;
+  gridModel.isStatic = ruinsModel.isStatic = carModelLeft.isStatic = carModelRight.isStatic = beetleModel.isStatic =
+    logoModel.isStatic = true;
+
   gridModel.worldMatrix = ruinsModel.worldMatrix = glm::mat4(1.0f);
   carModelLeft.worldMatrix =
     glm::rotate(glm::translate(glm::mat4(1.0f), { -3.5f, 0.0f, -7.0f }), glm::radians(75.0f), { 0.0f, 1.0f, 0.0f });
@@ -98,90 +225,354 @@ int main()
     return EXIT_FAILURE;
   }
 
-  Renderer renderer(&context, &headset, meshData, models);
+  // Bake the static models into world space batches, only these and the dynamic models are drawn
+  std::vector<Model> staticBatches = meshData->batchStaticModels(models, staticBatchCellSize);
+
+  std::vector<Model*> drawnModels;
+  for (Model* model : models)
+  {
+    if (!model->isStatic)
+    {
+      drawnModels.push_back(model);
+    }
+  }
+
+  for (Model& staticBatch : staticBatches)
+  {
+    drawnModels.push_back(&staticBatch);
+  }
+
+  std::optional<SpectatorView> spectatorView;
+  if (spectatorMode && spectatorResolution.width > 0u && spectatorResolution.height > 0u)
+  {
+    spectatorView.emplace(&context, spectatorResolution, spectatorRefreshRate);
+    if (!spectatorView->isValid())
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  Renderer renderer(&context, &headset, toPointer(spectatorView), meshData, drawnModels, framesInFlightCount);
   if (!renderer.isValid())
   {
     return EXIT_FAILURE;
   }
 
+  std::optional<Benchmark> benchmark;
+  if (benchmarkMode)
+  {
+    benchmark.emplace(&renderer, &controllers);
+    if (!benchmark->isValid())
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
   delete meshData;
 
-  if (!mirrorView.connect(&headset, &renderer))
+  std::optional<FrameCapture> frameCapture;
+  if (!captureFilename.empty())
+  {
+    frameCapture.emplace(&context, captureFilename);
+    if (!frameCapture->isValid())
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (mirrorView && !mirrorView->connect(&headset, &renderer, toPointer(spectatorView)))
   {
     return EXIT_FAILURE;
   }
 
-  // Main loop
-  std::chrono::high_resolution_clock::time_point previousTime = std::chrono::high_resolution_clock::now();
-  while (!headset.isExitRequested() && !mirrorView.isExitRequested())
+  if (mirrorExport && !mirrorExport->connect(&headset, &renderer, toPointer(spectatorView)))
   {
-    // Calculate the delta time in seconds
-    const std::chrono::high_resolution_clock::time_point nowTime = std::chrono::high_resolution_clock::now();
-    const long long elapsedNanoseconds =
-      std::chrono::duration_cast<std::chrono::nanoseconds>(nowTime - previousTime).count();
-    const float deltaTime = static_cast<float>(elapsedNanoseconds) / 1e9f;
-    previousTime = nowTime;
+    return EXIT_FAILURE;
+  }
 
-    mirrorView.processWindowEvents();
+  if (frameCapture && !frameCapture->connect(&headset, &renderer, toPointer(spectatorView)))
+  {
+    return EXIT_FAILURE;
+  }
 
-    uint32_t swapchainImageIndex;
-    const Headset::BeginFrameResult frameResult = headset.beginFrame(swapchainImageIndex);
-    if (frameResult == Headset::BeginFrameResult::Error)
+  std::optional<InputSampler> inputSampler;
+  if (inputSampleRate > 0.0f)
+  {
+    inputSampler.emplace(&context, &headset, &controllers, inputSampleRate);
+    if (!inputSampler->isValid())
     {
       return EXIT_FAILURE;
     }
-    else if (frameResult == Headset::BeginFrameResult::SkipFully)
+  }
+
+  // Lower the resolution of the headset views when the GPU cannot keep up, unless a fixed resolution is needed
+  DynamicResolution dynamicResolution;
+  dynamicResolutionMode = dynamicResolutionMode && !benchmark && (spectatorView || (!mirrorExport && !frameCapture));
+
+  // Simulate on a separate thread so that simulating the next frame overlaps with rendering the current one, the scene
+  // state is handed over through double-buffered snapshots
+  FramePacer framePacer(&headset);
+  FrameScheduler frameScheduler;
+  DoubleBuffer<SceneSnapshot> sceneSnapshots;
+  Submitter submitter(&headset, &renderer, toPointer(mirrorView), toPointer(mirrorExport), toPointer(frameCapture),
+                      &framePacer);
+  std::thread simulationThread([&] {
+    glm::mat4 cameraMatrix = glm::mat4(1.0f); // Transform from world to stage space
+    float time = 0.0f;
+
+    std::chrono::high_resolution_clock::time_point previousTime = std::chrono::high_resolution_clock::now();
+    FramePacer::Frame frame;
+    while (framePacer.waitForSimulation(frame))
     {
-      continue;
+      const bool simulateFrame = (frame.result == Headset::BeginFrameResult::RenderFully ||
+                                  frame.result == Headset::BeginFrameResult::SkipRender);
+
+      // Start the frame just in time, the poses are sampled as late as possible that way
+      if (simulateFrame)
+      {
+        const float startDelay = frameScheduler.getStartDelay(frame.predictedDisplayTime, frame.predictedDisplayPeriod);
+        std::this_thread::sleep_for(std::chrono::duration<float>(startDelay));
+      }
+
+      // Calculate the delta time in seconds
+      const std::chrono::high_resolution_clock::time_point nowTime = std::chrono::high_resolution_clock::now();
+      const long long elapsedNanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(nowTime - previousTime).count();
+      const float deltaTime = static_cast<float>(elapsedNanoseconds) / 1e9f;
+      previousTime = nowTime;
+
+      SceneSnapshot* sceneSnapshot = sceneSnapshots.beginWrite();
+      if (!sceneSnapshot)
+      {
+        return;
+      }
+
+      sceneSnapshot->startTime = nowTime;
+
+      // Frames that are skipped fully or failed to begin are not simulated
+      if (simulateFrame)
+      {
+        if (!controllers.sync(headset.getXrSpace(), frame.predictedDisplayTime))
+        {
+          sceneSnapshot->valid = false;
+          sceneSnapshots.endWrite();
+          return;
+        }
+
+        time += deltaTime;
+
+        // Update
+        for (size_t controllerIndex = 0u; controllerIndex < 2u; ++controllerIndex)
+        {
+          const float flySpeed = controllers.getFlySpeed(controllerIndex);
+          if (flySpeed > 0.0f)
+          {
+            const glm::vec3 forward = glm::normalize(controllers.getPose(controllerIndex)[2]);
+            cameraMatrix = glm::translate(cameraMatrix, forward * flySpeed * flySpeedMultiplier * deltaTime);
+          }
+        }
+
+        sceneSnapshot->controllerPoses.at(0u) = controllers.getPose(0u);
+        sceneSnapshot->controllerPoses.at(1u) = controllers.getPose(1u);
+        sceneSnapshot->gazeTracked = controllers.getGazePose(sceneSnapshot->gazePose);
+
+        sceneSnapshot->bikeMatrix =
+          glm::rotate(glm::translate(glm::mat4(1.0f), { 0.5f, 0.0f, -4.5f }), time * 0.2f, { 0.0f, 1.0f, 0.0f });
+      }
+
+      sceneSnapshot->cameraMatrix = cameraMatrix;
+      sceneSnapshot->time = time;
+      sceneSnapshots.endWrite();
     }
+  });
 
-    if (!controllers.sync(headset.getXrSpace(), headset.getXrFrameState().predictedDisplayTime))
+  // Main loop, renders the frames handed over by the frame pacer with the matching scene snapshots
+  int exitCode = EXIT_SUCCESS;
+  while (!headset.isExitRequested() && !(mirrorView && mirrorView->isExitRequested()) &&
+         !(benchmark && benchmark->isFinished()))
+  {
+    if (mirrorView)
     {
-      return EXIT_FAILURE;
+      mirrorView->processWindowEvents();
     }
 
-    static float time = 0.0f;
-    time += deltaTime;
+    FramePacer::Frame frame;
+    if (!framePacer.acquireFrame(frame))
+    {
+      break;
+    }
 
-    // Update
-    for (size_t controllerIndex = 0u; controllerIndex < 2u; ++controllerIndex)
+    const SceneSnapshot* sceneSnapshot = sceneSnapshots.beginRead();
+    if (!sceneSnapshot)
     {
-      const float flySpeed = controllers.getFlySpeed(controllerIndex);
-      if (flySpeed > 0.0f)
+      break;
+    }
+
+    if (frame.result == Headset::BeginFrameResult::Error || !sceneSnapshot->valid)
+    {
+      exitCode = EXIT_FAILURE;
+      break;
+    }
+    else if (frame.result == Headset::BeginFrameResult::SkipFully)
+    {
+      // The session is not running, idle until a window event arrives or it is time to poll OpenXR events again
+      sceneSnapshots.endRead();
+      submitter.enqueue({}); // Only releases the frame, in order with the frames before it
+      if (mirrorView)
+      {
+        mirrorView->waitForWindowEvents(idlePollInterval);
+      }
+      else
       {
-        const glm::vec3 forward = glm::normalize(controllers.getPose(controllerIndex)[2]);
-        cameraMatrix = glm::translate(cameraMatrix, forward * flySpeed * flySpeedMultiplier * deltaTime);
+        std::this_thread::sleep_for(std::chrono::duration<double>(idlePollInterval));
       }
+      continue;
+    }
+    else if (frame.result == Headset::BeginFrameResult::SkipRender)
+    {
+      // The runtime does not display this frame, so end it without rendering, xrWaitFrame throttles these frames
+      sceneSnapshots.endRead();
+      Submitter::Submission submission;
+      submission.endFrame = true;
+      submitter.enqueue(submission);
+      continue;
     }
 
-    const glm::mat4 inverseCameraMatrix = glm::inverse(cameraMatrix);
-    handModelLeft.worldMatrix = inverseCameraMatrix * controllers.getPose(0u);
-    handModelRight.worldMatrix = inverseCameraMatrix * controllers.getPose(1u);
-    handModelRight.worldMatrix = glm::scale(handModelRight.worldMatrix, { -1.0f, 1.0f, 1.0f });
-
-    bikeModel.worldMatrix =
-      glm::rotate(glm::translate(glm::mat4(1.0f), { 0.5f, 0.0f, -4.5f }), time * 0.2f, { 0.0f, 1.0f, 0.0f });
+    const glm::mat4 cameraMatrix = sceneSnapshot->cameraMatrix;
+    std::vector<glm::mat4> controllerPoses = sceneSnapshot->controllerPoses;
+    placeHands(handModelLeft, handModelRight, cameraMatrix, controllerPoses);
+    bikeModel.worldMatrix = sceneSnapshot->bikeMatrix;
+    const glm::mat4 gazePose = sceneSnapshot->gazePose;
+    const bool gazeTracked = sceneSnapshot->gazeTracked;
+    const float time = sceneSnapshot->time;
+    const std::chrono::high_resolution_clock::time_point startTime = sceneSnapshot->startTime;
+    sceneSnapshots.endRead();
 
     // Render
-    renderer.render(cameraMatrix, swapchainImageIndex, time);
+    if (benchmark)
+    {
+      benchmark->beginFrame();
+    }
 
-    const MirrorView::RenderResult mirrorResult = mirrorView.render(swapchainImageIndex);
-    if (mirrorResult == MirrorView::RenderResult::Error)
+    // The resolution scale follows the GPU time of an earlier frame, which is the most recent one that is known
+    if (dynamicResolutionMode)
     {
-      return EXIT_FAILURE;
+      dynamicResolution.update(renderer.getGpuDuration(), frame.predictedDisplayPeriod);
+      headset.setResolutionScale(dynamicResolution.getScale());
+    }
+
+    renderer.render(cameraMatrix, frame.swapchainImageIndex, time, gazeTracked ? &gazePose : nullptr);
+
+    MirrorView::RenderResult mirrorResult = MirrorView::RenderResult::Invisible;
+    if (mirrorView)
+    {
+      mirrorResult = mirrorView->render(frame.swapchainImageIndex);
+      if (mirrorResult == MirrorView::RenderResult::Error)
+      {
+        exitCode = EXIT_FAILURE;
+        break;
+      }
+    }
+
+    MirrorExport::CopyResult exportResult = MirrorExport::CopyResult::Skipped;
+    if (mirrorExport)
+    {
+      exportResult = mirrorExport->copy(frame.swapchainImageIndex);
+      if (exportResult == MirrorExport::CopyResult::Error)
+      {
+        exitCode = EXIT_FAILURE;
+        break;
+      }
+    }
+
+    FrameCapture::CaptureResult captureResult = FrameCapture::CaptureResult::Skipped;
+    size_t captureReadbackBufferIndex = 0u;
+    if (frameCapture)
+    {
+      captureResult = frameCapture->capture(frame.swapchainImageIndex, captureReadbackBufferIndex);
+      if (captureResult == FrameCapture::CaptureResult::Error)
+      {
+        exitCode = EXIT_FAILURE;
+        break;
+      }
     }
 
-    const bool mirrorViewVisible = (mirrorResult == MirrorView::RenderResult::Visible);
-    renderer.submit(mirrorViewVisible);
+    // Late latch the newest eye and controller poses right before submitting, the eye poses are also the ones that are
+    // passed to the runtime when the frame ends. With an input sampler, the eyes are moved along with the sampled head
+    // pose instead of being located again
+    const XrTime predictedDisplayTime = headset.getXrFrameState().predictedDisplayTime;
+    glm::mat4 headPose;
+    const bool eyesLatched = inputSampler && inputSampler->getHeadPose(predictedDisplayTime, headPose) &&
+                             headset.latchEyePoses(headPose);
+    if (!eyesLatched && !headset.updateEyePoses())
+    {
+      exitCode = EXIT_FAILURE;
+      break;
+    }
 
-    if (mirrorViewVisible)
+    if (inputSampler)
     {
-      mirrorView.present();
+      // Take the controller poses from the sampled history, a controller without tracked samples keeps its pose
+      for (size_t controllerIndex = 0u; controllerIndex < controllerPoses.size(); ++controllerIndex)
+      {
+        glm::mat4 pose;
+        if (inputSampler->getControllerPose(controllerIndex, predictedDisplayTime, pose))
+        {
+          controllerPoses.at(controllerIndex) = pose;
+        }
+      }
+    }
+    else if (!controllers.locatePoses(headset.getXrSpace(), predictedDisplayTime, controllerPoses))
+    {
+      exitCode = EXIT_FAILURE;
+      break;
     }
 
-    headset.endFrame();
+    placeHands(handModelLeft, handModelRight, cameraMatrix, controllerPoses);
+    renderer.lateLatch(cameraMatrix);
+
+    // Hand the frame over to the submission thread, which also ends it and releases it back to the frame pacer, unless
+    // the benchmark still needs it
+    Submitter::Submission submission;
+    submission.submit = submission.endFrame = true;
+    submission.present = (mirrorResult == MirrorView::RenderResult::Visible);
+    submission.exportMirror = (exportResult == MirrorExport::CopyResult::Copied);
+    submission.capture = (captureResult == FrameCapture::CaptureResult::Captured);
+    submission.readbackBufferIndex = captureReadbackBufferIndex;
+    submission.holdFrame = benchmark.has_value();
+    submitter.enqueue(submission);
+
+    // The GPU cost is that of an earlier frame, which is the most recent one that is known
+    const long long cpuNanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - startTime)
+        .count();
+    frameScheduler.addFrameCost(static_cast<float>(cpuNanoseconds) / 1e9f, renderer.getGpuDuration());
+
+    if (benchmark)
+    {
+      // The benchmark may rebuild the render processes, which is only safe once the frame has been submitted, presented
+      // and ended and before the frame pacer begins the next one, so the frame is only released afterwards
+      submitter.waitIdle();
+      if (!benchmark->endFrame())
+      {
+        exitCode = EXIT_FAILURE;
+        break;
+      }
+      framePacer.releaseFrame();
+    }
   }
 
+  framePacer.stop();
+  sceneSnapshots.stop();
+  simulationThread.join();
+  submitter.stop();
+
   context.sync(); // Sync before destroying so that resources are free
-  return EXIT_SUCCESS;
+
+  if (frameCapture && !frameCapture->finish())
+  {
+    exitCode = EXIT_FAILURE;
+  }
+
+  return exitCode;
 }
\ No newline at end of file
@@ -3,9 +3,19 @@
 #include "Model.h"
 #include "Util.h"
 
+#include <glm/common.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/vec4.hpp>
+
 #include <tinyobjloader/tiny_obj_loader.h>
 
+#include <array>
+#include <cmath>
 #include <cstring>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <utility>
 
 bool MeshData::loadModel(const std::string& filename,
                          Color color,
@@ -23,6 +33,9 @@ bool MeshData::loadModel(const std::string& filename,
 
   const size_t oldIndexCount = indices.size();
 
+  glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
   for (const tinyobj::shape_t& shape : shapes)
   {
     for (const tinyobj::index_t& index : shape.mesh.indices)
@@ -52,6 +65,9 @@ bool MeshData::loadModel(const std::string& filename,
         break;
       }
 
+      boundsMin = glm::min(boundsMin, vertex.position);
+      boundsMax = glm::max(boundsMax, vertex.position);
+
       vertices.push_back(vertex);
       indices.push_back(static_cast<uint32_t>(indices.size()));
     }
@@ -62,11 +78,114 @@ bool MeshData::loadModel(const std::string& filename,
     Model* model = models.at(modelIndex);
     model->firstIndex = oldIndexCount;
     model->indexCount = indices.size() - oldIndexCount;
+    model->boundsMin = boundsMin;
+    model->boundsMax = boundsMax;
   }
 
   return true;
 }
 
+std::vector<Model> MeshData::batchStaticModels(const std::vector<Model*>& models, float cellSize)
+{
+  // Gather the world space triangles of all static models by technique and cell, ordered to keep the result stable
+  std::map<std::tuple<Model::Technique, int, int>, std::vector<Vertex>> batchVertices;
+  for (const Model* model : models)
+  {
+    if (!model->isStatic)
+    {
+      continue;
+    }
+
+    const glm::mat3 normalMatrix = glm::mat3(model->worldMatrix); // Matches how the vertex shaders transform normals
+    for (size_t index = model->firstIndex; index + 2u < model->firstIndex + model->indexCount; index += 3u)
+    {
+      std::array<Vertex, 3u> triangle;
+      glm::vec3 center = glm::vec3(0.0f);
+      for (size_t cornerIndex = 0u; cornerIndex < triangle.size(); ++cornerIndex)
+      {
+        Vertex& vertex = triangle.at(cornerIndex);
+        vertex = vertices.at(indices.at(index + cornerIndex));
+        vertex.position = glm::vec3(model->worldMatrix * glm::vec4(vertex.position, 1.0f));
+        vertex.normal = normalMatrix * vertex.normal;
+        center += vertex.position / 3.0f;
+      }
+
+      const int cellX = static_cast<int>(std::floor(center.x / cellSize));
+      const int cellZ = static_cast<int>(std::floor(center.z / cellSize));
+      std::vector<Vertex>& cellVertices = batchVertices[std::make_tuple(model->technique, cellX, cellZ)];
+      cellVertices.insert(cellVertices.end(), triangle.begin(), triangle.end());
+    }
+  }
+
+  // Compact the geometry of the static models out, so that it is not uploaded along with the batches. Only the ranges
+  // that a dynamic model draws are kept, several models loaded together share a range
+  std::map<size_t, size_t> keptRanges; // From the first index to the index count
+  for (const Model* model : models)
+  {
+    if (!model->isStatic)
+    {
+      keptRanges.emplace(model->firstIndex, model->indexCount);
+    }
+  }
+
+  std::vector<Vertex> keptVertices;
+  std::map<size_t, size_t> keptFirstIndices; // From the old to the new first index
+  for (const auto& [firstIndex, indexCount] : keptRanges)
+  {
+    keptFirstIndices.emplace(firstIndex, keptVertices.size());
+    for (size_t index = firstIndex; index < firstIndex + indexCount; ++index)
+    {
+      keptVertices.push_back(vertices.at(indices.at(index)));
+    }
+  }
+
+  vertices = std::move(keptVertices);
+  indices.resize(vertices.size());
+  for (size_t index = 0u; index < indices.size(); ++index)
+  {
+    indices.at(index) = static_cast<uint32_t>(index);
+  }
+
+  for (Model* model : models)
+  {
+    if (model->isStatic)
+    {
+      model->firstIndex = model->indexCount = 0u; // Only drawn as part of a batch from now on
+    }
+    else
+    {
+      model->firstIndex = keptFirstIndices.at(model->firstIndex);
+    }
+  }
+
+  // Append each batch as a new model with an identity world matrix and world space bounds
+  std::vector<Model> batches;
+  for (const auto& [key, cellVertices] : batchVertices)
+  {
+    Model batch;
+    batch.technique = std::get<0u>(key);
+    batch.isStatic = true;
+    batch.firstIndex = indices.size();
+    batch.indexCount = cellVertices.size();
+    batch.worldMatrix = glm::mat4(1.0f);
+
+    batch.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    batch.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : cellVertices)
+    {
+      batch.boundsMin = glm::min(batch.boundsMin, vertex.position);
+      batch.boundsMax = glm::max(batch.boundsMax, vertex.position);
+
+      vertices.push_back(vertex);
+      indices.push_back(static_cast<uint32_t>(indices.size()));
+    }
+
+    batches.push_back(batch);
+  }
+
+  return batches;
+}
+
 size_t MeshData::getSize() const
 {
   return sizeof(vertices.at(0u)) * vertices.size() + sizeof(indices.at(0u)) * indices.size();
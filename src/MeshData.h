@@ -22,7 +22,9 @@ struct Vertex final
  * memory after loading is done. It's purpose is rather to serve as a container for geometry data read in from OBJ model
  * files until that gets uploaded to a Vulkan vertex/index buffer on the GPU. Note that the models in the mesh data
  * class should be unique, a model that is rendered several times only needs to be loaded once. As many model structs as
- * required can then be derived from the same data.
+ * required can then be derived from the same data. Static models can be batched, which transforms their geometry into
+ * world space and merges it into one model per technique and cell of a grid on the ground plane. The cells keep the
+ * batches small enough to still be culled effectively, the original geometry of the static models is dropped.
  */
 class MeshData final
 {
@@ -33,6 +35,7 @@ public:
     FromNormals
   };
   bool loadModel(const std::string& filename, Color color, std::vector<Model*>& models, size_t offset, size_t count);
+  std::vector<Model> batchStaticModels(const std::vector<Model*>& models, float cellSize);
 
   size_t getSize() const;
   size_t getIndexOffset() const;
@@ -0,0 +1,548 @@
+#include "MirrorExport.h"
+
+#include "Context.h"
+#include "Headset.h"
+#include "RenderTarget.h"
+#include "Renderer.h"
+#include "SpectatorView.h"
+#include "Util.h"
+
+#include <array>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+  #include <cerrno>
+  #include <sys/socket.h>
+  #include <sys/un.h>
+  #include <unistd.h>
+#endif
+
+namespace
+{
+constexpr size_t mirrorEyeIndex = 1u; // Eye index to mirror without a spectator view, 0 = left, 1 = right
+constexpr VkExternalMemoryHandleTypeFlagBits memoryHandleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+constexpr VkExternalSemaphoreHandleTypeFlagBits semaphoreHandleType =
+  VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+// Creates a non-blocking local socket that listens at a path, returns -1 on error
+int createListenSocket(const std::string& path)
+{
+#ifndef _WIN32
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+  {
+    return -1;
+  }
+  strcpy(address.sun_path, path.c_str());
+
+  const int listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenSocket < 0)
+  {
+    return -1;
+  }
+
+  unlink(path.c_str()); // Remove a stale socket of an earlier run
+  if (bind(listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(listenSocket, 1) != 0)
+  {
+    close(listenSocket);
+    return -1;
+  }
+
+  return listenSocket;
+#else
+  return -1;
+#endif
+}
+
+// Sends a header and the file descriptors that belong to it, returns false on error
+bool sendHeader(int socket, const MirrorExport::Header& header, const std::array<int, 3u>& fds)
+{
+#ifndef _WIN32
+  iovec payload;
+  payload.iov_base = const_cast<MirrorExport::Header*>(&header);
+  payload.iov_len = sizeof(header);
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+
+  msghdr message{};
+  message.msg_iov = &payload;
+  message.msg_iovlen = 1u;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+  controlMessage->cmsg_level = SOL_SOCKET;
+  controlMessage->cmsg_type = SCM_RIGHTS;
+  controlMessage->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(controlMessage), fds.data(), sizeof(fds));
+
+  return sendmsg(socket, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(header));
+#else
+  return false;
+#endif
+}
+
+// Returns whether the other end of a connected socket is still there, without blocking
+bool isSocketConnected(int socket)
+{
+#ifndef _WIN32
+  char byte;
+  const ssize_t result = recv(socket, &byte, 1u, MSG_PEEK | MSG_DONTWAIT);
+  return result > 0 || (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+#else
+  return false;
+#endif
+}
+
+void closeSocket(int socket)
+{
+#ifndef _WIN32
+  close(socket);
+#endif
+}
+} // namespace
+
+MirrorExport::MirrorExport(const Context* context, const std::string& socketPath)
+: context(context), socketPath(socketPath)
+{
+  const VkDevice device = context->getVkDevice();
+
+  if (!context->isMirrorExportSupported())
+  {
+    util::error(Error::FeatureNotSupported, "Mirror export");
+    valid = false;
+    return;
+  }
+
+  // Load the required Vulkan extension functions
+  vkGetMemoryFdKHR =
+    reinterpret_cast<PFN_vkGetMemoryFdKHR>(util::loadVkExtensionFunction(context->getVkInstance(), "vkGetMemoryFdKHR"));
+  if (!vkGetMemoryFdKHR)
+  {
+    util::error(Error::FeatureNotSupported, "Vulkan extension function \"vkGetMemoryFdKHR\"");
+    valid = false;
+    return;
+  }
+
+  vkGetSemaphoreFdKHR = reinterpret_cast<PFN_vkGetSemaphoreFdKHR>(
+    util::loadVkExtensionFunction(context->getVkInstance(), "vkGetSemaphoreFdKHR"));
+  if (!vkGetSemaphoreFdKHR)
+  {
+    util::error(Error::FeatureNotSupported, "Vulkan extension function \"vkGetSemaphoreFdKHR\"");
+    valid = false;
+    return;
+  }
+
+  // Create the exportable written and released timeline semaphores
+  VkExportSemaphoreCreateInfo exportSemaphoreCreateInfo{ VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO };
+  exportSemaphoreCreateInfo.handleTypes = semaphoreHandleType;
+
+  VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+  semaphoreTypeCreateInfo.pNext = &exportSemaphoreCreateInfo;
+  semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  semaphoreTypeCreateInfo.initialValue = 0u;
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+  semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+  if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &writtenSemaphore) != VK_SUCCESS ||
+      vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &releasedSemaphore) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
+  }
+
+  // Listen for a viewer
+  listenSocket = createListenSocket(socketPath);
+  if (listenSocket < 0)
+  {
+    util::error(Error::ConnectionFailure, "Mirror export socket \"" + socketPath + "\"");
+    valid = false;
+    return;
+  }
+}
+
+MirrorExport::~MirrorExport()
+{
+  if (viewerSocket >= 0)
+  {
+    closeSocket(viewerSocket);
+  }
+
+  if (listenSocket >= 0)
+  {
+    closeSocket(listenSocket);
+#ifndef _WIN32
+    unlink(socketPath.c_str());
+#endif
+  }
+
+  const VkDevice device = context->getVkDevice();
+  if (device)
+  {
+    if (releasedSemaphore)
+    {
+      vkDestroySemaphore(device, releasedSemaphore, nullptr);
+    }
+
+    if (writtenSemaphore)
+    {
+      vkDestroySemaphore(device, writtenSemaphore, nullptr);
+    }
+
+    if (image)
+    {
+      vkDestroyImage(device, image, nullptr);
+    }
+
+    if (deviceMemory)
+    {
+      vkFreeMemory(device, deviceMemory, nullptr);
+    }
+  }
+}
+
+bool MirrorExport::connect(const Headset* headset, const Renderer* renderer, const SpectatorView* spectatorView)
+{
+  this->headset = headset;
+  this->renderer = renderer;
+  this->spectatorView = spectatorView;
+
+  // The mirror image has the resolution of what it mirrors, so that it can be copied into without scaling
+  resolution = (spectatorView ? spectatorView->getResolution() : headset->getEyeResolution(mirrorEyeIndex));
+  if (!createImage())
+  {
+    valid = false;
+    return false;
+  }
+
+  return true;
+}
+
+MirrorExport::CopyResult MirrorExport::copy(uint32_t swapchainImageIndex)
+{
+  // The viewer would wait for a signal that never comes
+  if (signalFailed.load(std::memory_order_acquire))
+  {
+    return CopyResult::Error;
+  }
+
+  if (!acceptViewer())
+  {
+    return CopyResult::Skipped;
+  }
+
+  // Only copy when the spectator view has been updated, it is the same image otherwise
+  if (spectatorView && !renderer->isSpectatorViewUpdated())
+  {
+    return CopyResult::Skipped;
+  }
+
+  // Never wait for the viewer, skip the copy while it still reads the previous one
+  uint64_t releasedValue = 0u;
+  if (vkGetSemaphoreCounterValue(context->getVkDevice(), releasedSemaphore, &releasedValue) != VK_SUCCESS)
+  {
+    return CopyResult::Error;
+  }
+
+  if (releasedValue < writtenValue)
+  {
+    return CopyResult::Skipped;
+  }
+
+  const VkCommandBuffer commandBuffer = renderer->getCurrentCommandBuffer();
+  const VkImage sourceImage =
+    (spectatorView ? spectatorView->getImage() : headset->getRenderTarget(swapchainImageIndex)->getImage());
+  const uint32_t sourceLayer = (spectatorView ? 0u : static_cast<uint32_t>(mirrorEyeIndex));
+  const uint32_t queueFamilyIndex = context->getVkDrawQueueFamilyIndex();
+
+  // Take the mirror image back from the viewer, its content is about to be overwritten, and transition the source layer
+  // to the transfer source optimal layout unless it is the spectator view, which is in that layout already
+  {
+    VkImageMemoryBarrier imageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    imageMemoryBarrier.image = image;
+    imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageMemoryBarrier.srcAccessMask = VK_ACCESS_NONE;
+    imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL;
+    imageMemoryBarrier.dstQueueFamilyIndex = queueFamilyIndex;
+    imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageMemoryBarrier.subresourceRange.layerCount = 1u;
+    imageMemoryBarrier.subresourceRange.baseArrayLayer = 0u;
+    imageMemoryBarrier.subresourceRange.levelCount = 1u;
+    imageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    VkImageMemoryBarrier sourceImageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    sourceImageMemoryBarrier.image = sourceImage;
+    sourceImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    sourceImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sourceImageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    sourceImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    sourceImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    sourceImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    sourceImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    sourceImageMemoryBarrier.subresourceRange.layerCount = 1u;
+    sourceImageMemoryBarrier.subresourceRange.baseArrayLayer = sourceLayer;
+    sourceImageMemoryBarrier.subresourceRange.levelCount = 1u;
+    sourceImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    std::vector<VkImageMemoryBarrier> imageMemoryBarriers = { imageMemoryBarrier };
+    if (!spectatorView)
+    {
+      imageMemoryBarriers.push_back(sourceImageMemoryBarrier);
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0u, 0u, nullptr, 0u, nullptr, static_cast<uint32_t>(imageMemoryBarriers.size()),
+                         imageMemoryBarriers.data());
+  }
+
+  // Copy the source into the mirror image, both have the same format and resolution
+  VkImageCopy imageCopy{};
+  imageCopy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  imageCopy.srcSubresource.mipLevel = 0u;
+  imageCopy.srcSubresource.baseArrayLayer = sourceLayer;
+  imageCopy.srcSubresource.layerCount = 1u;
+  imageCopy.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  imageCopy.dstSubresource.mipLevel = 0u;
+  imageCopy.dstSubresource.baseArrayLayer = 0u;
+  imageCopy.dstSubresource.layerCount = 1u;
+  imageCopy.extent = { resolution.width, resolution.height, 1u };
+  vkCmdCopyImage(commandBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1u, &imageCopy);
+
+  // Hand the mirror image over to the viewer in the transfer source optimal layout and transition the source layer
+  // back to the color attachment optimal layout
+  {
+    VkImageMemoryBarrier imageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    imageMemoryBarrier.image = image;
+    imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageMemoryBarrier.dstAccessMask = VK_ACCESS_NONE;
+    imageMemoryBarrier.srcQueueFamilyIndex = queueFamilyIndex;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL;
+    imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageMemoryBarrier.subresourceRange.layerCount = 1u;
+    imageMemoryBarrier.subresourceRange.baseArrayLayer = 0u;
+    imageMemoryBarrier.subresourceRange.levelCount = 1u;
+    imageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    VkImageMemoryBarrier sourceImageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    sourceImageMemoryBarrier.image = sourceImage;
+    sourceImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sourceImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    sourceImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    sourceImageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+    sourceImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    sourceImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    sourceImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    sourceImageMemoryBarrier.subresourceRange.layerCount = 1u;
+    sourceImageMemoryBarrier.subresourceRange.baseArrayLayer = sourceLayer;
+    sourceImageMemoryBarrier.subresourceRange.levelCount = 1u;
+    sourceImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
+
+    std::vector<VkImageMemoryBarrier> imageMemoryBarriers = { imageMemoryBarrier };
+    if (!spectatorView)
+    {
+      imageMemoryBarriers.push_back(sourceImageMemoryBarrier);
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         0u, 0u, nullptr, 0u, nullptr, static_cast<uint32_t>(imageMemoryBarriers.size()),
+                         imageMemoryBarriers.data());
+  }
+
+  signalValue.store(++writtenValue, std::memory_order_release);
+  return CopyResult::Copied;
+}
+
+void MirrorExport::signal()
+{
+  // Signal operations include all commands that were submitted to the queue before them, so an empty submission after
+  // the frame is enough to let the viewer know once the copy has finished
+  const uint64_t value = signalValue.load(std::memory_order_acquire);
+
+  VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{ VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+  timelineSemaphoreSubmitInfo.signalSemaphoreValueCount = 1u;
+  timelineSemaphoreSubmitInfo.pSignalSemaphoreValues = &value;
+
+  VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+  submitInfo.pNext = &timelineSemaphoreSubmitInfo;
+  submitInfo.signalSemaphoreCount = 1u;
+  submitInfo.pSignalSemaphores = &writtenSemaphore;
+  if (vkQueueSubmit(context->getVkDrawQueue(), 1u, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    signalFailed.store(true, std::memory_order_release);
+  }
+}
+
+bool MirrorExport::isValid() const
+{
+  return valid;
+}
+
+bool MirrorExport::createImage()
+{
+  const VkDevice device = context->getVkDevice();
+
+  // Create an exportable image
+  VkExternalMemoryImageCreateInfo externalMemoryImageCreateInfo{
+    VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO
+  };
+  externalMemoryImageCreateInfo.handleTypes = memoryHandleType;
+
+  VkImageCreateInfo imageCreateInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+  imageCreateInfo.pNext = &externalMemoryImageCreateInfo;
+  imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageCreateInfo.extent = { resolution.width, resolution.height, 1u };
+  imageCreateInfo.mipLevels = 1u;
+  imageCreateInfo.arrayLayers = 1u;
+  imageCreateInfo.format = format;
+  imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageCreateInfo.usage = usage;
+  imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  if (vkCreateImage(device, &imageCreateInfo, nullptr, &image) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  // Find a suitable memory type index
+  VkMemoryRequirements memoryRequirements;
+  vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+
+  uint32_t suitableMemoryTypeIndex = 0u;
+  if (!util::findSuitableMemoryTypeIndex(context->getVkPhysicalDevice(), memoryRequirements,
+                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, suitableMemoryTypeIndex))
+  {
+    util::error(Error::FeatureNotSupported, "Suitable image buffer memory type");
+    return false;
+  }
+
+  // Allocate exportable image memory, it is a dedicated allocation as some drivers require one for external images
+  VkMemoryDedicatedAllocateInfo memoryDedicatedAllocateInfo{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+  memoryDedicatedAllocateInfo.image = image;
+
+  VkExportMemoryAllocateInfo exportMemoryAllocateInfo{ VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO };
+  exportMemoryAllocateInfo.pNext = &memoryDedicatedAllocateInfo;
+  exportMemoryAllocateInfo.handleTypes = memoryHandleType;
+
+  VkMemoryAllocateInfo memoryAllocateInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+  memoryAllocateInfo.pNext = &exportMemoryAllocateInfo;
+  memoryAllocateInfo.allocationSize = memoryRequirements.size;
+  memoryAllocateInfo.memoryTypeIndex = suitableMemoryTypeIndex;
+  if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &deviceMemory) != VK_SUCCESS)
+  {
+    std::stringstream s;
+    s << memoryRequirements.size << " bytes for mirror export";
+    util::error(Error::OutOfMemory, s.str());
+    return false;
+  }
+
+  if (vkBindImageMemory(device, image, deviceMemory, 0u) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  // Describe the image to the viewer, which has to create it in the same way on the same device
+  VkPhysicalDeviceIDProperties physicalDeviceIdProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES };
+  VkPhysicalDeviceProperties2 physicalDeviceProperties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+  physicalDeviceProperties2.pNext = &physicalDeviceIdProperties;
+  vkGetPhysicalDeviceProperties2(context->getVkPhysicalDevice(), &physicalDeviceProperties2);
+
+  memcpy(header.deviceUuid, physicalDeviceIdProperties.deviceUUID, VK_UUID_SIZE);
+  memcpy(header.driverUuid, physicalDeviceIdProperties.driverUUID, VK_UUID_SIZE);
+  header.width = resolution.width;
+  header.height = resolution.height;
+  header.allocationSize = memoryRequirements.size;
+  header.memoryTypeIndex = suitableMemoryTypeIndex;
+
+  return true;
+}
+
+bool MirrorExport::acceptViewer()
+{
+  const VkDevice device = context->getVkDevice();
+
+  // Release the mirror image on behalf of a viewer that has gone away, it may have been reading it
+  if (viewerSocket >= 0 && !isSocketConnected(viewerSocket))
+  {
+    closeSocket(viewerSocket);
+    viewerSocket = -1;
+
+    uint64_t releasedValue = 0u;
+    if (vkGetSemaphoreCounterValue(device, releasedSemaphore, &releasedValue) == VK_SUCCESS &&
+        releasedValue < writtenValue)
+    {
+      VkSemaphoreSignalInfo semaphoreSignalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO };
+      semaphoreSignalInfo.semaphore = releasedSemaphore;
+      semaphoreSignalInfo.value = writtenValue;
+      vkSignalSemaphore(device, &semaphoreSignalInfo);
+    }
+  }
+
+  if (viewerSocket >= 0)
+  {
+    return true;
+  }
+
+#ifndef _WIN32
+  // Check for a new viewer without blocking
+  viewerSocket = accept4(listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+  if (viewerSocket < 0)
+  {
+    return false;
+  }
+
+  // Export a new file descriptor for each of the shared objects, their ownership passes to the viewer
+  std::array<int, 1u + semaphoreCount> fds = { -1, -1, -1 };
+
+  VkMemoryGetFdInfoKHR memoryGetFdInfo{ VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR };
+  memoryGetFdInfo.memory = deviceMemory;
+  memoryGetFdInfo.handleType = memoryHandleType;
+
+  VkSemaphoreGetFdInfoKHR semaphoreGetFdInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR };
+  semaphoreGetFdInfo.handleType = semaphoreHandleType;
+
+  bool exported = (vkGetMemoryFdKHR(device, &memoryGetFdInfo, &fds.at(0u)) == VK_SUCCESS);
+
+  semaphoreGetFdInfo.semaphore = writtenSemaphore;
+  exported = exported && (vkGetSemaphoreFdKHR(device, &semaphoreGetFdInfo, &fds.at(1u)) == VK_SUCCESS);
+
+  semaphoreGetFdInfo.semaphore = releasedSemaphore;
+  exported = exported && (vkGetSemaphoreFdKHR(device, &semaphoreGetFdInfo, &fds.at(2u)) == VK_SUCCESS);
+
+  header.writtenValue = writtenValue;
+  const bool sent = exported && sendHeader(viewerSocket, header, fds);
+
+  // The viewer holds its own references now, so close the ones of this process either way
+  for (const int fd : fds)
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+
+  if (!sent)
+  {
+    closeSocket(viewerSocket);
+    viewerSocket = -1;
+    return false;
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
\ No newline at end of file
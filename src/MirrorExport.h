@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <string>
+
+class Context;
+class Headset;
+class Renderer;
+class SpectatorView;
+
+/*
+ * The mirror export class shares a mirror image with a separate viewer process, which takes over all window system
+ * work such as event processing, swapchain recreation and presentation. The image memory and two timeline semaphores
+ * are exported as file descriptors through the Vulkan external memory and semaphore extensions and are handed to the
+ * viewer over a local socket. The application signals the written semaphore with a new value whenever it has copied a
+ * frame into the image, the viewer signals the released semaphore with the same value once it is done reading. A copy
+ * is skipped while the viewer still reads the previous one, so the headset never waits for the viewer.
+ */
+class MirrorExport final
+{
+public:
+  MirrorExport(const Context* context, const std::string& socketPath);
+  ~MirrorExport();
+
+  // Sent to a viewer once it has connected, along with the file descriptors of the image memory, the written semaphore
+  // and the released semaphore in that order
+  struct Header
+  {
+    uint32_t version = 1u;
+    uint8_t deviceUuid[VK_UUID_SIZE] = {}, driverUuid[VK_UUID_SIZE] = {}; // The viewer has to use the same device
+    uint32_t width = 0u, height = 0u;
+    VkDeviceSize allocationSize = 0u;
+    uint32_t memoryTypeIndex = 0u;
+    uint64_t writtenValue = 0u; // Of the written semaphore at the time of connecting
+  };
+  static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+  static constexpr VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  static constexpr uint32_t semaphoreCount = 2u;
+
+  bool connect(const Headset* headset, const Renderer* renderer, const SpectatorView* spectatorView); // Optional view
+
+  enum class CopyResult
+  {
+    Error,  // An error occurred
+    Copied, // The mirror image was copied, signal it once the frame has been submitted
+    Skipped // No viewer is connected or the viewer still reads the previous copy
+  };
+  CopyResult copy(uint32_t swapchainImageIndex);
+  // Call after submitting the frame that was copied, from the thread that owns the draw queue, a failure is reported
+  // and makes the next copy return an error
+  void signal();
+
+  bool isValid() const;
+
+private:
+  bool valid = true;
+
+  const Context* context = nullptr;
+  const Headset* headset = nullptr;
+  const Renderer* renderer = nullptr;
+  const SpectatorView* spectatorView = nullptr;
+
+  VkExtent2D resolution = { 0u, 0u };
+  VkImage image = nullptr;
+  VkDeviceMemory deviceMemory = nullptr;
+  VkSemaphore writtenSemaphore = nullptr, releasedSemaphore = nullptr;
+  Header header;
+
+  std::string socketPath;
+  int listenSocket = -1, viewerSocket = -1;
+  uint64_t writtenValue = 0u;             // Of the last copy, which may not have been signaled yet
+  std::atomic<uint64_t> signalValue = 0u; // Handed over to the thread that signals the written semaphore
+  std::atomic<bool> signalFailed = false; // Set on the thread that signals the written semaphore
+
+  PFN_vkGetMemoryFdKHR vkGetMemoryFdKHR = nullptr;
+  PFN_vkGetSemaphoreFdKHR vkGetSemaphoreFdKHR = nullptr;
+
+  bool createImage();
+  bool acceptViewer();
+};
\ No newline at end of file
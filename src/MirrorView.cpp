@@ -4,20 +4,22 @@
 #include "Headset.h"
 #include "RenderTarget.h"
 #include "Renderer.h"
+#include "SpectatorView.h"
 #include "Util.h"
+#include "WindowSwapchain.h"
 
 #include <glfw/glfw3.h>
 
 #include <glm/common.hpp>
 
-#include <array>
+#include <chrono>
 #include <sstream>
+#include <vector>
 
 namespace
 {
 constexpr const char* windowTitle = "OpenXR Vulkan Example";
-constexpr VkFormat colorFormat = VK_FORMAT_B8G8R8A8_SRGB;
-constexpr VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+constexpr float updateInterval = 1.0f / 30.0f; // In seconds, caps mirror view updates at 30 Hz, zero to disable
 constexpr size_t mirrorEyeIndex = 1u; // Eye index to mirror, 0 = left, 1 = right
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
@@ -80,11 +82,7 @@ MirrorView::MirrorView(const Context* context) : context(context)
 
 MirrorView::~MirrorView()
 {
-  const VkDevice device = context->getVkDevice();
-  if (device && swapchain)
-  {
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
-  }
+  delete swapchain;
 
   const VkInstance instance = context->getVkInstance();
   if (instance && surface)
@@ -105,11 +103,14 @@ void MirrorView::onWindowResize()
   resizeDetected = true;
 }
 
-bool MirrorView::connect(const Headset* headset, const Renderer* renderer)
+bool MirrorView::connect(const Headset* headset, const Renderer* renderer, const SpectatorView* spectatorView)
 {
   this->headset = headset;
   this->renderer = renderer;
+  this->spectatorView = spectatorView;
 
+  // Never block the headset on the vertical blank of the desktop
+  swapchain = new WindowSwapchain(context->getVkPhysicalDevice(), context->getVkDevice(), window, surface, false);
   if (!recreateSwapchain())
   {
     return false;
@@ -123,9 +124,23 @@ void MirrorView::processWindowEvents() const
   glfwPollEvents();
 }
 
+void MirrorView::waitForWindowEvents(double timeout) const
+{
+  glfwWaitEventsTimeout(timeout);
+}
+
 MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
 {
-  if (swapchainResolution.width == 0u || swapchainResolution.height == 0u)
+  if (swapchainOutOfDate)
+  {
+    swapchainOutOfDate = false;
+    if (!recreateSwapchain())
+    {
+      return RenderResult::Error;
+    }
+  }
+
+  if (swapchain->getResolution().width == 0u || swapchain->getResolution().height == 0u)
   {
     // Just check for maximizing as long as the window is minimized
     if (resizeDetected)
@@ -143,9 +158,21 @@ MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
     }
   }
 
-  const VkResult result =
-    vkAcquireNextImageKHR(context->getVkDevice(), swapchain, UINT64_MAX, renderer->getCurrentDrawableSemaphore(),
-                          VK_NULL_HANDLE, &destinationImageIndex);
+  // Skip headset frames to cap the rate of mirror view updates, the spectator view has a rate of its own
+  const std::chrono::high_resolution_clock::time_point nowTime = std::chrono::high_resolution_clock::now();
+  const long long elapsedNanoseconds =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(nowTime - previousUpdateTime).count();
+  if (spectatorView ? !renderer->isSpectatorViewUpdated()
+                    : static_cast<float>(elapsedNanoseconds) / 1e9f < updateInterval)
+  {
+    return RenderResult::Invisible;
+  }
+
+  // Never wait for a mirror view swapchain image, skip the mirror view for this frame if none is available instead, so
+  // that the headset frame does not depend on the desktop
+  const VkResult result = vkAcquireNextImageKHR(context->getVkDevice(), swapchain->getSwapchain(), 0u,
+                                                renderer->getCurrentDrawableSemaphore(), VK_NULL_HANDLE,
+                                                &destinationImageIndex);
   if (result == VK_ERROR_OUT_OF_DATE_KHR)
   {
     // Recreate the swapchain and then stop rendering this frame as it is out of date already
@@ -158,13 +185,19 @@ MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
   }
   else if (result != VK_SUBOPTIMAL_KHR && result != VK_SUCCESS)
   {
-    // Treat a suboptimal like a successful frame
+    // Treat a suboptimal like a successful frame, anything else including a timeout skips the frame
     return RenderResult::Invisible;
   }
 
+  previousUpdateTime = nowTime;
+
+  // Mirror either the spectator view, which is already in the transfer source optimal layout, or an eye layer of the
+  // OpenXR swapchain image
   const VkCommandBuffer commandBuffer = renderer->getCurrentCommandBuffer();
-  const VkImage sourceImage = headset->getRenderTarget(swapchainImageIndex)->getImage(); // OpenXR swapchain image
-  const VkImage destinationImage = swapchainImages.at(destinationImageIndex);            // Mirror view swapchain image
+  const VkImage sourceImage =
+    (spectatorView ? spectatorView->getImage() : headset->getRenderTarget(swapchainImageIndex)->getImage());
+  const uint32_t sourceLayer = (spectatorView ? 0u : static_cast<uint32_t>(mirrorEyeIndex));
+  const VkImage destinationImage = swapchain->getImage(destinationImageIndex); // Mirror view swapchain image
 
   // Transition the layer of the OpenXR swapchain image that is to be mirrored in the mirror view to the transfer source
   // optimal layout and transition the mirror view swapchain image to the transfer destination optimal layout. Also
@@ -179,7 +212,7 @@ MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
     sourceImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
     sourceImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     sourceImageMemoryBarrier.subresourceRange.layerCount = 1u;
-    sourceImageMemoryBarrier.subresourceRange.baseArrayLayer = static_cast<uint32_t>(mirrorEyeIndex);
+    sourceImageMemoryBarrier.subresourceRange.baseArrayLayer = sourceLayer;
     sourceImageMemoryBarrier.subresourceRange.levelCount = 1u;
     sourceImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
 
@@ -195,17 +228,25 @@ MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
     destinationImageMemoryBarrier.subresourceRange.levelCount = 1u;
     destinationImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
 
-    const std::array imageMemoryBarriers = { sourceImageMemoryBarrier, destinationImageMemoryBarrier };
+    std::vector<VkImageMemoryBarrier> imageMemoryBarriers = { destinationImageMemoryBarrier };
+    if (!spectatorView)
+    {
+      imageMemoryBarriers.push_back(sourceImageMemoryBarrier);
+    }
+
     vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
                          VK_DEPENDENCY_BY_REGION_BIT, 0u, nullptr, 0u, nullptr,
                          static_cast<uint32_t>(imageMemoryBarriers.size()), imageMemoryBarriers.data());
   }
 
-  // We need to crop the source image region to preserve the aspect ratio of the mirror view window
-  const VkExtent2D eyeResolution = headset->getEyeResolution(mirrorEyeIndex);
-  const glm::vec2 sourceResolution = { static_cast<float>(eyeResolution.width),
-                                       static_cast<float>(eyeResolution.height) };
+  // We need to crop the source image region to preserve the aspect ratio of the mirror view window, only the part of
+  // the eye at the current resolution scale has been rendered
+  const VkExtent2D sourceExtent =
+    (spectatorView ? spectatorView->getResolution() : headset->getScaledEyeResolution(mirrorEyeIndex));
+  const glm::vec2 sourceResolution = { static_cast<float>(sourceExtent.width),
+                                       static_cast<float>(sourceExtent.height) };
   const float sourceAspectRatio = sourceResolution.x / sourceResolution.y;
+  const VkExtent2D swapchainResolution = swapchain->getResolution();
   const glm::vec2 destinationResolution = { static_cast<float>(swapchainResolution.width),
                                             static_cast<float>(swapchainResolution.height) };
   const float destinationAspectRatio = destinationResolution.x / destinationResolution.y;
@@ -229,7 +270,7 @@ MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
                               static_cast<int32_t>(cropOffset.y + cropResolution.y), 1 };
   imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   imageBlit.srcSubresource.mipLevel = 0u;
-  imageBlit.srcSubresource.baseArrayLayer = static_cast<uint32_t>(mirrorEyeIndex);
+  imageBlit.srcSubresource.baseArrayLayer = sourceLayer;
   imageBlit.srcSubresource.layerCount = 1u;
 
   imageBlit.dstOffsets[0] = { 0, 0, 0 };
@@ -256,7 +297,7 @@ MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
     sourceImageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
     sourceImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     sourceImageMemoryBarrier.subresourceRange.layerCount = 1u;
-    sourceImageMemoryBarrier.subresourceRange.baseArrayLayer = static_cast<uint32_t>(mirrorEyeIndex);
+    sourceImageMemoryBarrier.subresourceRange.baseArrayLayer = sourceLayer;
     sourceImageMemoryBarrier.subresourceRange.levelCount = 1u;
     sourceImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
 
@@ -272,7 +313,12 @@ MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
     destinationImageMemoryBarrier.subresourceRange.levelCount = 1u;
     destinationImageMemoryBarrier.subresourceRange.baseMipLevel = 0u;
 
-    const std::array imageMemoryBarriers = { sourceImageMemoryBarrier, destinationImageMemoryBarrier };
+    std::vector<VkImageMemoryBarrier> imageMemoryBarriers = { destinationImageMemoryBarrier };
+    if (!spectatorView)
+    {
+      imageMemoryBarriers.push_back(sourceImageMemoryBarrier);
+    }
+
     vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
                          VK_DEPENDENCY_BY_REGION_BIT, 0u, nullptr, 0u, nullptr,
                          static_cast<uint32_t>(imageMemoryBarriers.size()), imageMemoryBarriers.data());
@@ -284,22 +330,20 @@ MirrorView::RenderResult MirrorView::render(uint32_t swapchainImageIndex)
 void MirrorView::present()
 {
   const VkSemaphore presentableSemaphore = renderer->getCurrentPresentableSemaphore();
+  const VkSwapchainKHR presentSwapchain = swapchain->getSwapchain();
 
   VkPresentInfoKHR presentInfo{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
   presentInfo.waitSemaphoreCount = 1u;
   presentInfo.pWaitSemaphores = &presentableSemaphore;
   presentInfo.swapchainCount = 1u;
-  presentInfo.pSwapchains = &swapchain;
+  presentInfo.pSwapchains = &presentSwapchain;
   presentInfo.pImageIndices = &destinationImageIndex;
 
   const VkResult result = vkQueuePresentKHR(context->getVkPresentQueue(), &presentInfo);
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
   {
-    // Recreate the swapchain for the next frame if necessary
-    if (!recreateSwapchain())
-    {
-      return;
-    }
+    // Recreate the swapchain before the next frame, this runs on the submission thread which must not touch the window
+    swapchainOutOfDate = true;
   }
   else if (result != VK_SUCCESS)
   {
@@ -325,128 +369,5 @@ VkSurfaceKHR MirrorView::getSurface() const
 bool MirrorView::recreateSwapchain()
 {
   context->sync();
-
-  const VkPhysicalDevice physicalDevice = context->getVkPhysicalDevice();
-
-  // Get the surface capabilities and extent
-  VkSurfaceCapabilitiesKHR surfaceCapabilities;
-  {
-    if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities) != VK_SUCCESS)
-    {
-      util::error(Error::GenericVulkan);
-      return false;
-    }
-
-    if (!(surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
-    {
-      util::error(Error::GenericVulkan);
-      return false;
-    }
-
-    if (surfaceCapabilities.currentExtent.width != std::numeric_limits<uint32_t>::max() &&
-        surfaceCapabilities.currentExtent.height != std::numeric_limits<uint32_t>::max())
-    {
-      // Use any valid extent
-      swapchainResolution = surfaceCapabilities.currentExtent;
-    }
-    else
-    {
-      // Find the closest extent to use instead of an invalid extent
-      int width, height;
-      glfwGetFramebufferSize(window, &width, &height);
-
-      swapchainResolution.width = glm::clamp(width, static_cast<int>(surfaceCapabilities.minImageExtent.width),
-                                             static_cast<int>(surfaceCapabilities.maxImageExtent.width));
-      swapchainResolution.height = glm::clamp(height, static_cast<int>(surfaceCapabilities.minImageExtent.height),
-                                              static_cast<int>(surfaceCapabilities.maxImageExtent.height));
-    }
-
-    // Skip the rest if the window was minimized
-    if (swapchainResolution.width == 0u || swapchainResolution.height == 0u)
-    {
-      return true;
-    }
-  }
-
-  // Get the surface formats and pick one with the desired color format support
-  VkSurfaceFormatKHR surfaceFormat;
-  {
-    uint32_t surfaceFormatCount = 0u;
-    if (vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &surfaceFormatCount, nullptr) != VK_SUCCESS)
-    {
-      util::error(Error::GenericVulkan);
-      return false;
-    }
-
-    std::vector<VkSurfaceFormatKHR> surfaceFormats(surfaceFormatCount);
-    if (vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &surfaceFormatCount, surfaceFormats.data()) !=
-        VK_SUCCESS)
-    {
-      util::error(Error::GenericVulkan);
-      return false;
-    }
-
-    // Find the surface format to use
-    bool surfaceFormatFound = false;
-    for (const VkSurfaceFormatKHR& surfaceFormatCandidate : surfaceFormats)
-    {
-      if (surfaceFormatCandidate.format == colorFormat)
-      {
-        surfaceFormat = surfaceFormatCandidate;
-        surfaceFormatFound = true;
-        break;
-      }
-    }
-
-    if (!surfaceFormatFound)
-    {
-      util::error(Error::FeatureNotSupported, "Vulkan swapchain color format");
-      return false;
-    }
-  }
-
-  const VkDevice vkDevice = context->getVkDevice();
-
-  // Clean up before recreating the swapchain and render targets
-  if (swapchain)
-  {
-    vkDestroySwapchainKHR(vkDevice, swapchain, nullptr);
-  }
-
-  // Create a new swapchain
-  VkSwapchainCreateInfoKHR swapchainCreateInfo{ VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
-  swapchainCreateInfo.surface = surface;
-  swapchainCreateInfo.presentMode = presentMode;
-  swapchainCreateInfo.minImageCount = surfaceCapabilities.minImageCount + 1u;
-  swapchainCreateInfo.imageColorSpace = surfaceFormat.colorSpace;
-  swapchainCreateInfo.imageFormat = surfaceFormat.format;
-  swapchainCreateInfo.imageExtent = swapchainResolution;
-  swapchainCreateInfo.imageArrayLayers = 1u;
-  swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-  swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-  swapchainCreateInfo.preTransform = surfaceCapabilities.currentTransform;
-  swapchainCreateInfo.clipped = VK_TRUE;
-  swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-  if (vkCreateSwapchainKHR(vkDevice, &swapchainCreateInfo, nullptr, &swapchain) != VK_SUCCESS)
-  {
-    util::error(Error::GenericVulkan);
-    return false;
-  }
-
-  // Retrieve the new swapchain images
-  uint32_t swapchainImageCount = 0u;
-  if (vkGetSwapchainImagesKHR(vkDevice, swapchain, &swapchainImageCount, nullptr) != VK_SUCCESS)
-  {
-    util::error(Error::GenericVulkan);
-    return false;
-  }
-
-  swapchainImages.resize(swapchainImageCount);
-  if (vkGetSwapchainImagesKHR(vkDevice, swapchain, &swapchainImageCount, swapchainImages.data()) != VK_SUCCESS)
-  {
-    util::error(Error::GenericVulkan);
-    return false;
-  }
-
-  return true;
+  return swapchain->recreate();
 }
\ No newline at end of file
@@ -2,17 +2,21 @@
 
 #include <vulkan/vulkan.h>
 
-#include <vector>
+#include <chrono>
 
 class Context;
 struct GLFWwindow;
 class Headset;
 class Renderer;
+class SpectatorView;
+class WindowSwapchain;
 
 /*
  * The mirror view class handles the creation, updating, resizing, and eventual closing of the desktop window that shows
  * a copy of what is rendered into the headset. It depends on GLFW for handling the operating system, and Vulkan for the
- * blitting into the window surface.
+ * blitting into the window surface. The mirror view never blocks the headset, it skips frames when no swapchain image
+ * is available right away and is updated at a lower rate than the headset. If there is a spectator view, the mirror
+ * view shows it instead of an eye and is updated whenever the spectator view is.
  */
 class MirrorView final
 {
@@ -22,8 +26,9 @@ public:
 
   void onWindowResize();
 
-  bool connect(const Headset* headset, const Renderer* renderer);
+  bool connect(const Headset* headset, const Renderer* renderer, const SpectatorView* spectatorView); // Optional view
   void processWindowEvents() const;
+  void waitForWindowEvents(double timeout) const; // In seconds, blocks until an event arrives or the timeout expires
 
   enum class RenderResult
   {
@@ -44,16 +49,17 @@ private:
   const Context* context = nullptr;
   const Headset* headset = nullptr;
   const Renderer* renderer = nullptr;
+  const SpectatorView* spectatorView = nullptr;
 
   GLFWwindow* window = nullptr;
 
   VkSurfaceKHR surface = nullptr;
-  VkSwapchainKHR swapchain = nullptr;
-  std::vector<VkImage> swapchainImages;
-  VkExtent2D swapchainResolution = { 0u, 0u };
+  WindowSwapchain* swapchain = nullptr;
 
   uint32_t destinationImageIndex = 0u;
   bool resizeDetected = false;
+  bool swapchainOutOfDate = false; // Set when presenting, which happens before the next frame is rendered
+  std::chrono::high_resolution_clock::time_point previousUpdateTime;
 
   bool recreateSwapchain();
 };
\ No newline at end of file
@@ -1,15 +1,28 @@
 #pragma once
 
 #include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
 
 /*
  * The model struct holds all required information to orientate and render a model. It handles orientation with a world
  * transformation matrix and has its indexing information populated by the mesh data class. This struct represents a
- * single draw call and is used by the renderer class to know how and where to draw a model.
+ * single draw call and is used by the renderer class to know how and where to draw a model. The technique determines
+ * which pipeline the model is drawn with, models sharing a technique are drawn together in a single indirect draw. The
+ * bounds are in model space and are used to cull the model on the GPU. Static models never move after loading, which
+ * allows the mesh data class to bake them into world space batches.
  */
 struct Model final
 {
+  enum class Technique
+  {
+    Grid,
+    Diffuse
+  };
+  Technique technique = Technique::Diffuse;
+  bool isStatic = false;
+
   size_t firstIndex = 0u;
   size_t indexCount = 0u;
+  glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
   glm::mat4 worldMatrix;
 };
\ No newline at end of file
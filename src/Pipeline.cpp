@@ -5,6 +5,7 @@
 
 #include <array>
 #include <sstream>
+#include <vector>
 
 Pipeline::Pipeline(const Context* context,
                    VkPipelineLayout pipelineLayout,
@@ -28,9 +29,9 @@ Pipeline::Pipeline(const Context* context,
     return;
   }
 
-  // Load the fragment shader
-  VkShaderModule fragmentShaderModule;
-  if (!util::loadShaderFromFile(device, fragmentFilename, fragmentShaderModule))
+  // Load the fragment shader, if any
+  VkShaderModule fragmentShaderModule = nullptr;
+  if (!fragmentFilename.empty() && !util::loadShaderFromFile(device, fragmentFilename, fragmentShaderModule))
   {
     std::stringstream s;
     s << "Fragment shader \"" << fragmentFilename << "\"";
@@ -53,7 +54,11 @@ Pipeline::Pipeline(const Context* context,
   pipelineShaderStageCreateInfoFragment.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
   pipelineShaderStageCreateInfoFragment.pName = "main";
 
-  const std::array shaderStages = { pipelineShaderStageCreateInfoVertex, pipelineShaderStageCreateInfoFragment };
+  std::vector<VkPipelineShaderStageCreateInfo> shaderStages = { pipelineShaderStageCreateInfoVertex };
+  if (fragmentShaderModule)
+  {
+    shaderStages.push_back(pipelineShaderStageCreateInfoFragment);
+  }
 
   VkPipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo{
     VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO
@@ -93,8 +98,11 @@ Pipeline::Pipeline(const Context* context,
     VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO
   };
   VkPipelineColorBlendAttachmentState pipelineColorBlendAttachmentState{};
-  pipelineColorBlendAttachmentState.colorWriteMask =
-    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  if (fragmentShaderModule)
+  {
+    pipelineColorBlendAttachmentState.colorWriteMask =
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  }
   pipelineColorBlendAttachmentState.blendEnable = VK_TRUE;
   pipelineColorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
   pipelineColorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
@@ -142,7 +150,10 @@ Pipeline::Pipeline(const Context* context,
 
   // These shader modules can now be destroyed
   vkDestroyShaderModule(device, vertexShaderModule, nullptr);
-  vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+  if (fragmentShaderModule)
+  {
+    vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+  }
 }
 
 Pipeline::~Pipeline()
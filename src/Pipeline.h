@@ -9,7 +9,7 @@ class Context;
 
 /*
  * The pipeline class wraps a Vulkan pipeline for convenience. It describes the rendering technique to use, including
- * shaders, culling, scissoring, and other aspects.
+ * shaders, culling, scissoring, and other aspects. Without a fragment shader, the pipeline only writes depth.
  */
 class Pipeline final
 {
@@ -18,7 +18,7 @@ public:
            VkPipelineLayout pipelineLayout,
            VkRenderPass renderPass,
            const std::string& vertexFilename,
-           const std::string& fragmentFilename,
+           const std::string& fragmentFilename, // Empty for a depth-only pipeline
            const std::vector<VkVertexInputBindingDescription>& vertexInputBindingDescriptions,
            const std::vector<VkVertexInputAttributeDescription>& vertexInputAttributeDescriptions);
   ~Pipeline();
@@ -4,31 +4,34 @@
 #include "DataBuffer.h"
 #include "Util.h"
 
+#include <algorithm>
 #include <cstring>
 
 RenderProcess::RenderProcess(const Context* context,
-                             VkCommandPool commandPool,
                              VkDescriptorPool descriptorPool,
                              VkDescriptorSetLayout descriptorSetLayout,
-                             size_t modelCount)
+                             VkDescriptorSetLayout uniformDescriptorSetLayout,
+                             VkDeviceSize uniformPageSize,
+                             size_t drawCount,
+                             size_t drawGroupCount,
+                             size_t drawListCount,
+                             size_t workerCount,
+                             size_t renderTargetCount)
 : context(context)
 {
-  // Initialize the uniform buffer data
-  dynamicVertexUniformData.resize(modelCount);
-  for (size_t modelIndex = 0u; modelIndex < modelCount; ++modelIndex)
-  {
-    dynamicVertexUniformData.at(modelIndex).worldMatrix = glm::mat4(1.0f);
-  }
+  const VkDevice device = context->getVkDevice();
 
-  for (glm::mat4& viewProjectionMatrix : staticVertexUniformData.viewProjectionMatrices)
+  // Create a command pool that is reset as a whole every frame
+  VkCommandPoolCreateInfo commandPoolCreateInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = context->getVkDrawQueueFamilyIndex();
+  if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
   {
-    viewProjectionMatrix = glm::mat4(1.0f);
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
   }
 
-  staticFragmentUniformData.time = 0.0f;
-
-  const VkDevice device = context->getVkDevice();
-
   // Allocate a command buffer
   VkCommandBufferAllocateInfo commandBufferAllocateInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
   commandBufferAllocateInfo.commandPool = commandPool;
@@ -51,6 +54,38 @@ RenderProcess::RenderProcess(const Context* context,
   }
 #endif
 
+  // Create a command pool and allocate a secondary command buffer for each render target and recording worker, each
+  // pool holds a single command buffer so that it can be reset on its own when the command buffer is recorded again
+  workerCommandPools.resize(renderTargetCount, std::vector<VkCommandPool>(workerCount, nullptr));
+  workerCommandBuffers.resize(renderTargetCount, std::vector<VkCommandBuffer>(workerCount, nullptr));
+  for (size_t renderTargetIndex = 0u; renderTargetIndex < renderTargetCount; ++renderTargetIndex)
+  {
+    for (size_t workerIndex = 0u; workerIndex < workerCount; ++workerIndex)
+    {
+      VkCommandPool& workerCommandPool = workerCommandPools.at(renderTargetIndex).at(workerIndex);
+      VkCommandPoolCreateInfo workerCommandPoolCreateInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+      workerCommandPoolCreateInfo.queueFamilyIndex = context->getVkDrawQueueFamilyIndex();
+      if (vkCreateCommandPool(device, &workerCommandPoolCreateInfo, nullptr, &workerCommandPool) != VK_SUCCESS)
+      {
+        util::error(Error::GenericVulkan);
+        valid = false;
+        return;
+      }
+
+      VkCommandBuffer& workerCommandBuffer = workerCommandBuffers.at(renderTargetIndex).at(workerIndex);
+      VkCommandBufferAllocateInfo workerCommandBufferAllocateInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+      workerCommandBufferAllocateInfo.commandPool = workerCommandPool;
+      workerCommandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      workerCommandBufferAllocateInfo.commandBufferCount = 1u;
+      if (vkAllocateCommandBuffers(device, &workerCommandBufferAllocateInfo, &workerCommandBuffer) != VK_SUCCESS)
+      {
+        util::error(Error::GenericVulkan);
+        valid = false;
+        return;
+      }
+    }
+  }
+
   // Create semaphores
   VkSemaphoreCreateInfo semaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
   if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &drawableSemaphore) != VK_SUCCESS)
@@ -67,124 +102,113 @@ RenderProcess::RenderProcess(const Context* context,
     return;
   }
 
-  // Create a fence
-  VkFenceCreateInfo fenceCreateInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-  fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Make sure the fence starts off signaled
-  if (vkCreateFence(device, &fenceCreateInfo, nullptr, &busyFence) != VK_SUCCESS)
+  // Create a query pool for the timestamps of a frame
+  VkQueryPoolCreateInfo queryPoolCreateInfo{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+  queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolCreateInfo.queryCount = RenderProcess::timestampCount;
+  if (vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &timestampQueryPool) != VK_SUCCESS)
   {
     util::error(Error::GenericVulkan);
     valid = false;
     return;
   }
 
-  const VkDeviceSize uniformBufferOffsetAlignment = context->getUniformBufferOffsetAlignment();
-
-  // Partition the uniform buffer data
-  std::array<VkDescriptorBufferInfo, 3u> descriptorBufferInfos;
-
-  descriptorBufferInfos.at(0u).offset = 0u;
-  descriptorBufferInfos.at(0u).range = sizeof(DynamicVertexUniformData);
-
-  descriptorBufferInfos.at(1u).offset = util::align(descriptorBufferInfos.at(0u).range, uniformBufferOffsetAlignment) *
-                                        static_cast<VkDeviceSize>(modelCount);
-  descriptorBufferInfos.at(1u).range = sizeof(StaticVertexUniformData);
-
-  descriptorBufferInfos.at(2u).offset =
-    descriptorBufferInfos.at(1u).offset + util::align(descriptorBufferInfos.at(1u).range, uniformBufferOffsetAlignment);
-  descriptorBufferInfos.at(2u).range = sizeof(StaticFragmentUniformData);
-
-  // Create an empty uniform buffer
-  const VkDeviceSize uniformBufferSize = descriptorBufferInfos.at(2u).offset + descriptorBufferInfos.at(2u).range;
-  uniformBuffer =
-    new DataBuffer(context, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBufferSize);
-  if (!uniformBuffer->isValid())
+  // Create a uniform allocator for the per-frame constants
+  uniformAllocator = new UniformAllocator(context, uniformDescriptorSetLayout, uniformPageSize);
+  if (!uniformAllocator->isValid())
   {
     valid = false;
     return;
   }
 
-  // Map the uniform buffer memory
-  uniformBufferMemory = uniformBuffer->map();
-  if (!uniformBufferMemory)
+  // Create the draw count buffer and a descriptor set for each draw list
+  drawLists.resize(drawListCount);
+  for (DrawList& drawList : drawLists)
   {
-    valid = false;
-    return;
+    // Create an empty draw count buffer with one count per draw group, it stays host visible to allow reading it back
+    const VkDeviceSize drawCountBufferSize = sizeof(uint32_t) * static_cast<VkDeviceSize>(drawGroupCount);
+    drawList.drawCountBuffer =
+      new DataBuffer(context,
+                     VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, drawCountBufferSize);
+    if (!drawList.drawCountBuffer->isValid())
+    {
+      valid = false;
+      return;
+    }
+
+    // Map the draw count buffer memory
+    drawList.drawCountBufferMemory = static_cast<uint32_t*>(drawList.drawCountBuffer->map());
+    if (!drawList.drawCountBufferMemory)
+    {
+      valid = false;
+      return;
+    }
+
+    memset(drawList.drawCountBufferMemory, 0, static_cast<size_t>(drawCountBufferSize));
+
+    // Allocate a descriptor set
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+    descriptorSetAllocateInfo.descriptorSetCount = 1u;
+    descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout;
+    const VkResult result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &drawList.descriptorSet);
+    if (result != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      valid = false;
+      return;
+    }
+
+    // Point the descriptor set at the draw count buffer, the indirect buffer is added once it has been created
+    VkDescriptorBufferInfo descriptorBufferInfo;
+    descriptorBufferInfo.buffer = drawList.drawCountBuffer->getBuffer();
+    descriptorBufferInfo.offset = 0u;
+    descriptorBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writeDescriptorSet{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    writeDescriptorSet.dstSet = drawList.descriptorSet;
+    writeDescriptorSet.dstBinding = 1u;
+    writeDescriptorSet.dstArrayElement = 0u;
+    writeDescriptorSet.descriptorCount = 1u;
+    writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSet.pBufferInfo = &descriptorBufferInfo;
+    vkUpdateDescriptorSets(device, 1u, &writeDescriptorSet, 0u, nullptr);
   }
 
-  // Allocate a descriptor set
-  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
-  descriptorSetAllocateInfo.descriptorSetCount = 1u;
-  descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout;
-  const VkResult result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet);
-  if (result != VK_SUCCESS)
+  // Create the indirect buffers with room for all current draws
+  if (!reserveDraws(std::max<size_t>(drawCount, 1u)))
   {
-    util::error(Error::GenericVulkan);
     valid = false;
     return;
   }
-
-  // Associate the uniform buffer with each descriptor buffer info
-  for (VkDescriptorBufferInfo& descriptorBufferInfo : descriptorBufferInfos)
-  {
-    descriptorBufferInfo.buffer = uniformBuffer->getBuffer();
-  }
-
-  // Update the descriptor sets
-  std::array<VkWriteDescriptorSet, 3u> writeDescriptorSets;
-
-  writeDescriptorSets.at(0u).sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writeDescriptorSets.at(0u).pNext = nullptr;
-  writeDescriptorSets.at(0u).dstSet = descriptorSet;
-  writeDescriptorSets.at(0u).dstBinding = 0u;
-  writeDescriptorSets.at(0u).dstArrayElement = 0u;
-  writeDescriptorSets.at(0u).descriptorCount = 1u;
-  writeDescriptorSets.at(0u).descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-  writeDescriptorSets.at(0u).pBufferInfo = &descriptorBufferInfos.at(0u);
-  writeDescriptorSets.at(0u).pImageInfo = nullptr;
-  writeDescriptorSets.at(0u).pTexelBufferView = nullptr;
-
-  writeDescriptorSets.at(1u).sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writeDescriptorSets.at(1u).pNext = nullptr;
-  writeDescriptorSets.at(1u).dstSet = descriptorSet;
-  writeDescriptorSets.at(1u).dstBinding = 1u;
-  writeDescriptorSets.at(1u).dstArrayElement = 0u;
-  writeDescriptorSets.at(1u).descriptorCount = 1u;
-  writeDescriptorSets.at(1u).descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  writeDescriptorSets.at(1u).pBufferInfo = &descriptorBufferInfos.at(1u);
-  writeDescriptorSets.at(1u).pImageInfo = nullptr;
-  writeDescriptorSets.at(1u).pTexelBufferView = nullptr;
-
-  writeDescriptorSets.at(2u).sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writeDescriptorSets.at(2u).pNext = nullptr;
-  writeDescriptorSets.at(2u).dstSet = descriptorSet;
-  writeDescriptorSets.at(2u).dstBinding = 2u;
-  writeDescriptorSets.at(2u).dstArrayElement = 0u;
-  writeDescriptorSets.at(2u).descriptorCount = 1u;
-  writeDescriptorSets.at(2u).descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  writeDescriptorSets.at(2u).pBufferInfo = &descriptorBufferInfos.at(2u);
-  writeDescriptorSets.at(2u).pImageInfo = nullptr;
-  writeDescriptorSets.at(2u).pTexelBufferView = nullptr;
-
-  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0u,
-                         nullptr);
 }
 
 RenderProcess::~RenderProcess()
 {
-  if (uniformBuffer)
+  delete densityMapBuffer;
+  delete visibilityMaskBuffer;
+
+  for (const DrawList& drawList : drawLists)
   {
-    uniformBuffer->unmap();
+    if (drawList.drawCountBuffer)
+    {
+      drawList.drawCountBuffer->unmap();
+    }
+    delete drawList.drawCountBuffer;
+
+    delete drawList.indirectBuffer;
   }
-  delete uniformBuffer;
+
+  delete uniformAllocator;
 
   const VkDevice device = context->getVkDevice();
   if (device)
   {
-    if (busyFence)
+    if (timestampQueryPool)
     {
-      vkDestroyFence(device, busyFence, nullptr);
+      vkDestroyQueryPool(device, timestampQueryPool, nullptr);
     }
 
     if (presentableSemaphore)
@@ -196,9 +220,70 @@ RenderProcess::~RenderProcess()
     {
       vkDestroySemaphore(device, drawableSemaphore, nullptr);
     }
+
+    for (const std::vector<VkCommandPool>& renderTargetCommandPools : workerCommandPools)
+    {
+      for (const VkCommandPool workerCommandPool : renderTargetCommandPools)
+      {
+        if (workerCommandPool)
+        {
+          vkDestroyCommandPool(device, workerCommandPool, nullptr);
+        }
+      }
+    }
+
+    if (commandPool)
+    {
+      vkDestroyCommandPool(device, commandPool, nullptr);
+    }
   }
 }
 
+bool RenderProcess::reserveDraws(size_t drawCount)
+{
+  if (drawCount <= drawCapacity)
+  {
+    return true;
+  }
+
+  // Grow geometrically, so that adding models one at a time only rarely replaces the indirect buffers
+  drawCapacity = std::max(drawCount, drawCapacity * 2u);
+
+  const VkDevice device = context->getVkDevice();
+  for (DrawList& drawList : drawLists)
+  {
+    // Replace the indirect buffer with an empty one that is only ever written by the GPU
+    delete drawList.indirectBuffer;
+    const VkDeviceSize indirectBufferSize =
+      sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(drawCapacity);
+    drawList.indirectBuffer =
+      new DataBuffer(context, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirectBufferSize);
+    if (!drawList.indirectBuffer->isValid())
+    {
+      drawCapacity = 0u;
+      return false;
+    }
+
+    // Point the descriptor set at the new indirect buffer, the draw count buffer stays the same
+    VkDescriptorBufferInfo descriptorBufferInfo;
+    descriptorBufferInfo.buffer = drawList.indirectBuffer->getBuffer();
+    descriptorBufferInfo.offset = 0u;
+    descriptorBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writeDescriptorSet{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    writeDescriptorSet.dstSet = drawList.descriptorSet;
+    writeDescriptorSet.dstBinding = 0u;
+    writeDescriptorSet.dstArrayElement = 0u;
+    writeDescriptorSet.descriptorCount = 1u;
+    writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSet.pBufferInfo = &descriptorBufferInfo;
+    vkUpdateDescriptorSets(device, 1u, &writeDescriptorSet, 0u, nullptr);
+  }
+
+  return true;
+}
+
 bool RenderProcess::isValid() const
 {
   return valid;
@@ -209,6 +294,26 @@ VkCommandBuffer RenderProcess::getCommandBuffer() const
   return commandBuffer;
 }
 
+VkCommandPool RenderProcess::getCommandPool() const
+{
+  return commandPool;
+}
+
+VkCommandPool RenderProcess::getWorkerCommandPool(size_t renderTargetIndex, size_t workerIndex) const
+{
+  return workerCommandPools.at(renderTargetIndex).at(workerIndex);
+}
+
+VkCommandBuffer RenderProcess::getWorkerCommandBuffer(size_t renderTargetIndex, size_t workerIndex) const
+{
+  return workerCommandBuffers.at(renderTargetIndex).at(workerIndex);
+}
+
+const std::vector<VkCommandBuffer>& RenderProcess::getWorkerCommandBuffers(size_t renderTargetIndex) const
+{
+  return workerCommandBuffers.at(renderTargetIndex);
+}
+
 VkSemaphore RenderProcess::getDrawableSemaphore() const
 {
   return drawableSemaphore;
@@ -219,37 +324,38 @@ VkSemaphore RenderProcess::getPresentableSemaphore() const
   return presentableSemaphore;
 }
 
-VkFence RenderProcess::getBusyFence() const
+VkQueryPool RenderProcess::getTimestampQueryPool() const
 {
-  return busyFence;
+  return timestampQueryPool;
 }
 
-VkDescriptorSet RenderProcess::getDescriptorSet() const
+VkDescriptorSet RenderProcess::getDescriptorSet(size_t drawListIndex) const
 {
-  return descriptorSet;
+  return drawLists.at(drawListIndex).descriptorSet;
 }
 
-void RenderProcess::updateUniformBufferData() const
+VkBuffer RenderProcess::getIndirectBuffer(size_t drawListIndex) const
 {
-  if (!uniformBufferMemory)
-  {
-    return;
-  }
+  return drawLists.at(drawListIndex).indirectBuffer->getBuffer();
+}
 
-  const VkDeviceSize uniformBufferOffsetAlignment = context->getUniformBufferOffsetAlignment();
+VkBuffer RenderProcess::getDrawCountBuffer(size_t drawListIndex) const
+{
+  return drawLists.at(drawListIndex).drawCountBuffer->getBuffer();
+}
 
-  char* offset = static_cast<char*>(uniformBufferMemory);
-  VkDeviceSize length = sizeof(DynamicVertexUniformData);
-  for (const DynamicVertexUniformData& dynamicData : dynamicVertexUniformData)
+uint32_t RenderProcess::getDrawCount(size_t drawListIndex, size_t drawGroupIndex) const
+{
+  const uint32_t* drawCountBufferMemory = drawLists.at(drawListIndex).drawCountBufferMemory;
+  if (!drawCountBufferMemory)
   {
-    memcpy(offset, &dynamicData, length);
-    offset += util::align(length, uniformBufferOffsetAlignment);
+    return 0u;
   }
 
-  length = sizeof(StaticVertexUniformData);
-  memcpy(offset, &staticVertexUniformData, length);
-  offset += util::align(length, uniformBufferOffsetAlignment);
+  return drawCountBufferMemory[drawGroupIndex];
+}
 
-  length = sizeof(StaticFragmentUniformData);
-  memcpy(offset, &staticFragmentUniformData, length);
+UniformAllocator* RenderProcess::getUniformAllocator() const
+{
+  return uniformAllocator;
 }
\ No newline at end of file
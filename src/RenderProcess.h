@@ -1,10 +1,9 @@
 #pragma once
 
-#include <glm/mat4x4.hpp>
+#include "UniformAllocator.h"
 
 #include <vulkan/vulkan.h>
 
-#include <array>
 #include <vector>
 
 class Context;
@@ -13,53 +12,89 @@ class DataBuffer;
 /*
  * The render process class consolidates all the resources that needs to be duplicated for each frame that can be
  * rendered to in parallel. The renderer owns a render process for each frame that can be processed at the same time,
- * and each render process holds their own uniform buffer, command buffer, semaphore and fence. With this duplication,
- * the application can be sure that one frame does not modify a resource that is still in use by another simultaneous
- * frame.
+ * and each render process holds their own uniform allocator, indirect buffers, command buffer and semaphores. With this
+ * duplication, the application can be sure that one frame does not modify a resource that is still in use by another
+ * simultaneous frame. The indirect buffer and the draw count buffer of each draw list are written by the culling
+ * compute shader on the GPU, the draw counts can be read back on the CPU once the frame has finished. The indirect
+ * buffers grow along with the number of draws. There is a draw list for the headset and, if there is one, another for
+ * the spectator view, so that both are culled separately. Each recording worker has its own command pool and secondary
+ * command buffer per render target, so that workers never have to share a command pool and the secondary command
+ * buffers can be kept and replayed for as long as they are up to date.
  */
 class RenderProcess final
 {
 public:
   RenderProcess(const Context* context,
-                VkCommandPool commandPool,
                 VkDescriptorPool descriptorPool,
                 VkDescriptorSetLayout descriptorSetLayout,
-                size_t modelCount);
+                VkDescriptorSetLayout uniformDescriptorSetLayout,
+                VkDeviceSize uniformPageSize,
+                size_t drawCount,
+                size_t drawGroupCount,
+                size_t drawListCount,
+                size_t workerCount,
+                size_t renderTargetCount);
   ~RenderProcess();
 
-  struct DynamicVertexUniformData
-  {
-    glm::mat4 worldMatrix;
-  };
-  std::vector<DynamicVertexUniformData> dynamicVertexUniformData;
+  // The timestamps of a frame are written at its start, once the culling pass is done, once the drawable semaphore has
+  // been waited on and at its end, so that the wait can be left out of the GPU frame time
+  static constexpr uint32_t timestampCount = 4u;
 
-  struct StaticVertexUniformData
-  {
-    std::array<glm::mat4, 2u> viewProjectionMatrices; // 0 = left eye, 1 = right eye
-  } staticVertexUniformData;
+  // The world matrices of all models followed by their draw inputs are kept in a persistent block of the uniform
+  // allocator and are only rewritten when they change. The renderer allocates the block when it first uses the render
+  // process, and again with more room once models have been added that no longer fit
+  UniformAllocator::Allocation modelAllocation;
+  size_t modelCapacity = 0u; // Of the block
+  uint64_t frame = 0u; // Of the frame timeline, the render process is free to use again once this frame has completed
+  std::vector<size_t> worldMatrixGenerations; // Of each world matrix at the time it was last written into the block
+  size_t drawInputCount = 0u; // Written into the block, all draw inputs move whenever a model is added
 
-  struct StaticFragmentUniformData
-  {
-    float time;
-  } staticFragmentUniformData;
+  // The visibility mask of all eyes as vertices followed by indices, rebuilt when the render process is next used after
+  // the mask has changed
+  DataBuffer* visibilityMaskBuffer = nullptr;
+  VkDeviceSize visibilityMaskIndexOffset = 0u; // In bytes
+  uint32_t visibilityMaskIndexCount = 0u;
+  size_t visibilityMaskGeneration = 0u; // Of the headset at the time the mask was last built
+
+  // Staging memory for uploading the fragment density map, created when the render process first uploads it
+  DataBuffer* densityMapBuffer = nullptr;
+
+  bool reserveDraws(size_t drawCount); // Grows the indirect buffers if needed, only call while not in use by the GPU
 
   bool isValid() const;
+  VkCommandPool getCommandPool() const;
   VkCommandBuffer getCommandBuffer() const;
+  VkCommandPool getWorkerCommandPool(size_t renderTargetIndex, size_t workerIndex) const;
+  VkCommandBuffer getWorkerCommandBuffer(size_t renderTargetIndex, size_t workerIndex) const;
+  const std::vector<VkCommandBuffer>& getWorkerCommandBuffers(size_t renderTargetIndex) const;
   VkSemaphore getDrawableSemaphore() const;
   VkSemaphore getPresentableSemaphore() const;
-  VkFence getBusyFence() const;
-  VkDescriptorSet getDescriptorSet() const;
-
-  void updateUniformBufferData() const;
+  VkQueryPool getTimestampQueryPool() const;
+  VkDescriptorSet getDescriptorSet(size_t drawListIndex) const;
+  VkBuffer getIndirectBuffer(size_t drawListIndex) const;
+  VkBuffer getDrawCountBuffer(size_t drawListIndex) const;
+  uint32_t getDrawCount(size_t drawListIndex, size_t drawGroupIndex) const;
+  UniformAllocator* getUniformAllocator() const;
 
 private:
   bool valid = true;
 
   const Context* context = nullptr;
+  VkCommandPool commandPool = nullptr;
   VkCommandBuffer commandBuffer = nullptr;
+  std::vector<std::vector<VkCommandPool>> workerCommandPools;     // Per render target and worker
+  std::vector<std::vector<VkCommandBuffer>> workerCommandBuffers; // Secondary, per render target and worker
   VkSemaphore drawableSemaphore = nullptr, presentableSemaphore = nullptr;
-  VkFence busyFence = nullptr;
-  DataBuffer* uniformBuffer = nullptr;
-  void* uniformBufferMemory = nullptr;
-  VkDescriptorSet descriptorSet = nullptr;
+  VkQueryPool timestampQueryPool = nullptr;
+  UniformAllocator* uniformAllocator = nullptr;
+
+  // The culling outputs for a single view or set of views, along with the descriptor set that the culling shader uses
+  struct DrawList
+  {
+    DataBuffer *indirectBuffer = nullptr, *drawCountBuffer = nullptr;
+    uint32_t* drawCountBufferMemory = nullptr;
+    VkDescriptorSet descriptorSet = nullptr;
+  };
+  std::vector<DrawList> drawLists;
+  size_t drawCapacity = 0u; // Of the indirect buffers
 };
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include "Util.h"
 
-#include <array>
+#include <vector>
 
 RenderTarget::RenderTarget(VkDevice device,
                            VkImage image,
@@ -11,29 +11,39 @@ RenderTarget::RenderTarget(VkDevice device,
                            VkExtent2D size,
                            VkFormat format,
                            VkRenderPass renderPass,
-                           uint32_t layerCount)
+                           uint32_t layerCount,
+                           VkImageView densityMapImageView,
+                           VkImageView resolveImageView)
 : device(device), image(image)
 {
-  // Create an image view
-  VkImageViewCreateInfo imageViewCreateInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
-  imageViewCreateInfo.image = image;
-  imageViewCreateInfo.format = format;
-  imageViewCreateInfo.viewType = (layerCount == 1u ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_2D_ARRAY);
-  imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
-                                     VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
-  imageViewCreateInfo.subresourceRange.layerCount = layerCount;
-  imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  imageViewCreateInfo.subresourceRange.baseArrayLayer = 0u;
-  imageViewCreateInfo.subresourceRange.baseMipLevel = 0u;
-  imageViewCreateInfo.subresourceRange.levelCount = 1u;
-  if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &imageView) != VK_SUCCESS)
+  // Create an image view, unless the render pass resolves into another image
+  if (!resolveImageView)
   {
-    util::error(Error::GenericVulkan);
-    valid = false;
-    return;
+    VkImageViewCreateInfo imageViewCreateInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    imageViewCreateInfo.image = image;
+    imageViewCreateInfo.format = format;
+    imageViewCreateInfo.viewType = (layerCount == 1u ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+    imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                                       VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+    imageViewCreateInfo.subresourceRange.layerCount = layerCount;
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0u;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0u;
+    imageViewCreateInfo.subresourceRange.levelCount = 1u;
+    if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &imageView) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      valid = false;
+      return;
+    }
   }
 
-  const std::array attachments = { colorImageView, depthImageView, imageView };
+  std::vector<VkImageView> attachments = { colorImageView, depthImageView,
+                                           resolveImageView ? resolveImageView : imageView };
+  if (densityMapImageView)
+  {
+    attachments.push_back(densityMapImageView);
+  }
 
   // Create a framebuffer
   VkFramebufferCreateInfo framebufferCreateInfo{ VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
@@ -4,7 +4,9 @@
 
 /*
  * The render target class represents a convenient combination of an image and a framebuffer in Vulkan. The class is
- * used for the Vulkan swapchain images retrieved by OpenXR for the headset displays.
+ * used for the Vulkan swapchain images retrieved by OpenXR for the headset displays. A fragment density map can be
+ * attached as well if the render pass is foveated, and the render pass can resolve into another image than the one the
+ * render target represents, which is then composited into it after the render pass.
  */
 class RenderTarget final
 {
@@ -16,7 +18,9 @@ public:
                VkExtent2D size,
                VkFormat format,
                VkRenderPass renderPass,
-               uint32_t layerCount);
+               uint32_t layerCount,
+               VkImageView densityMapImageView, // Optional, only for foveated render passes
+               VkImageView resolveImageView);   // Optional, resolves into this view instead of the image
   ~RenderTarget();
 
   bool isValid() const;
@@ -1,31 +1,76 @@
 #include "Renderer.h"
 
+#include "ComputePipeline.h"
 #include "Context.h"
 #include "DataBuffer.h"
+#include "FrameTimeline.h"
 #include "Headset.h"
 #include "MeshData.h"
 #include "Model.h"
 #include "Pipeline.h"
 #include "RenderProcess.h"
 #include "RenderTarget.h"
+#include "SpectatorView.h"
+#include "UniformAllocator.h"
 #include "Util.h"
+#include "WorkerPool.h"
 
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
 
 namespace
 {
-constexpr size_t framesInFlightCount = 2u;
+constexpr size_t minFramesInFlightCount = 1u, maxFramesInFlightCount = 4u;
+constexpr size_t headsetDrawListIndex = 0u, spectatorDrawListIndex = 1u;
+constexpr uint32_t cullWorkgroupSize = 64u; // Matches the local size in the culling shader
+constexpr VkDeviceSize uniformPageSize = 64u * 1024u;
+constexpr size_t minDrawGroupsPerWorker = 8u; // Each draw group only records a single indirect draw
+constexpr VkShaderStageFlags uniformOffsetsStageFlags =
+  VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+// The foveal regions around the foveal center of each eye in normalized device coordinates, everything within the inner
+// radius is shaded at full density, everything within the outer radius at half and everything else at a quarter
+constexpr float fovealRadius = 0.3f, parafovealRadius = 0.6f;
+constexpr uint8_t fovealDensity = 255u, parafovealDensity = 128u, peripheralDensity = 64u;
+
+// Describes a single draw to the culling shader, matches the draw input struct in the shader. The draw inputs follow
+// the world matrices in the same block, so they need to have the same size to be indexed in elements
+struct DrawInputData
+{
+  glm::vec4 boundsMin, boundsMax; // In model space
+  uint32_t indexCount, firstIndex, modelIndex, drawGroupIndex, drawGroupFirstDraw;
+  uint32_t padding[3];
+};
+static_assert(sizeof(DrawInputData) == sizeof(glm::mat4));
+
+// A vertex of the visibility mask, matches the vertex input of the visibility mask shader
+struct VisibilityMaskVertex
+{
+  glm::vec2 position; // In the view space of the eye on the plane z = -1
+  uint32_t eyeIndex;
+};
 } // namespace
 
 Renderer::Renderer(const Context* context,
                    const Headset* headset,
+                   SpectatorView* spectatorView,
                    const MeshData* meshData,
-                   const std::vector<Model*>& models)
-: context(context), headset(headset), models(models)
+                   const std::vector<Model*>& models,
+                   size_t framesInFlightCount)
+: context(context), headset(headset), spectatorView(spectatorView)
 {
   const VkDevice device = context->getVkDevice();
 
-  // Create a command pool
+  // Create a command pool for uploads, the render processes have their own command pools
   VkCommandPoolCreateInfo commandPoolCreateInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
   commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
   commandPoolCreateInfo.queueFamilyIndex = context->getVkDrawQueueFamilyIndex();
@@ -36,19 +81,27 @@ Renderer::Renderer(const Context* context,
     return;
   }
 
-  // Create a descriptor pool
-  std::array<VkDescriptorPoolSize, 2u> descriptorPoolSizes;
+  // Create a frame timeline
+  frameTimeline = new FrameTimeline(context);
+  if (!frameTimeline->isValid())
+  {
+    valid = false;
+    return;
+  }
 
-  descriptorPoolSizes.at(0u).type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-  descriptorPoolSizes.at(0u).descriptorCount = static_cast<uint32_t>(framesInFlightCount);
+  // Cull the spectator view into a draw list of its own, so that it does not affect the draws of the headset
+  drawListCount = (spectatorView ? 2u : 1u);
 
-  descriptorPoolSizes.at(1u).type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  descriptorPoolSizes.at(1u).descriptorCount = static_cast<uint32_t>(framesInFlightCount * 2u);
+  // Create a descriptor pool for the culling descriptor sets, the uniform allocators manage their own descriptor sets.
+  // It is sized for the largest number of frames in flight so that it only needs to be reset when that number changes
+  VkDescriptorPoolSize descriptorPoolSize;
+  descriptorPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  descriptorPoolSize.descriptorCount = static_cast<uint32_t>(maxFramesInFlightCount * drawListCount * 2u);
 
   VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-  descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
-  descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-  descriptorPoolCreateInfo.maxSets = static_cast<uint32_t>(framesInFlightCount);
+  descriptorPoolCreateInfo.poolSizeCount = 1u;
+  descriptorPoolCreateInfo.pPoolSizes = &descriptorPoolSize;
+  descriptorPoolCreateInfo.maxSets = static_cast<uint32_t>(maxFramesInFlightCount * drawListCount);
   if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
   {
     util::error(Error::GenericVulkan);
@@ -56,26 +109,17 @@ Renderer::Renderer(const Context* context,
     return;
   }
 
-  // Create a descriptor set layout
-  std::array<VkDescriptorSetLayoutBinding, 3u> descriptorSetLayoutBindings;
-
-  descriptorSetLayoutBindings.at(0u).binding = 0u;
-  descriptorSetLayoutBindings.at(0u).descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-  descriptorSetLayoutBindings.at(0u).descriptorCount = 1u;
-  descriptorSetLayoutBindings.at(0u).stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-  descriptorSetLayoutBindings.at(0u).pImmutableSamplers = nullptr;
-
-  descriptorSetLayoutBindings.at(1u).binding = 1u;
-  descriptorSetLayoutBindings.at(1u).descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  descriptorSetLayoutBindings.at(1u).descriptorCount = 1u;
-  descriptorSetLayoutBindings.at(1u).stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-  descriptorSetLayoutBindings.at(1u).pImmutableSamplers = nullptr;
-
-  descriptorSetLayoutBindings.at(2u).binding = 2u;
-  descriptorSetLayoutBindings.at(2u).descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  descriptorSetLayoutBindings.at(2u).descriptorCount = 1u;
-  descriptorSetLayoutBindings.at(2u).stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-  descriptorSetLayoutBindings.at(2u).pImmutableSamplers = nullptr;
+  // Create a descriptor set layout for the compacted draw commands and the draw counts of the culling shader
+  std::array<VkDescriptorSetLayoutBinding, 2u> descriptorSetLayoutBindings;
+  for (uint32_t binding = 0u; binding < static_cast<uint32_t>(descriptorSetLayoutBindings.size()); ++binding)
+  {
+    VkDescriptorSetLayoutBinding& descriptorSetLayoutBinding = descriptorSetLayoutBindings.at(binding);
+    descriptorSetLayoutBinding.binding = binding;
+    descriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorSetLayoutBinding.descriptorCount = 1u;
+    descriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    descriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+  }
 
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
   descriptorSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(descriptorSetLayoutBindings.size());
@@ -87,27 +131,45 @@ Renderer::Renderer(const Context* context,
     return;
   }
 
-  // Create a pipeline layout
-  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-  pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout;
-  pipelineLayoutCreateInfo.setLayoutCount = 1u;
-  if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+  // Create a descriptor set layout for a page of a uniform allocator
+  VkDescriptorSetLayoutBinding uniformDescriptorSetLayoutBinding;
+  uniformDescriptorSetLayoutBinding.binding = 0u;
+  uniformDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  uniformDescriptorSetLayoutBinding.descriptorCount = 1u;
+  uniformDescriptorSetLayoutBinding.stageFlags =
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+  uniformDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+
+  descriptorSetLayoutCreateInfo.bindingCount = 1u;
+  descriptorSetLayoutCreateInfo.pBindings = &uniformDescriptorSetLayoutBinding;
+  if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, nullptr, &uniformDescriptorSetLayout) !=
+      VK_SUCCESS)
   {
     util::error(Error::GenericVulkan);
     valid = false;
     return;
   }
 
-  // Create a render process for each frame in flight
-  renderProcesses.resize(framesInFlightCount);
-  for (RenderProcess*& renderProcess : renderProcesses)
+  // Create a pipeline layout, the world matrices along with the draw inputs, the view projection matrices and the time
+  // each come from the page of a uniform allocator that holds them, the culling buffers come last
+  const std::array setLayouts = { uniformDescriptorSetLayout, uniformDescriptorSetLayout, uniformDescriptorSetLayout,
+                                  descriptorSetLayout };
+
+  VkPushConstantRange pushConstantRange;
+  pushConstantRange.stageFlags = uniformOffsetsStageFlags;
+  pushConstantRange.offset = 0u;
+  pushConstantRange.size = sizeof(UniformOffsets);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+  pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+  pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1u;
+  if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
   {
-    renderProcess = new RenderProcess(context, commandPool, descriptorPool, descriptorSetLayout, models.size());
-    if (!renderProcess->isValid())
-    {
-      valid = false;
-      return;
-    }
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
   }
 
   // Create the grid pipeline
@@ -154,6 +216,108 @@ Renderer::Renderer(const Context* context,
     return;
   }
 
+  // Create the depth-only visibility mask pipeline
+  VkVertexInputBindingDescription visibilityMaskInputBindingDescription;
+  visibilityMaskInputBindingDescription.binding = 0u;
+  visibilityMaskInputBindingDescription.stride = sizeof(VisibilityMaskVertex);
+  visibilityMaskInputBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  VkVertexInputAttributeDescription visibilityMaskInputAttributePosition;
+  visibilityMaskInputAttributePosition.binding = 0u;
+  visibilityMaskInputAttributePosition.location = 0u;
+  visibilityMaskInputAttributePosition.format = VK_FORMAT_R32G32_SFLOAT;
+  visibilityMaskInputAttributePosition.offset = offsetof(VisibilityMaskVertex, position);
+
+  VkVertexInputAttributeDescription visibilityMaskInputAttributeEyeIndex;
+  visibilityMaskInputAttributeEyeIndex.binding = 0u;
+  visibilityMaskInputAttributeEyeIndex.location = 1u;
+  visibilityMaskInputAttributeEyeIndex.format = VK_FORMAT_R32_UINT;
+  visibilityMaskInputAttributeEyeIndex.offset = offsetof(VisibilityMaskVertex, eyeIndex);
+
+  visibilityMaskPipeline =
+    new Pipeline(context, pipelineLayout, headset->getVkRenderPass(), "shaders/VisibilityMask.vert.spv", "",
+                 { visibilityMaskInputBindingDescription },
+                 { visibilityMaskInputAttributePosition, visibilityMaskInputAttributeEyeIndex });
+  if (!visibilityMaskPipeline->isValid())
+  {
+    valid = false;
+    return;
+  }
+
+  // Create the grid and diffuse pipelines again for the render pass of the spectator view
+  if (spectatorView)
+  {
+    gridSpectatorPipeline = new Pipeline(context, pipelineLayout, spectatorView->getVkRenderPass(),
+                                         "shaders/Grid.vert.spv", "shaders/Grid.frag.spv",
+                                         { vertexInputBindingDescription },
+                                         { vertexInputAttributePosition, vertexInputAttributeColor });
+    if (!gridSpectatorPipeline->isValid())
+    {
+      valid = false;
+      return;
+    }
+
+    diffuseSpectatorPipeline =
+      new Pipeline(context, pipelineLayout, spectatorView->getVkRenderPass(), "shaders/Diffuse.vert.spv",
+                   "shaders/Diffuse.frag.spv", { vertexInputBindingDescription },
+                   { vertexInputAttributePosition, vertexInputAttributeNormal, vertexInputAttributeColor });
+    if (!diffuseSpectatorPipeline->isValid())
+    {
+      valid = false;
+      return;
+    }
+  }
+
+  // Create the culling pipeline
+  cullPipeline = new ComputePipeline(context, pipelineLayout, "shaders/Cull.comp.spv");
+  if (!cullPipeline->isValid())
+  {
+    valid = false;
+    return;
+  }
+
+  // Group the models by pipeline
+  drawGroups.resize(2u);
+  drawGroups.at(0u).pipelines.push_back(gridPipeline);
+  drawGroups.at(1u).pipelines.push_back(diffusePipeline);
+  if (spectatorView)
+  {
+    drawGroups.at(0u).pipelines.push_back(gridSpectatorPipeline);
+    drawGroups.at(1u).pipelines.push_back(diffuseSpectatorPipeline);
+  }
+  for (Model* model : models)
+  {
+    addModel(model);
+  }
+
+  // Create a worker pool for recording, only add a worker for every few draw groups as recording one costs less than
+  // handing it to another thread, and leave one core to the main thread. There is always at least one worker, as the
+  // first one also draws the visibility mask
+  const size_t coreCount = static_cast<size_t>(std::thread::hardware_concurrency());
+  const size_t maxWorkerCount = std::max<size_t>(coreCount, 2u) - 1u;
+  workerPool = new WorkerPool(std::clamp<size_t>(drawGroups.size() / minDrawGroupsPerWorker, 1u, maxWorkerCount));
+
+  // Create a render process for each frame in flight
+  framesInFlightCount = std::clamp(framesInFlightCount, minFramesInFlightCount, maxFramesInFlightCount);
+  if (!createRenderProcesses(framesInFlightCount))
+  {
+    valid = false;
+    return;
+  }
+
+  // Allocate a command buffer for the uploads
+  VkCommandBuffer uploadCommandBuffer = nullptr;
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1u;
+  if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &uploadCommandBuffer) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
+  }
+
   // Create a vertex index buffer
   {
     // Create a staging buffer
@@ -190,8 +354,7 @@ Renderer::Renderer(const Context* context,
     }
 
     // Copy from the staging to the target buffer
-    if (!stagingBuffer->copyTo(*vertexIndexBuffer, renderProcesses.at(0u)->getCommandBuffer(),
-                               context->getVkDrawQueue()))
+    if (!stagingBuffer->copyTo(*vertexIndexBuffer, uploadCommandBuffer, context->getVkDrawQueue()))
     {
       valid = false;
       return;
@@ -201,12 +364,21 @@ Renderer::Renderer(const Context* context,
     delete stagingBuffer;
   }
 
+  // The uploads have finished as copying waits for the queue to be idle
+  vkFreeCommandBuffers(device, commandPool, 1u, &uploadCommandBuffer);
+
   indexOffset = meshData->getIndexOffset();
 }
 
 Renderer::~Renderer()
 {
+  delete frameTimeline;
+  delete workerPool;
   delete vertexIndexBuffer;
+  delete cullPipeline;
+  delete diffuseSpectatorPipeline;
+  delete gridSpectatorPipeline;
+  delete visibilityMaskPipeline;
   delete diffusePipeline;
   delete gridPipeline;
 
@@ -218,6 +390,11 @@ Renderer::~Renderer()
       vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     }
 
+    if (uniformDescriptorSetLayout)
+    {
+      vkDestroyDescriptorSetLayout(device, uniformDescriptorSetLayout, nullptr);
+    }
+
     if (descriptorSetLayout)
     {
       vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
@@ -229,10 +406,7 @@ Renderer::~Renderer()
     }
   }
 
-  for (const RenderProcess* renderProcess : renderProcesses)
-  {
-    delete renderProcess;
-  }
+  destroyRenderProcesses();
 
   if (device && commandPool)
   {
@@ -240,83 +414,403 @@ Renderer::~Renderer()
   }
 }
 
-void Renderer::render(const glm::mat4& cameraMatrix, size_t swapchainImageIndex, float time)
+void Renderer::render(const glm::mat4& cameraMatrix,
+                      size_t swapchainImageIndex,
+                      float time,
+                      const glm::mat4* gazePose)
 {
   currentRenderProcessIndex = (currentRenderProcessIndex + 1u) % renderProcesses.size();
+  viewProjectionMatrices = projectionMatrices = spectatorViewProjectionMatrix = nullptr;
+  spectatorViewUpdated = false;
 
   RenderProcess* renderProcess = renderProcesses.at(currentRenderProcessIndex);
 
   const VkDevice device = context->getVkDevice();
-  const VkFence busyFence = renderProcess->getBusyFence();
 
-  // Wait until the render process is free to use again
-  if (vkWaitForFences(device, 1u, &busyFence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+  // Wait until the frame that last used the render process has completed
+  const std::chrono::high_resolution_clock::time_point waitStartTime = std::chrono::high_resolution_clock::now();
+  if (!frameTimeline->waitForFrame(renderProcess->frame))
+  {
+    return;
+  }
+
+  const std::chrono::high_resolution_clock::time_point waitEndTime = std::chrono::high_resolution_clock::now();
+  const long long waitNanoseconds =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(waitEndTime - waitStartTime).count();
+  waitDuration = static_cast<float>(waitNanoseconds) / 1e9f;
+
+  // Read back how long the GPU took when this render process was last used
+  gpuDuration = 0.0f;
+  const float timestampPeriod = context->getTimestampPeriod();
+  if (renderProcess->frame > 0u && timestampPeriod > 0.0f)
+  {
+    std::array<uint64_t, RenderProcess::timestampCount> timestamps;
+    if (vkGetQueryPoolResults(device, renderProcess->getTimestampQueryPool(), 0u,
+                              static_cast<uint32_t>(timestamps.size()), sizeof(timestamps), timestamps.data(),
+                              sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+    {
+      // Leave out the time between the end of the culling pass and the end of the wait for the drawable semaphore, the
+      // timestamps wrap around after their valid bits. If the wait ended before the culling pass, the difference wraps
+      // and is longer than the whole frame, then nothing was waited for
+      const uint64_t timestampMask = context->getTimestampMask();
+      const uint64_t frameTicks = (timestamps.at(3u) - timestamps.at(0u)) & timestampMask;
+      const uint64_t waitTicks = (timestamps.at(2u) - timestamps.at(1u)) & timestampMask;
+      const uint64_t busyTicks = (waitTicks <= frameTicks) ? frameTicks - waitTicks : frameTicks;
+      gpuDuration = static_cast<float>(busyTicks) * timestampPeriod / 1e9f;
+    }
+  }
+
+  // Read back how many draws survived culling when this render process was last used
+  visibleDrawCount = 0u;
+  for (size_t drawGroupIndex = 0u; drawGroupIndex < drawGroups.size(); ++drawGroupIndex)
+  {
+    visibleDrawCount += static_cast<size_t>(renderProcess->getDrawCount(headsetDrawListIndex, drawGroupIndex));
+  }
+
+  // Rebuild the visibility mask if it has changed since the render process was last used, its frame has completed
+  if (renderProcess->visibilityMaskGeneration != headset->getVisibilityMaskGeneration() &&
+      !updateVisibilityMask(renderProcess))
   {
     return;
   }
 
-  if (vkResetFences(device, 1u, &busyFence) != VK_SUCCESS)
+  // Write the per-frame constants into fresh blocks, all blocks of the last use of this render process are free again
+  UniformAllocator* uniformAllocator = renderProcess->getUniformAllocator();
+  uniformAllocator->reset();
+
+  // Allocate the world matrices and draw inputs of all models as a persistent block when the render process is first
+  // used, which has to happen before any per-frame block is allocated. Once models have been added that do not fit, the
+  // block is freed and one with twice the room is allocated, the allocator chains on a page if it does not fit either.
+  // A generation of zero marks a world matrix as never written into the block
+  if (!renderProcess->modelAllocation.data || renderProcess->modelCapacity < models.size())
+  {
+    const size_t modelCapacity = std::max<size_t>({ models.size(), renderProcess->modelCapacity * 2u, 1u });
+    uniformAllocator->clear();
+    renderProcess->modelAllocation = uniformAllocator->allocatePersistent(
+      (sizeof(glm::mat4) + sizeof(DrawInputData)) * static_cast<VkDeviceSize>(modelCapacity), sizeof(glm::mat4));
+    if (!renderProcess->modelAllocation.data)
+    {
+      renderProcess->modelCapacity = 0u;
+      return;
+    }
+
+    renderProcess->modelCapacity = modelCapacity;
+    renderProcess->worldMatrixGenerations.clear();
+    renderProcess->drawInputCount = 0u;
+  }
+
+  renderProcess->worldMatrixGenerations.resize(models.size(), 0u);
+
+  // Make room for the draw commands of all models, this only replaces the indirect buffers once models have been added,
+  // which also changes the draw count in the uniform offsets so that recordings with the old buffers are not replayed
+  if (!renderProcess->reserveDraws(drawCount))
   {
     return;
   }
 
-  const VkCommandBuffer commandBuffer = renderProcess->getCommandBuffer();
-  if (vkResetCommandBuffer(commandBuffer, 0u) != VK_SUCCESS)
+  const size_t eyeCount = headset->getEyeCount();
+  const UniformAllocator::Allocation viewProjectionAllocation =
+    uniformAllocator->allocate(sizeof(glm::mat4) * static_cast<VkDeviceSize>(eyeCount * 2u), sizeof(glm::mat4));
+  const UniformAllocator::Allocation timeAllocation = uniformAllocator->allocate(sizeof(float), sizeof(float));
+  if (!viewProjectionAllocation.data || !timeAllocation.data)
   {
     return;
   }
 
+  // The spectator view only needs a view projection matrix on frames that update it
+  UniformAllocator::Allocation spectatorViewProjectionAllocation;
+  if (spectatorView && spectatorView->beginUpdate())
+  {
+    spectatorViewProjectionAllocation = uniformAllocator->allocate(sizeof(glm::mat4), sizeof(glm::mat4));
+    if (!spectatorViewProjectionAllocation.data)
+    {
+      return;
+    }
+
+    spectatorViewUpdated = true;
+  }
+
+  uniformBytesWritten = 0u;
+  writeWorldMatrices(renderProcess);
+  writeDrawInputs(renderProcess);
+
+  // The view projection matrices and the time change every frame, the view projection matrices stay mapped until the
+  // frame is submitted so that they can be late latched, the projection matrices for the visibility mask follow them
+  viewProjectionMatrices = static_cast<glm::mat4*>(viewProjectionAllocation.data);
+  projectionMatrices = viewProjectionMatrices + eyeCount;
+  spectatorViewProjectionMatrix = static_cast<glm::mat4*>(spectatorViewProjectionAllocation.data);
+  writeViewProjectionMatrices(cameraMatrix);
+
+  *static_cast<float*>(timeAllocation.data) = time;
+  uniformBytesWritten += sizeof(float);
+
+  const UniformAllocator::Allocation& worldAllocation = renderProcess->modelAllocation;
+
+  UniformOffsets uniformOffsets;
+  uniformOffsets.worldMatrices = static_cast<uint32_t>(worldAllocation.offset / sizeof(glm::mat4));
+  uniformOffsets.viewProjectionMatrices = static_cast<uint32_t>(viewProjectionAllocation.offset / sizeof(glm::mat4));
+  uniformOffsets.time = static_cast<uint32_t>(timeAllocation.offset / sizeof(float));
+  uniformOffsets.viewCount = static_cast<uint32_t>(eyeCount);
+  uniformOffsets.drawInputs = static_cast<uint32_t>(
+    (worldAllocation.offset + sizeof(glm::mat4) * static_cast<VkDeviceSize>(renderProcess->modelCapacity)) /
+    sizeof(DrawInputData));
+  uniformOffsets.drawCount = static_cast<uint32_t>(drawCount);
+
+  // The spectator view shares the world matrices and the time with the headset
+  UniformOffsets spectatorUniformOffsets = uniformOffsets;
+  spectatorUniformOffsets.viewProjectionMatrices =
+    static_cast<uint32_t>(spectatorViewProjectionAllocation.offset / sizeof(glm::mat4));
+  spectatorUniformOffsets.viewCount = 1u;
+
+  // Reset the whole command pool of the render process, which only holds the primary command buffer
+  if (vkResetCommandPool(device, renderProcess->getCommandPool(), 0u) != VK_SUCCESS)
+  {
+    return;
+  }
+
+  const VkCommandBuffer commandBuffer = renderProcess->getCommandBuffer();
+
   VkCommandBufferBeginInfo commandBufferBeginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
   if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
   {
     return;
   }
 
-  // Update the uniform buffer data
+  // Timestamps can only be written if the draw queue supports them
+  const bool writeTimestamps = (context->getTimestampPeriod() > 0.0f);
+  const VkQueryPool timestampQueryPool = renderProcess->getTimestampQueryPool();
+  if (writeTimestamps)
+  {
+    vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 0u, RenderProcess::timestampCount);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0u);
+  }
+
+  const std::array descriptorSets = { worldAllocation.descriptorSet, viewProjectionAllocation.descriptorSet,
+                                      timeAllocation.descriptorSet,
+                                      renderProcess->getDescriptorSet(headsetDrawListIndex) };
+  std::array<VkDescriptorSet, 4u> spectatorDescriptorSets = {};
+  if (spectatorViewUpdated)
+  {
+    spectatorDescriptorSets = { worldAllocation.descriptorSet, spectatorViewProjectionAllocation.descriptorSet,
+                                timeAllocation.descriptorSet, renderProcess->getDescriptorSet(spectatorDrawListIndex) };
+  }
+
+  // Cull the models against all views on the GPU, which writes a compacted list of draw commands and a draw count for
+  // each draw group, and against the spectator view into its own draw list if it is updated this frame
   {
-    for (size_t modelIndex = 0u; modelIndex < models.size(); ++modelIndex)
+    // Reset the draw counts
+    vkCmdFillBuffer(commandBuffer, renderProcess->getDrawCountBuffer(headsetDrawListIndex), 0u, VK_WHOLE_SIZE, 0u);
+    if (spectatorViewUpdated)
     {
-      renderProcess->dynamicVertexUniformData.at(modelIndex).worldMatrix = models.at(modelIndex)->worldMatrix;
+      vkCmdFillBuffer(commandBuffer, renderProcess->getDrawCountBuffer(spectatorDrawListIndex), 0u, VK_WHOLE_SIZE,
+                      0u);
     }
 
-    for (size_t eyeIndex = 0u; eyeIndex < headset->getEyeCount(); ++eyeIndex)
+    // Ensure that the draw counts are reset before the culling shader increments them
+    VkMemoryBarrier memoryBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0u, 1u,
+                         &memoryBarrier, 0u, nullptr, 0u, nullptr);
+
+    cullPipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0u,
+                            static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0u, nullptr);
+
+    vkCmdPushConstants(commandBuffer, pipelineLayout, uniformOffsetsStageFlags, 0u, sizeof(UniformOffsets),
+                       &uniformOffsets);
+    const uint32_t workgroupCount = (static_cast<uint32_t>(drawCount) + cullWorkgroupSize - 1u) / cullWorkgroupSize;
+    vkCmdDispatch(commandBuffer, workgroupCount, 1u, 1u);
+
+    if (spectatorViewUpdated)
     {
-      renderProcess->staticVertexUniformData.viewProjectionMatrices.at(eyeIndex) =
-        headset->getEyeProjectionMatrix(eyeIndex) * headset->getEyeViewMatrix(eyeIndex) * cameraMatrix;
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0u,
+                              static_cast<uint32_t>(spectatorDescriptorSets.size()), spectatorDescriptorSets.data(),
+                              0u, nullptr);
+      vkCmdPushConstants(commandBuffer, pipelineLayout, uniformOffsetsStageFlags, 0u, sizeof(UniformOffsets),
+                         &spectatorUniformOffsets);
+      vkCmdDispatch(commandBuffer, workgroupCount, 1u, 1u);
     }
 
-    renderProcess->staticFragmentUniformData.time = time;
+    // Ensure that the culling shader has written all draw commands and counts before they are read by the indirect
+    // draws, and make the draw counts available to be read back on the CPU
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0u, 1u, &memoryBarrier, 0u,
+                         nullptr, 0u, nullptr);
+  }
+
+  // Move the foveal regions of the density map to where the user is looking
+  if (headset->isFoveated() && !updateDensityMap(renderProcess, gazePose))
+  {
+    return;
+  }
 
-    renderProcess->updateUniformBufferData();
+  const VkRenderPass renderPass = headset->getVkRenderPass();
+  const VkFramebuffer framebuffer = headset->getRenderTarget(swapchainImageIndex)->getFramebuffer();
+
+  VkRect2D renderArea;
+  renderArea.offset = { 0, 0 };
+  renderArea.extent = headset->getScaledRenderResolution();
+
+  // Record the draw groups into the secondary command buffers of the workers again if the ones recorded for this render
+  // target are outdated, otherwise they are replayed as they are
+  const std::array<VkDescriptorSet, 3u> graphicsDescriptorSets = { descriptorSets.at(0u), descriptorSets.at(1u),
+                                                                     descriptorSets.at(2u) };
+  CachedRecording& cachedRecording = cachedRecordings.at(currentRenderProcessIndex).at(swapchainImageIndex);
+  if (cachedRecording.descriptorSets != graphicsDescriptorSets || cachedRecording.uniformOffsets != uniformOffsets ||
+      cachedRecording.visibilityMaskGeneration != renderProcess->visibilityMaskGeneration ||
+      cachedRecording.renderExtent.width != renderArea.extent.width ||
+      cachedRecording.renderExtent.height != renderArea.extent.height)
+  {
+    // Each worker records every draw group whose index modulo the worker count matches its own index
+    VkCommandBufferInheritanceInfo commandBufferInheritanceInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+    commandBufferInheritanceInfo.renderPass = renderPass;
+    commandBufferInheritanceInfo.subpass = 0u;
+    commandBufferInheritanceInfo.framebuffer = framebuffer;
+
+    std::atomic<bool> recordingFailed = false;
+    workerPool->run(
+      [&](size_t workerIndex)
+      {
+        const VkCommandBuffer workerCommandBuffer =
+          renderProcess->getWorkerCommandBuffer(swapchainImageIndex, workerIndex);
+        if (vkResetCommandPool(device, renderProcess->getWorkerCommandPool(swapchainImageIndex, workerIndex), 0u) !=
+            VK_SUCCESS)
+        {
+          recordingFailed = true;
+          return;
+        }
+
+        VkCommandBufferBeginInfo workerCommandBufferBeginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+        workerCommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        workerCommandBufferBeginInfo.pInheritanceInfo = &commandBufferInheritanceInfo;
+        if (vkBeginCommandBuffer(workerCommandBuffer, &workerCommandBufferBeginInfo) != VK_SUCCESS)
+        {
+          recordingFailed = true;
+          return;
+        }
+
+        // The first worker draws the visibility mask before its draw groups, its secondary command buffer is executed
+        // before those of all other workers
+        const bool drawVisibilityMask = (workerIndex == 0u && renderProcess->visibilityMaskIndexCount > 0u);
+        recordDrawGroups(workerCommandBuffer, workerIndex, workerPool->getWorkerCount(), headsetDrawListIndex,
+                         renderProcess, renderArea, graphicsDescriptorSets.data(), uniformOffsets, drawVisibilityMask);
+
+        if (vkEndCommandBuffer(workerCommandBuffer) != VK_SUCCESS)
+        {
+          recordingFailed = true;
+          return;
+        }
+      });
+
+    if (recordingFailed)
+    {
+      cachedRecording = CachedRecording();
+      return;
+    }
+
+    cachedRecording.descriptorSets = graphicsDescriptorSets;
+    cachedRecording.uniformOffsets = uniformOffsets;
+    cachedRecording.visibilityMaskGeneration = renderProcess->visibilityMaskGeneration;
+    cachedRecording.renderExtent = renderArea.extent;
   }
 
   const std::array clearValues = { VkClearValue({ 0.01f, 0.01f, 0.01f, 1.0f }), VkClearValue({ 1.0f, 0u }) };
 
   VkRenderPassBeginInfo renderPassBeginInfo{ VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
-  renderPassBeginInfo.renderPass = headset->getVkRenderPass();
-  renderPassBeginInfo.framebuffer = headset->getRenderTarget(swapchainImageIndex)->getFramebuffer();
-  renderPassBeginInfo.renderArea.offset = { 0, 0 };
-  renderPassBeginInfo.renderArea.extent = headset->getEyeResolution(0u);
+  renderPassBeginInfo.renderPass = renderPass;
+  renderPassBeginInfo.framebuffer = framebuffer;
+  renderPassBeginInfo.renderArea = renderArea;
   renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassBeginInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+  // The drawable semaphore is only waited on before the color attachment output stage, so the frame starts before the
+  // wait is over. Mark the end of the culling pass and the end of the wait, so that the wait can be left out of the GPU
+  // frame time
+  if (writeTimestamps)
+  {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 1u);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, timestampQueryPool, 2u);
+  }
+
+  vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+  const std::vector<VkCommandBuffer>& workerCommandBuffers =
+    renderProcess->getWorkerCommandBuffers(swapchainImageIndex);
+  vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(workerCommandBuffers.size()), workerCommandBuffers.data());
+
+  vkCmdEndRenderPass(commandBuffer);
+
+  // Composite the low resolution eyes and their insets into the swapchain image
+  if (headset->isMultiResolution())
+  {
+    headset->recordMultiResolutionComposite(commandBuffer, swapchainImageIndex);
+  }
+
+  // Draw the spectator view in its own render pass, it is recorded inline as it is only drawn on some frames
+  if (spectatorViewUpdated)
+  {
+    VkRect2D spectatorRenderArea;
+    spectatorRenderArea.offset = { 0, 0 };
+    spectatorRenderArea.extent = spectatorView->getResolution();
+
+    renderPassBeginInfo.renderPass = spectatorView->getVkRenderPass();
+    renderPassBeginInfo.framebuffer = spectatorView->getRenderTarget()->getFramebuffer();
+    renderPassBeginInfo.renderArea = spectatorRenderArea;
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    recordDrawGroups(commandBuffer, 0u, 1u, spectatorDrawListIndex, renderProcess, spectatorRenderArea,
+                     spectatorDescriptorSets.data(), spectatorUniformOffsets, false);
+    vkCmdEndRenderPass(commandBuffer);
+  }
+}
 
+void Renderer::recordDrawGroups(VkCommandBuffer commandBuffer,
+                                size_t firstDrawGroupIndex,
+                                size_t drawGroupStride,
+                                size_t drawListIndex,
+                                const RenderProcess* renderProcess,
+                                const VkRect2D& renderArea,
+                                const VkDescriptorSet* descriptorSets,
+                                const UniformOffsets& uniformOffsets,
+                                bool drawVisibilityMask) const
+{
   // Set the viewport
   VkViewport viewport;
-  viewport.x = static_cast<float>(renderPassBeginInfo.renderArea.offset.x);
-  viewport.y = static_cast<float>(renderPassBeginInfo.renderArea.offset.y);
-  viewport.width = static_cast<float>(renderPassBeginInfo.renderArea.extent.width);
-  viewport.height = static_cast<float>(renderPassBeginInfo.renderArea.extent.height);
+  viewport.x = static_cast<float>(renderArea.offset.x);
+  viewport.y = static_cast<float>(renderArea.offset.y);
+  viewport.width = static_cast<float>(renderArea.extent.width);
+  viewport.height = static_cast<float>(renderArea.extent.height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
   vkCmdSetViewport(commandBuffer, 0u, 1u, &viewport);
 
   // Set the scissor
-  VkRect2D scissor;
-  scissor.offset = renderPassBeginInfo.renderArea.offset;
-  scissor.extent = renderPassBeginInfo.renderArea.extent;
-  vkCmdSetScissor(commandBuffer, 0u, 1u, &scissor);
+  vkCmdSetScissor(commandBuffer, 0u, 1u, &renderArea);
+
+  // Bind the per-frame constants once for all draws, the culling buffers are not needed for drawing
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0u, 3u, descriptorSets, 0u,
+                          nullptr);
+
+  // Fill the hidden area of each eye with the nearest depth, the projection matrices follow the view projection ones
+  if (drawVisibilityMask)
+  {
+    UniformOffsets visibilityMaskUniformOffsets = uniformOffsets;
+    visibilityMaskUniformOffsets.viewProjectionMatrices += uniformOffsets.viewCount;
+    vkCmdPushConstants(commandBuffer, pipelineLayout, uniformOffsetsStageFlags, 0u, sizeof(UniformOffsets),
+                       &visibilityMaskUniformOffsets);
+
+    const VkBuffer visibilityMaskBuffer = renderProcess->visibilityMaskBuffer->getBuffer();
+    const VkDeviceSize visibilityMaskVertexOffset = 0u;
+    vkCmdBindVertexBuffers(commandBuffer, 0u, 1u, &visibilityMaskBuffer, &visibilityMaskVertexOffset);
+    vkCmdBindIndexBuffer(commandBuffer, visibilityMaskBuffer, renderProcess->visibilityMaskIndexOffset,
+                         VK_INDEX_TYPE_UINT32);
+
+    visibilityMaskPipeline->bind(commandBuffer);
+    vkCmdDrawIndexed(commandBuffer, renderProcess->visibilityMaskIndexCount, 1u, 0u, 0, 0u);
+  }
 
   // Bind the vertex section of the geometry buffer
   VkDeviceSize vertexOffset = 0u;
@@ -326,42 +820,44 @@ void Renderer::render(const glm::mat4& cameraMatrix, size_t swapchainImageIndex,
   // Bind the index section of the geometry buffer
   vkCmdBindIndexBuffer(commandBuffer, buffer, indexOffset, VK_INDEX_TYPE_UINT32);
 
-  // Draw each model
-  const VkDescriptorSet descriptorSet = renderProcess->getDescriptorSet();
-  for (size_t modelIndex = 0u; modelIndex < models.size(); ++modelIndex)
-  {
-    const Model* model = models.at(modelIndex);
-
-    // Bind the uniform buffer
-    const uint32_t uniformBufferOffset =
-      static_cast<uint32_t>(util::align(static_cast<VkDeviceSize>(sizeof(RenderProcess::DynamicVertexUniformData)),
-                                        context->getUniformBufferOffsetAlignment()) *
-                            static_cast<VkDeviceSize>(modelIndex));
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0u, 1u, &descriptorSet, 1u,
-                            &uniformBufferOffset);
+  // Push the offsets of the per-frame constants
+  vkCmdPushConstants(commandBuffer, pipelineLayout, uniformOffsetsStageFlags, 0u, sizeof(UniformOffsets),
+                     &uniformOffsets);
 
-    // Bind the pipeline
-    if (modelIndex == 0u)
-    {
-      gridPipeline->bind(commandBuffer);
-    }
-    else if (modelIndex == 1u)
+  // Draw the visible models of each group with a single indirect draw
+  const VkBuffer indirectBuffer = renderProcess->getIndirectBuffer(drawListIndex);
+  const VkBuffer drawCountBuffer = renderProcess->getDrawCountBuffer(drawListIndex);
+  for (size_t drawGroupIndex = firstDrawGroupIndex; drawGroupIndex < drawGroups.size();
+       drawGroupIndex += drawGroupStride)
+  {
+    const DrawGroup& drawGroup = drawGroups.at(drawGroupIndex);
+    if (drawGroup.modelIndices.empty())
     {
-      diffusePipeline->bind(commandBuffer);
+      continue;
     }
 
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(model->indexCount), 1u,
-                     static_cast<uint32_t>(model->firstIndex), 0u, 0u);
-  }
+    const VkDeviceSize indirectOffset =
+      sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(drawGroup.firstDraw);
+    const VkDeviceSize drawCountOffset = sizeof(uint32_t) * static_cast<VkDeviceSize>(drawGroupIndex);
+    const uint32_t maxDrawCount = static_cast<uint32_t>(drawGroup.modelIndices.size());
 
-  vkCmdEndRenderPass(commandBuffer);
+    drawGroup.pipelines.at(drawListIndex)->bind(commandBuffer);
+    vkCmdDrawIndexedIndirectCount(commandBuffer, indirectBuffer, indirectOffset, drawCountBuffer, drawCountOffset,
+                                  maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+  }
 }
 
-void Renderer::submit(bool useSemaphores) const
+void Renderer::submit(bool useSemaphores)
 {
-  const RenderProcess* renderProcess = renderProcesses.at(currentRenderProcessIndex);
+  RenderProcess* renderProcess = renderProcesses.at(currentRenderProcessIndex);
   const VkCommandBuffer commandBuffer = renderProcess->getCommandBuffer();
 
+  if (context->getTimestampPeriod() > 0.0f)
+  {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, renderProcess->getTimestampQueryPool(),
+                        3u);
+  }
+
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
   {
     return;
@@ -369,26 +865,112 @@ void Renderer::submit(bool useSemaphores) const
 
   constexpr VkPipelineStageFlags waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
   const VkSemaphore drawableSemaphore = renderProcess->getDrawableSemaphore();
-  const VkSemaphore presentableSemaphore = renderProcess->getPresentableSemaphore();
+
+  // Always signal the frame timeline, the presentable semaphore is binary as presentation does not support timeline
+  // semaphores, the value for it is ignored
+  const uint64_t frame = frameTimeline->nextFrame();
+  const std::array signalSemaphores = { frameTimeline->getSemaphore(), renderProcess->getPresentableSemaphore() };
+  const std::array signalValues = { frame, uint64_t(0u) };
+
+  VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{ VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+  timelineSemaphoreSubmitInfo.pSignalSemaphoreValues = signalValues.data();
 
   VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+  submitInfo.pNext = &timelineSemaphoreSubmitInfo;
   submitInfo.pWaitDstStageMask = &waitStages;
   submitInfo.commandBufferCount = 1u;
   submitInfo.pCommandBuffers = &commandBuffer;
+  submitInfo.signalSemaphoreCount = 1u;
+  submitInfo.pSignalSemaphores = signalSemaphores.data();
 
   if (useSemaphores)
   {
     submitInfo.waitSemaphoreCount = 1u;
     submitInfo.pWaitSemaphores = &drawableSemaphore;
-    submitInfo.signalSemaphoreCount = 1u;
-    submitInfo.pSignalSemaphores = &presentableSemaphore;
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
   }
 
-  const VkFence busyFence = renderProcess->getBusyFence();
-  if (vkQueueSubmit(context->getVkDrawQueue(), 1u, &submitInfo, busyFence) != VK_SUCCESS)
+  timelineSemaphoreSubmitInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+
+  if (vkQueueSubmit(context->getVkDrawQueue(), 1u, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
   {
     return;
   }
+
+  renderProcess->frame = frame;
+  viewProjectionMatrices = projectionMatrices = spectatorViewProjectionMatrix = nullptr;
+}
+
+void Renderer::lateLatch(const glm::mat4& cameraMatrix)
+{
+  // The GPU does not read the per-frame constants before the frame is submitted, so they can still be overwritten
+  if (!viewProjectionMatrices)
+  {
+    return; // No frame has been recorded since the last submission
+  }
+
+  writeWorldMatrices(renderProcesses.at(currentRenderProcessIndex));
+  writeViewProjectionMatrices(cameraMatrix);
+}
+
+void Renderer::addModel(Model* model)
+{
+  const size_t modelIndex = models.size();
+  models.push_back(model);
+
+  // Start tracking the world matrix, the render processes have not written it yet
+  worldMatrices.push_back(model->worldMatrix);
+  worldMatrixGenerations.push_back(1u);
+
+  // Group the model by pipeline, the draws of each group are laid out contiguously so the draws of all later groups
+  // move back by one
+  size_t drawGroupIndex = 0u;
+  switch (model->technique)
+  {
+  case Model::Technique::Grid:
+    drawGroupIndex = 0u;
+    break;
+  case Model::Technique::Diffuse:
+    drawGroupIndex = 1u;
+    break;
+  }
+
+  drawGroups.at(drawGroupIndex).modelIndices.push_back(modelIndex);
+  for (size_t laterDrawGroupIndex = drawGroupIndex + 1u; laterDrawGroupIndex < drawGroups.size(); ++laterDrawGroupIndex)
+  {
+    ++drawGroups.at(laterDrawGroupIndex).firstDraw;
+  }
+
+  ++drawCount;
+}
+
+bool Renderer::setFramesInFlightCount(size_t framesInFlightCount)
+{
+  framesInFlightCount = std::clamp(framesInFlightCount, minFramesInFlightCount, maxFramesInFlightCount);
+  if (framesInFlightCount == renderProcesses.size())
+  {
+    return true;
+  }
+
+  // Sync so that no render process is still in use by the GPU or the presentation engine when it is destroyed
+  context->sync();
+
+  destroyRenderProcesses();
+
+  if (vkResetDescriptorPool(context->getVkDevice(), descriptorPool, 0u) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return false;
+  }
+
+  if (!createRenderProcesses(framesInFlightCount))
+  {
+    valid = false;
+    return false;
+  }
+
+  return true;
 }
 
 bool Renderer::isValid() const
@@ -396,6 +978,11 @@ bool Renderer::isValid() const
   return valid;
 }
 
+const FrameTimeline* Renderer::getFrameTimeline() const
+{
+  return frameTimeline;
+}
+
 VkCommandBuffer Renderer::getCurrentCommandBuffer() const
 {
   return renderProcesses.at(currentRenderProcessIndex)->getCommandBuffer();
@@ -409,4 +996,343 @@ VkSemaphore Renderer::getCurrentDrawableSemaphore() const
 VkSemaphore Renderer::getCurrentPresentableSemaphore() const
 {
   return renderProcesses.at(currentRenderProcessIndex)->getPresentableSemaphore();
+}
+
+size_t Renderer::getVisibleDrawCount() const
+{
+  return visibleDrawCount;
+}
+
+size_t Renderer::getUniformBytesWritten() const
+{
+  return uniformBytesWritten;
+}
+
+float Renderer::getWaitDuration() const
+{
+  return waitDuration;
+}
+
+float Renderer::getGpuDuration() const
+{
+  return gpuDuration;
+}
+
+bool Renderer::isSpectatorViewUpdated() const
+{
+  return spectatorViewUpdated;
+}
+
+bool Renderer::createRenderProcesses(size_t framesInFlightCount)
+{
+  renderProcesses.resize(framesInFlightCount, nullptr);
+  for (RenderProcess*& renderProcess : renderProcesses)
+  {
+    renderProcess =
+      new RenderProcess(context, descriptorPool, descriptorSetLayout, uniformDescriptorSetLayout, uniformPageSize,
+                        drawCount, drawGroups.size(), drawListCount, workerPool->getWorkerCount(),
+                        headset->getRenderTargetCount());
+    if (!renderProcess->isValid())
+    {
+      return false;
+    }
+  }
+
+  // Nothing has been recorded yet, start over with the first render process
+  cachedRecordings.assign(renderProcesses.size(), std::vector<CachedRecording>(headset->getRenderTargetCount()));
+  currentRenderProcessIndex = 0u;
+
+  return true;
+}
+
+void Renderer::destroyRenderProcesses()
+{
+  for (const RenderProcess* renderProcess : renderProcesses)
+  {
+    delete renderProcess;
+  }
+
+  renderProcesses.clear();
+  cachedRecordings.clear();
+}
+
+bool Renderer::updateVisibilityMask(RenderProcess* renderProcess)
+{
+  // Take the generation first, so that a change while the mask is read triggers another update
+  const size_t visibilityMaskGeneration = headset->getVisibilityMaskGeneration();
+
+  // Gather the masks of all eyes into a single mesh, each vertex knows the eye it belongs to
+  std::vector<VisibilityMaskVertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<glm::vec2> eyeVertices;
+  std::vector<uint32_t> eyeIndices;
+  for (size_t eyeIndex = 0u; eyeIndex < headset->getEyeCount(); ++eyeIndex)
+  {
+    if (!headset->getVisibilityMask(eyeIndex, eyeVertices, eyeIndices))
+    {
+      return false;
+    }
+
+    const uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+    for (const glm::vec2& eyeVertex : eyeVertices)
+    {
+      vertices.push_back({ eyeVertex, static_cast<uint32_t>(eyeIndex) });
+    }
+
+    for (const uint32_t index : eyeIndices)
+    {
+      indices.push_back(baseVertex + index);
+    }
+  }
+
+  delete renderProcess->visibilityMaskBuffer;
+  renderProcess->visibilityMaskBuffer = nullptr;
+  renderProcess->visibilityMaskIndexCount = 0u;
+  renderProcess->visibilityMaskGeneration = visibilityMaskGeneration;
+
+  if (indices.empty())
+  {
+    return true; // There is nothing to hide
+  }
+
+  // The mask is small and rarely changes, so it stays in host-visible memory
+  const VkDeviceSize verticesSize = sizeof(VisibilityMaskVertex) * static_cast<VkDeviceSize>(vertices.size());
+  const VkDeviceSize indicesSize = sizeof(uint32_t) * static_cast<VkDeviceSize>(indices.size());
+  DataBuffer* visibilityMaskBuffer = new DataBuffer(
+    context, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, verticesSize + indicesSize);
+  if (!visibilityMaskBuffer->isValid())
+  {
+    delete visibilityMaskBuffer;
+    return false;
+  }
+
+  char* bufferData = static_cast<char*>(visibilityMaskBuffer->map());
+  if (!bufferData)
+  {
+    delete visibilityMaskBuffer;
+    return false;
+  }
+
+  memcpy(bufferData, vertices.data(), static_cast<size_t>(verticesSize));
+  memcpy(bufferData + verticesSize, indices.data(), static_cast<size_t>(indicesSize));
+  visibilityMaskBuffer->unmap();
+
+  renderProcess->visibilityMaskBuffer = visibilityMaskBuffer;
+  renderProcess->visibilityMaskIndexOffset = verticesSize;
+  renderProcess->visibilityMaskIndexCount = static_cast<uint32_t>(indices.size());
+  return true;
+}
+
+bool Renderer::updateDensityMap(RenderProcess* renderProcess, const glm::mat4* gazePose)
+{
+  const size_t eyeCount = headset->getEyeCount();
+  const VkExtent2D renderExtent = headset->getScaledRenderResolution(); // Of the render area
+  const VkExtent2D texelSize = context->getFragmentDensityTexelSize();
+  const VkExtent2D densityMapResolution = headset->getDensityMapResolution();
+
+  // Find the foveal center of each eye, which is where the gaze meets the image or the center of the lens otherwise
+  std::vector<glm::vec2> fovealCenters(eyeCount);
+  std::vector<glm::ivec2> newFovealTexels(eyeCount);
+  for (size_t eyeIndex = 0u; eyeIndex < eyeCount; ++eyeIndex)
+  {
+    const glm::mat4 projectionMatrix = headset->getEyeProjectionMatrix(eyeIndex);
+    glm::vec4 clipPosition = projectionMatrix * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f);
+    if (gazePose)
+    {
+      // Look one meter ahead along the gaze, which points down the negative z axis like all OpenXR poses
+      const glm::vec4 gazePosition = projectionMatrix * headset->getEyeViewMatrix(eyeIndex) * (*gazePose) *
+                                     glm::vec4(0.0f, 0.0f, -1.0f, 1.0f);
+      if (gazePosition.w > 0.0f)
+      {
+        clipPosition = gazePosition;
+      }
+    }
+
+    glm::vec2& fovealCenter = fovealCenters.at(eyeIndex);
+    fovealCenter = glm::clamp(glm::vec2(clipPosition) / clipPosition.w, -1.0f, 1.0f);
+
+    const glm::vec2 pixel = (fovealCenter * 0.5f + 0.5f) * glm::vec2(renderExtent.width, renderExtent.height);
+    newFovealTexels.at(eyeIndex) = glm::ivec2(pixel / glm::vec2(texelSize.width, texelSize.height));
+  }
+
+  // The density map is shared by all render processes, so it only needs to be uploaded when a foveal center has moved
+  // to another texel or the render area has changed
+  if (newFovealTexels == fovealTexels && renderExtent.width == fovealRenderExtent.width &&
+      renderExtent.height == fovealRenderExtent.height)
+  {
+    return true;
+  }
+
+  const size_t layerSize = static_cast<size_t>(densityMapResolution.width) * densityMapResolution.height * 2u;
+  if (!renderProcess->densityMapBuffer)
+  {
+    DataBuffer* densityMapBuffer =
+      new DataBuffer(context, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     static_cast<VkDeviceSize>(layerSize * eyeCount));
+    if (!densityMapBuffer->isValid())
+    {
+      delete densityMapBuffer;
+      return false;
+    }
+
+    renderProcess->densityMapBuffer = densityMapBuffer;
+  }
+
+  uint8_t* densities = static_cast<uint8_t*>(renderProcess->densityMapBuffer->map());
+  if (!densities)
+  {
+    return false;
+  }
+
+  // Write the density of each texel from its distance to the foveal center, the same along both axes
+  for (size_t eyeIndex = 0u; eyeIndex < eyeCount; ++eyeIndex)
+  {
+    const glm::vec2& fovealCenter = fovealCenters.at(eyeIndex);
+    uint8_t* layerDensities = densities + layerSize * eyeIndex;
+    for (uint32_t y = 0u; y < densityMapResolution.height; ++y)
+    {
+      for (uint32_t x = 0u; x < densityMapResolution.width; ++x)
+      {
+        const glm::vec2 pixel = (glm::vec2(x, y) + 0.5f) * glm::vec2(texelSize.width, texelSize.height);
+        const glm::vec2 position = pixel / glm::vec2(renderExtent.width, renderExtent.height) * 2.0f - 1.0f;
+        const float distance = glm::length(position - fovealCenter);
+
+        uint8_t density = peripheralDensity;
+        if (distance < fovealRadius)
+        {
+          density = fovealDensity;
+        }
+        else if (distance < parafovealRadius)
+        {
+          density = parafovealDensity;
+        }
+
+        const size_t texelIndex = static_cast<size_t>(y) * densityMapResolution.width + x;
+        layerDensities[texelIndex * 2u] = layerDensities[texelIndex * 2u + 1u] = density;
+      }
+    }
+  }
+
+  renderProcess->densityMapBuffer->unmap();
+
+  // Copy the densities into the density map once the render passes of earlier frames are done reading it, the old
+  // contents are discarded as every texel is overwritten
+  const VkCommandBuffer commandBuffer = renderProcess->getCommandBuffer();
+  const VkImage densityMapImage = headset->getDensityMapImage();
+
+  VkImageMemoryBarrier imageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+  imageMemoryBarrier.srcAccessMask = VK_ACCESS_NONE;
+  imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageMemoryBarrier.image = densityMapImage;
+  imageMemoryBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0u, 1u, 0u, static_cast<uint32_t>(eyeCount) };
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_DENSITY_PROCESS_BIT_EXT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0u, 0u, nullptr, 0u, nullptr, 1u, &imageMemoryBarrier);
+
+  VkBufferImageCopy bufferImageCopy{};
+  bufferImageCopy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0u, 0u, static_cast<uint32_t>(eyeCount) };
+  bufferImageCopy.imageExtent = { densityMapResolution.width, densityMapResolution.height, 1u };
+  vkCmdCopyBufferToImage(commandBuffer, renderProcess->densityMapBuffer->getBuffer(), densityMapImage,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1u, &bufferImageCopy);
+
+  // Ensure that the copy has finished before the render pass reads the density map
+  imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  imageMemoryBarrier.dstAccessMask = VK_ACCESS_FRAGMENT_DENSITY_MAP_READ_BIT_EXT;
+  imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_FRAGMENT_DENSITY_MAP_OPTIMAL_EXT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_DENSITY_PROCESS_BIT_EXT, 0u, 0u, nullptr, 0u, nullptr, 1u,
+                       &imageMemoryBarrier);
+
+  fovealTexels = newFovealTexels;
+  fovealRenderExtent = renderExtent;
+  return true;
+}
+
+void Renderer::writeWorldMatrices(RenderProcess* renderProcess)
+{
+  // Bump the generation of every world matrix that has changed since it was last seen
+  for (size_t modelIndex = 0u; modelIndex < models.size(); ++modelIndex)
+  {
+    const glm::mat4& worldMatrix = models.at(modelIndex)->worldMatrix;
+    if (worldMatrix != worldMatrices.at(modelIndex))
+    {
+      worldMatrices.at(modelIndex) = worldMatrix;
+      ++worldMatrixGenerations.at(modelIndex);
+    }
+  }
+
+  // Only rewrite the world matrices that have changed since this render process last wrote them
+  glm::mat4* worldMatrixBlock = static_cast<glm::mat4*>(renderProcess->modelAllocation.data);
+  for (size_t modelIndex = 0u; modelIndex < models.size(); ++modelIndex)
+  {
+    size_t& writtenGeneration = renderProcess->worldMatrixGenerations.at(modelIndex);
+    if (writtenGeneration != worldMatrixGenerations.at(modelIndex))
+    {
+      worldMatrixBlock[modelIndex] = worldMatrices.at(modelIndex);
+      writtenGeneration = worldMatrixGenerations.at(modelIndex);
+      uniformBytesWritten += sizeof(glm::mat4);
+    }
+  }
+}
+
+void Renderer::writeDrawInputs(RenderProcess* renderProcess)
+{
+  // Adding a model moves the draws of all later groups, so all draw inputs are rewritten whenever the count changes
+  if (renderProcess->drawInputCount == drawCount)
+  {
+    return;
+  }
+
+  // Describe every draw to the culling shader, the draw inputs follow the world matrices in the block
+  DrawInputData* drawInputBlock = reinterpret_cast<DrawInputData*>(
+    static_cast<glm::mat4*>(renderProcess->modelAllocation.data) + renderProcess->modelCapacity);
+  for (size_t drawGroupIndex = 0u; drawGroupIndex < drawGroups.size(); ++drawGroupIndex)
+  {
+    const DrawGroup& drawGroup = drawGroups.at(drawGroupIndex);
+    for (size_t groupDrawIndex = 0u; groupDrawIndex < drawGroup.modelIndices.size(); ++groupDrawIndex)
+    {
+      const size_t modelIndex = drawGroup.modelIndices.at(groupDrawIndex);
+      const Model* model = models.at(modelIndex);
+
+      DrawInputData& drawInput = drawInputBlock[drawGroup.firstDraw + groupDrawIndex];
+      drawInput = {};
+      drawInput.boundsMin = glm::vec4(model->boundsMin, 1.0f);
+      drawInput.boundsMax = glm::vec4(model->boundsMax, 1.0f);
+      drawInput.indexCount = static_cast<uint32_t>(model->indexCount);
+      drawInput.firstIndex = static_cast<uint32_t>(model->firstIndex);
+      drawInput.modelIndex = static_cast<uint32_t>(modelIndex);
+      drawInput.drawGroupIndex = static_cast<uint32_t>(drawGroupIndex);
+      drawInput.drawGroupFirstDraw = static_cast<uint32_t>(drawGroup.firstDraw);
+    }
+  }
+
+  renderProcess->drawInputCount = drawCount;
+  uniformBytesWritten += sizeof(DrawInputData) * drawCount;
+}
+
+void Renderer::writeViewProjectionMatrices(const glm::mat4& cameraMatrix)
+{
+  const size_t eyeCount = headset->getEyeCount();
+  for (size_t eyeIndex = 0u; eyeIndex < eyeCount; ++eyeIndex)
+  {
+    const glm::mat4 projectionMatrix = headset->getEyeProjectionMatrix(eyeIndex);
+    viewProjectionMatrices[eyeIndex] = projectionMatrix * headset->getEyeViewMatrix(eyeIndex) * cameraMatrix;
+    projectionMatrices[eyeIndex] = projectionMatrix;
+  }
+
+  uniformBytesWritten += sizeof(glm::mat4) * eyeCount * 2u;
+
+  // The spectator view follows the left eye
+  if (spectatorViewProjectionMatrix)
+  {
+    *spectatorViewProjectionMatrix =
+      spectatorView->getViewProjectionMatrix(headset->getEyeViewMatrix(0u)) * cameraMatrix;
+    uniformBytesWritten += sizeof(glm::mat4);
+  }
 }
\ No newline at end of file
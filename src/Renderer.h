@@ -1,53 +1,155 @@
 #pragma once
 
-#include <glm/fwd.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 
 #include <vulkan/vulkan.h>
 
+#include <array>
 #include <vector>
 
+class ComputePipeline;
 class Context;
 class DataBuffer;
+class FrameTimeline;
 class Headset;
 class MeshData;
 struct Model;
 class Pipeline;
 class RenderProcess;
+class SpectatorView;
+class WorkerPool;
 
 /*
- * The renderer class facilitates rendering with Vulkan. It is initialized with a constant list of models to render and
- * holds the vertex/index buffer, the pipelines that define the rendering techniques to use, as well as a number of
- * render processes. Note that all resources that need to be duplicated in order to be able to render several frames in
- * parallel are held by this number of render processes.
+ * The renderer class facilitates rendering with Vulkan. It is initialized with a list of models to render, which more
+ * can be added to at runtime, and holds the vertex/index buffer, the pipelines that define the rendering techniques to
+ * use, as well as a number of render processes. Note that all resources that need to be duplicated in order to be able
+ * to render several frames in parallel are held by this number of render processes, which can be changed at runtime.
  */
 class Renderer final
 {
 public:
-  Renderer(const Context* context, const Headset* headset, const MeshData* meshData, const std::vector<Model*>& models);
+  Renderer(const Context* context,
+           const Headset* headset,
+           SpectatorView* spectatorView, // Optional
+           const MeshData* meshData,
+           const std::vector<Model*>& models,
+           size_t framesInFlightCount);
   ~Renderer();
 
-  void render(const glm::mat4& cameraMatrix, size_t swapchainImageIndex, float time);
-  void submit(bool useSemaphores) const;
+  void render(const glm::mat4& cameraMatrix,
+              size_t swapchainImageIndex,
+              float time,
+              const glm::mat4* gazePose); // Optional, in stage space, the lens centers are foveated without it
+  // Rewrites the view projection and world matrices with the newest poses, call right before submitting as the GPU
+  // only reads them once the frame has been submitted
+  void lateLatch(const glm::mat4& cameraMatrix);
+  void addModel(Model* model); // Call between submitting a frame and rendering the next one
+  void submit(bool useSemaphores);
+  bool setFramesInFlightCount(size_t framesInFlightCount); // Between 1 and 4, syncs and rebuilds the render processes
 
   bool isValid() const;
+  const FrameTimeline* getFrameTimeline() const;
   VkCommandBuffer getCurrentCommandBuffer() const;
   VkSemaphore getCurrentDrawableSemaphore() const;
   VkSemaphore getCurrentPresentableSemaphore() const;
+  size_t getVisibleDrawCount() const; // Of the last completed frame of the current render process
+  size_t getUniformBytesWritten() const; // Of the last recorded frame
+  float getWaitDuration() const; // In seconds, how long the last recorded frame waited for its render process
+  float getGpuDuration() const;  // In seconds, of the last completed frame of the current render process, without waits
+  bool isSpectatorViewUpdated() const; // Whether the last recorded frame updates the spectator view
 
 private:
   bool valid = true;
 
   const Context* context = nullptr;
   const Headset* headset = nullptr;
+  SpectatorView* spectatorView = nullptr; // Culled and drawn in its own pass, only on frames where it is due
 
   VkCommandPool commandPool = nullptr;
   VkDescriptorPool descriptorPool = nullptr;
-  VkDescriptorSetLayout descriptorSetLayout = nullptr;
+  VkDescriptorSetLayout descriptorSetLayout = nullptr, uniformDescriptorSetLayout = nullptr;
   std::vector<RenderProcess*> renderProcesses;
   VkPipelineLayout pipelineLayout = nullptr;
-  Pipeline *gridPipeline = nullptr, *diffusePipeline = nullptr;
+  Pipeline *gridPipeline = nullptr, *diffusePipeline = nullptr, *visibilityMaskPipeline = nullptr;
+  Pipeline *gridSpectatorPipeline = nullptr, *diffuseSpectatorPipeline = nullptr; // Only with a spectator view
+  ComputePipeline* cullPipeline = nullptr;
   DataBuffer* vertexIndexBuffer = nullptr;
   std::vector<Model*> models;
+
+  // The world matrices as last seen and a generation for each that increases whenever a world matrix changes, so that
+  // a render process only rewrites the world matrices that have changed since it was last used
+  std::vector<glm::mat4> worldMatrices;
+  std::vector<size_t> worldMatrixGenerations;
+  size_t uniformBytesWritten = 0u;
+  glm::mat4* viewProjectionMatrices = nullptr; // Of the last recorded frame
+  glm::mat4* projectionMatrices = nullptr; // Follow the view projection matrices, only used for the visibility mask
+  glm::mat4* spectatorViewProjectionMatrix = nullptr; // Of the last recorded frame, if it updates the spectator view
+  float waitDuration = 0.0f, gpuDuration = 0.0f;
+  bool spectatorViewUpdated = false; // By the last recorded frame
+
+  // The models that share their pipelines, drawn with a single indirect draw whose commands are written on the GPU by
+  // the compute pass that culls the models against the frusta of all views
+  struct DrawGroup
+  {
+    std::vector<const Pipeline*> pipelines; // Per draw list, as the spectator view has its own render pass
+    std::vector<size_t> modelIndices;
+    size_t firstDraw = 0u; // Into the draw inputs and the indirect buffer
+  };
+  std::vector<DrawGroup> drawGroups;
+  size_t drawCount = 0u, visibleDrawCount = 0u, drawListCount = 1u;
+
   size_t indexOffset = 0u;
   size_t currentRenderProcessIndex = 0u;
+
+  WorkerPool* workerPool = nullptr;       // Records the draw groups, only in parallel once there are enough of them
+  FrameTimeline* frameTimeline = nullptr; // A render process is reused once its last submitted frame has completed
+
+  // Offsets of the per-frame constants in elements, matches the push constant block in the shaders
+  struct UniformOffsets
+  {
+    uint32_t worldMatrices, viewProjectionMatrices, time;
+    uint32_t viewCount;  // Of the view projection matrices
+    uint32_t drawInputs; // Follow the world matrices
+    uint32_t drawCount;  // Of the draw inputs
+
+    bool operator==(const UniformOffsets& other) const = default;
+  };
+
+  // Describes what the secondary command buffers of a render process and render target were last recorded with, they
+  // can be replayed as long as all of it is still the same
+  struct CachedRecording
+  {
+    std::array<VkDescriptorSet, 3u> descriptorSets = {};
+    UniformOffsets uniformOffsets = {};
+    size_t visibilityMaskGeneration = 0u;
+    VkExtent2D renderExtent = { 0u, 0u }; // Of the render area, which sets the viewport and scissor
+  };
+  std::vector<std::vector<CachedRecording>> cachedRecordings; // Per render process and render target
+
+  // Of each eye in the density map as last uploaded, empty before the first one. If the headset is foveated, the
+  // density map is rewritten around the gaze or the lens centers whenever they move, to shade less in the periphery
+  std::vector<glm::ivec2> fovealTexels;
+  VkExtent2D fovealRenderExtent = { 0u, 0u }; // Of the render area that the density map was last uploaded for
+
+  // Records every draw group starting at the first one with a stride, so that workers can share the draw groups
+  void recordDrawGroups(VkCommandBuffer commandBuffer,
+                        size_t firstDrawGroupIndex,
+                        size_t drawGroupStride,
+                        size_t drawListIndex,
+                        const RenderProcess* renderProcess,
+                        const VkRect2D& renderArea,
+                        const VkDescriptorSet* descriptorSets,
+                        const UniformOffsets& uniformOffsets,
+                        bool drawVisibilityMask) const; // Fills the mask with the nearest depth to cull fragments
+
+  bool updateVisibilityMask(RenderProcess* renderProcess); // Rebuilds the mask of a render process that is not in use
+  bool updateDensityMap(RenderProcess* renderProcess, const glm::mat4* gazePose); // Records an upload if it moved
+
+  void writeWorldMatrices(RenderProcess* renderProcess);
+  void writeDrawInputs(RenderProcess* renderProcess);
+  void writeViewProjectionMatrices(const glm::mat4& cameraMatrix);
+
+  bool createRenderProcesses(size_t framesInFlightCount);
+  void destroyRenderProcesses();
 };
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "SpectatorView.h"
+
+#include "Context.h"
+#include "ImageBuffer.h"
+#include "RenderTarget.h"
+#include "Util.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+
+namespace
+{
+constexpr VkFormat colorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+constexpr VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
+constexpr float verticalFov = 60.0f;   // In degrees
+constexpr float followDistance = 2.0f; // In meters, behind the headset
+constexpr float followHeight = 0.75f;  // In meters, above the headset
+} // namespace
+
+SpectatorView::SpectatorView(const Context* context, VkExtent2D resolution, float refreshRate)
+: context(context), resolution(resolution), updateInterval(refreshRate > 0.0f ? 1.0f / refreshRate : 0.0f)
+{
+  const VkDevice device = context->getVkDevice();
+  const VkSampleCountFlagBits multisampleCount = context->getMultisampleCount();
+
+  // Create a render pass, it matches the one of the headset apart from multiview so that the pipelines are alike
+  {
+    VkAttachmentDescription colorAttachmentDescription{};
+    colorAttachmentDescription.format = colorFormat;
+    colorAttachmentDescription.samples = multisampleCount;
+    colorAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentReference;
+    colorAttachmentReference.attachment = 0u;
+    colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentDescription depthAttachmentDescription{};
+    depthAttachmentDescription.format = depthFormat;
+    depthAttachmentDescription.samples = multisampleCount;
+    depthAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentReference;
+    depthAttachmentReference.attachment = 1u;
+    depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    // The resolved image ends up in the transfer source optimal layout, ready to be copied into the mirror view
+    VkAttachmentDescription resolveAttachmentDescription{};
+    resolveAttachmentDescription.format = colorFormat;
+    resolveAttachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+    resolveAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    resolveAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    resolveAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    resolveAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    resolveAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resolveAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    VkAttachmentReference resolveAttachmentReference;
+    resolveAttachmentReference.attachment = 2u;
+    resolveAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    // This subpass dependency waits with the layout transitions at the start of the render pass until the mirror view
+    // of an earlier frame has finished copying from the resolved image
+    VkSubpassDependency subpassDependencyRenderPassBegin;
+    subpassDependencyRenderPassBegin.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    subpassDependencyRenderPassBegin.srcSubpass = VK_SUBPASS_EXTERNAL;
+    subpassDependencyRenderPassBegin.dstSubpass = 0;
+    subpassDependencyRenderPassBegin.srcAccessMask = VK_ACCESS_NONE;
+    subpassDependencyRenderPassBegin.dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    subpassDependencyRenderPassBegin.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT |
+                                                    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                                    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    subpassDependencyRenderPassBegin.dstStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+
+    // This subpass dependency ensures that all attachment writes have finished before the resolved image is copied
+    VkSubpassDependency subpassDependencyRenderPassEnd;
+    subpassDependencyRenderPassEnd.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    subpassDependencyRenderPassEnd.srcSubpass = 0;
+    subpassDependencyRenderPassEnd.dstSubpass = VK_SUBPASS_EXTERNAL;
+    subpassDependencyRenderPassEnd.srcAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    subpassDependencyRenderPassEnd.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    subpassDependencyRenderPassEnd.srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    subpassDependencyRenderPassEnd.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    VkSubpassDescription subpassDescription{};
+    subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpassDescription.colorAttachmentCount = 1u;
+    subpassDescription.pColorAttachments = &colorAttachmentReference;
+    subpassDescription.pDepthStencilAttachment = &depthAttachmentReference;
+    subpassDescription.pResolveAttachments = &resolveAttachmentReference;
+
+    const std::array attachments = { colorAttachmentDescription, depthAttachmentDescription,
+                                     resolveAttachmentDescription };
+
+    const std::array subpassDependencies = { subpassDependencyRenderPassBegin, subpassDependencyRenderPassEnd };
+
+    VkRenderPassCreateInfo renderPassCreateInfo{ VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+    renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassCreateInfo.pAttachments = attachments.data();
+    renderPassCreateInfo.subpassCount = 1u;
+    renderPassCreateInfo.pSubpasses = &subpassDescription;
+    renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+    renderPassCreateInfo.pDependencies = subpassDependencies.data();
+    if (vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &renderPass) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      valid = false;
+      return;
+    }
+
+#ifdef DEBUG
+    if (context->setDebugObjectName(reinterpret_cast<uint64_t>(renderPass), VK_OBJECT_TYPE_RENDER_PASS,
+                                    "OXR_VK_X Spectator Render Pass") != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      valid = false;
+      return;
+    }
+#endif
+  }
+
+  // Create a color buffer
+  colorBuffer = new ImageBuffer(context, resolution, colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                multisampleCount, VK_IMAGE_ASPECT_COLOR_BIT, 1u);
+  if (!colorBuffer->isValid())
+  {
+    valid = false;
+    return;
+  }
+
+  // Create a depth buffer
+  depthBuffer = new ImageBuffer(context, resolution, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                multisampleCount, VK_IMAGE_ASPECT_DEPTH_BIT, 1u);
+  if (!depthBuffer->isValid())
+  {
+    valid = false;
+    return;
+  }
+
+  // Create a buffer to resolve into, it is the source of the copy into the mirror view
+  resolveBuffer = new ImageBuffer(context, resolution, colorFormat,
+                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                  VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 1u);
+  if (!resolveBuffer->isValid())
+  {
+    valid = false;
+    return;
+  }
+
+  // Create a render target
+  renderTarget = new RenderTarget(device, resolveBuffer->getImage(), colorBuffer->getImageView(),
+                                  depthBuffer->getImageView(), resolution, colorFormat, renderPass, 1u, nullptr,
+                                  nullptr);
+  if (!renderTarget->isValid())
+  {
+    valid = false;
+    return;
+  }
+}
+
+SpectatorView::~SpectatorView()
+{
+  delete renderTarget;
+  delete resolveBuffer;
+  delete depthBuffer;
+  delete colorBuffer;
+
+  const VkDevice device = context->getVkDevice();
+  if (device && renderPass)
+  {
+    vkDestroyRenderPass(device, renderPass, nullptr);
+  }
+}
+
+bool SpectatorView::beginUpdate()
+{
+  const std::chrono::high_resolution_clock::time_point nowTime = std::chrono::high_resolution_clock::now();
+  const long long elapsedNanoseconds =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(nowTime - previousUpdateTime).count();
+  if (static_cast<float>(elapsedNanoseconds) / 1e9f < updateInterval)
+  {
+    return false;
+  }
+
+  previousUpdateTime = nowTime;
+  return true;
+}
+
+bool SpectatorView::isValid() const
+{
+  return valid;
+}
+
+VkRenderPass SpectatorView::getVkRenderPass() const
+{
+  return renderPass;
+}
+
+VkExtent2D SpectatorView::getResolution() const
+{
+  return resolution;
+}
+
+VkImage SpectatorView::getImage() const
+{
+  return resolveBuffer->getImage();
+}
+
+RenderTarget* SpectatorView::getRenderTarget() const
+{
+  return renderTarget;
+}
+
+glm::mat4 SpectatorView::getViewProjectionMatrix(const glm::mat4& headViewMatrix) const
+{
+  // Follow the headset from behind and above, only the heading of the headset is taken into account
+  const glm::mat4 headMatrix = glm::inverse(headViewMatrix);
+  const glm::vec3 headPosition = glm::vec3(headMatrix[3]);
+  glm::vec3 backward = glm::vec3(headMatrix[2].x, 0.0f, headMatrix[2].z);
+  backward = (glm::length(backward) > 0.0f ? glm::normalize(backward) : glm::vec3(0.0f, 0.0f, 1.0f));
+
+  const glm::vec3 up = { 0.0f, 1.0f, 0.0f };
+  const glm::vec3 position = headPosition + backward * followDistance + up * followHeight;
+  const glm::mat4 viewMatrix = glm::lookAt(position, headPosition, up);
+
+  // Build the projection like the one of the eyes from a symmetric field of view
+  const float aspectRatio = static_cast<float>(resolution.width) / static_cast<float>(resolution.height);
+  const float halfVerticalFov = glm::radians(verticalFov) / 2.0f;
+  const float halfHorizontalFov = glm::atan(glm::tan(halfVerticalFov) * aspectRatio);
+
+  XrFovf fov;
+  fov.angleLeft = -halfHorizontalFov;
+  fov.angleRight = halfHorizontalFov;
+  fov.angleUp = halfVerticalFov;
+  fov.angleDown = -halfVerticalFov;
+  return util::createProjectionMatrix(fov, 0.01f, 250.0f) * viewMatrix;
+}
\ No newline at end of file
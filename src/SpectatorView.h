@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+
+class Context;
+class ImageBuffer;
+class RenderTarget;
+
+/*
+ * The spectator view class holds the render target of a third-person view that follows the headset from behind. It
+ * has its own resolution and refresh rate, independent of the headset, so that a 120 Hz headset can be accompanied by a
+ * 30 Hz spectator view for example. The renderer culls and draws the spectator view in a separate pass into this render
+ * target, but only on frames where an update is due. The final image is left in the transfer source optimal layout, so
+ * that it can be copied into the mirror view.
+ */
+class SpectatorView final
+{
+public:
+  SpectatorView(const Context* context, VkExtent2D resolution, float refreshRate);
+  ~SpectatorView();
+
+  bool beginUpdate(); // Returns true at most at the refresh rate, call once per frame to find out whether to update
+
+  bool isValid() const;
+  VkRenderPass getVkRenderPass() const;
+  VkExtent2D getResolution() const;
+  VkImage getImage() const;
+  RenderTarget* getRenderTarget() const;
+  glm::mat4 getViewProjectionMatrix(const glm::mat4& headViewMatrix) const; // In stage space
+
+private:
+  bool valid = true;
+
+  const Context* context = nullptr;
+  VkExtent2D resolution = { 0u, 0u };
+  float updateInterval = 0.0f; // In seconds
+  std::chrono::high_resolution_clock::time_point previousUpdateTime; // Starts at the epoch, so the first update is due
+
+  VkRenderPass renderPass = nullptr;
+  ImageBuffer *colorBuffer = nullptr, *depthBuffer = nullptr, *resolveBuffer = nullptr;
+  RenderTarget* renderTarget = nullptr;
+};
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+/*
+ * The SPSC queue class is a lock-free ring buffer that passes values from a single producing thread to a single
+ * consuming thread. Pushing and popping never block, but either side can wait for the other without spinning.
+ */
+template<typename T, size_t Capacity>
+class SpscQueue final
+{
+public:
+  // Returns false if the queue is full
+  bool push(const T& value)
+  {
+    const size_t tail = tailIndex.load(std::memory_order_relaxed);
+    if (tail - headIndex.load(std::memory_order_acquire) == Capacity)
+    {
+      return false;
+    }
+
+    slots.at(tail % Capacity) = value;
+    tailIndex.store(tail + 1u, std::memory_order_release);
+    tailIndex.notify_one();
+    return true;
+  }
+
+  // Returns false if the queue is empty
+  bool pop(T& value)
+  {
+    const size_t head = headIndex.load(std::memory_order_relaxed);
+    if (head == tailIndex.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+
+    value = slots.at(head % Capacity);
+    headIndex.store(head + 1u, std::memory_order_release);
+    headIndex.notify_one();
+    return true;
+  }
+
+  // Blocks the consumer until there is a value to pop
+  void waitUntilNotEmpty() const
+  {
+    const size_t head = headIndex.load(std::memory_order_relaxed);
+    tailIndex.wait(head, std::memory_order_acquire);
+  }
+
+  // Blocks the producer until there is room to push a value
+  void waitUntilNotFull() const
+  {
+    const size_t tail = tailIndex.load(std::memory_order_relaxed);
+    headIndex.wait(tail - Capacity, std::memory_order_acquire);
+  }
+
+private:
+  std::array<T, Capacity> slots;
+  std::atomic<size_t> headIndex = 0u, tailIndex = 0u; // Only ever increase, the slot index wraps around
+};
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "Submitter.h"
+
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "FrameTimeline.h"
+#include "Headset.h"
+#include "MirrorExport.h"
+#include "MirrorView.h"
+#include "Renderer.h"
+
+Submitter::Submitter(Headset* headset,
+                     Renderer* renderer,
+                     MirrorView* mirrorView,
+                     MirrorExport* mirrorExport,
+                     FrameCapture* frameCapture,
+                     FramePacer* framePacer)
+: headset(headset), renderer(renderer), mirrorView(mirrorView), mirrorExport(mirrorExport), frameCapture(frameCapture),
+  framePacer(framePacer)
+{
+  thread = std::thread(&Submitter::submissionLoop, this);
+}
+
+Submitter::~Submitter()
+{
+  stop();
+}
+
+void Submitter::enqueue(const Submission& submission)
+{
+  Job job;
+  job.submission = submission;
+  push(job);
+  ++enqueuedCount;
+}
+
+void Submitter::waitIdle()
+{
+  size_t count = processedCount.load(std::memory_order_acquire);
+  while (count != enqueuedCount)
+  {
+    processedCount.wait(count, std::memory_order_acquire);
+    count = processedCount.load(std::memory_order_acquire);
+  }
+}
+
+void Submitter::stop()
+{
+  if (!thread.joinable())
+  {
+    return;
+  }
+
+  Job job;
+  job.stop = true;
+  push(job);
+  thread.join();
+}
+
+void Submitter::push(const Job& job)
+{
+  while (!queue.push(job))
+  {
+    queue.waitUntilNotFull();
+  }
+}
+
+void Submitter::submissionLoop()
+{
+  while (true)
+  {
+    Job job;
+    while (!queue.pop(job))
+    {
+      queue.waitUntilNotEmpty();
+    }
+
+    if (job.stop)
+    {
+      return;
+    }
+
+    const Submission& submission = job.submission;
+    if (submission.submit)
+    {
+      renderer->submit(submission.present);
+    }
+
+    if (submission.present)
+    {
+      mirrorView->present();
+    }
+
+    if (submission.exportMirror)
+    {
+      mirrorExport->signal();
+    }
+
+    if (submission.capture)
+    {
+      frameCapture->markSubmitted(submission.readbackBufferIndex, renderer->getFrameTimeline()->getLastFrame());
+    }
+
+    if (submission.endFrame)
+    {
+      headset->endFrame();
+    }
+
+    // The frame pacer can begin the next frame now, unless the render thread still needs the frame
+    if (!submission.holdFrame)
+    {
+      framePacer->releaseFrame();
+    }
+
+    processedCount.fetch_add(1u, std::memory_order_release);
+    processedCount.notify_all();
+  }
+}
\ No newline at end of file
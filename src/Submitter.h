@@ -0,0 +1,70 @@
+#pragma once
+
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <thread>
+
+class FrameCapture;
+class FramePacer;
+class Headset;
+class MirrorExport;
+class MirrorView;
+class Renderer;
+
+/*
+ * The submitter class owns all per-frame access to the draw and present queues and the ending of headset frames, so
+ * that the queues, which the runtime also uses in xrEndFrame, are only ever accessed from a single thread in a fixed
+ * order. The render thread hands each frame over through a lock-free queue, the submission thread then submits the
+ * recorded command buffer, presents the mirror view, signals the exported mirror image, marks the captured frame as
+ * submitted and ends the headset frame in that order. Once all of that is done the frame is released back to the frame
+ * pacer, so a frame is never begun before the previous one has been ended. The render thread can't record the next
+ * frame before then either, but it processes window events and the frame costs while presenting and ending the frame
+ * block, and the simulation thread already works on the next frame.
+ */
+class Submitter final
+{
+public:
+  Submitter(Headset* headset,
+            Renderer* renderer,
+            MirrorView* mirrorView,     // Optional
+            MirrorExport* mirrorExport, // Optional
+            FrameCapture* frameCapture, // Optional
+            FramePacer* framePacer);
+  ~Submitter();
+
+  struct Submission
+  {
+    bool submit = false;             // Submit the recorded command buffer
+    bool present = false;            // Present the mirror view, requires a submission
+    bool exportMirror = false;       // Signal the exported mirror image, requires a submission
+    bool capture = false;            // Mark the captured frame as submitted, requires a submission
+    size_t readbackBufferIndex = 0u; // That the frame was captured into
+    bool endFrame = false;           // End the headset frame
+    bool holdFrame = false;          // Don't release the frame to the frame pacer, the render thread does instead
+  };
+  void enqueue(const Submission& submission); // Call from the render thread only
+  void waitIdle(); // Blocks until all enqueued submissions have been processed, call before any other queue access
+  void stop();
+
+private:
+  Headset* headset = nullptr;
+  Renderer* renderer = nullptr;
+  MirrorView* mirrorView = nullptr;
+  MirrorExport* mirrorExport = nullptr;
+  FrameCapture* frameCapture = nullptr;
+  FramePacer* framePacer = nullptr;
+
+  struct Job
+  {
+    Submission submission;
+    bool stop = false;
+  };
+  SpscQueue<Job, 4u> queue;
+  std::thread thread;
+  size_t enqueuedCount = 0u;
+  std::atomic<size_t> processedCount = 0u;
+
+  void push(const Job& job);
+  void submissionLoop();
+};
\ No newline at end of file
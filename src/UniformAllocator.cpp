@@ -0,0 +1,181 @@
+#include "UniformAllocator.h"
+
+#include "Context.h"
+#include "DataBuffer.h"
+#include "Util.h"
+
+#include <algorithm>
+
+UniformAllocator::UniformAllocator(const Context* context,
+                                   VkDescriptorSetLayout descriptorSetLayout,
+                                   VkDeviceSize pageSize)
+: context(context), descriptorSetLayout(descriptorSetLayout), pageSize(pageSize)
+{
+  // Create the first page up front so that regular frames never have to allocate
+  if (!addPage(pageSize))
+  {
+    valid = false;
+    return;
+  }
+}
+
+UniformAllocator::~UniformAllocator()
+{
+  const VkDevice device = context->getVkDevice();
+  for (const Page& page : pages)
+  {
+    if (device && page.descriptorPool)
+    {
+      vkDestroyDescriptorPool(device, page.descriptorPool, nullptr);
+    }
+
+    if (page.buffer)
+    {
+      page.buffer->unmap();
+    }
+    delete page.buffer;
+  }
+}
+
+UniformAllocator::Allocation UniformAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+  Allocation allocation;
+
+  // Move on to the next page if the block does not fit into the current one, chain on a new page if there is none left
+  VkDeviceSize offset = util::align(currentOffset, alignment);
+  while (offset + size > pages.at(currentPageIndex).size)
+  {
+    ++currentPageIndex;
+    if (currentPageIndex >= pages.size())
+    {
+      if (!addPage(std::max(pageSize, size)))
+      {
+        --currentPageIndex;
+        return allocation;
+      }
+    }
+
+    offset = 0u;
+  }
+
+  const Page& page = pages.at(currentPageIndex);
+  currentOffset = offset + size;
+
+  allocation.data = page.memory + offset;
+  allocation.descriptorSet = page.descriptorSet;
+  allocation.offset = offset;
+  return allocation;
+}
+
+UniformAllocator::Allocation UniformAllocator::allocatePersistent(VkDeviceSize size, VkDeviceSize alignment)
+{
+  // Move the reset point past the block so that it is never handed out again
+  const Allocation allocation = allocate(size, alignment);
+  if (allocation.data)
+  {
+    persistentPageIndex = currentPageIndex;
+    persistentOffset = currentOffset;
+  }
+
+  return allocation;
+}
+
+void UniformAllocator::reset()
+{
+  // Keep all pages around, a frame that needed them once is likely to need them again
+  currentPageIndex = persistentPageIndex;
+  currentOffset = persistentOffset;
+}
+
+void UniformAllocator::clear()
+{
+  persistentPageIndex = 0u;
+  persistentOffset = 0u;
+  reset();
+}
+
+bool UniformAllocator::isValid() const
+{
+  return valid;
+}
+
+bool UniformAllocator::addPage(VkDeviceSize size)
+{
+  // Make sure the whole page can be bound as a single storage buffer
+  if (size > context->getMaxStorageBufferRange())
+  {
+    util::error(Error::FeatureNotSupported, "Storage buffer range for uniform allocator page");
+    return false;
+  }
+
+  const VkDevice device = context->getVkDevice();
+
+  Page page;
+  page.size = size;
+
+  // Create an empty page buffer
+  page.buffer = new DataBuffer(context, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, size);
+  if (!page.buffer->isValid())
+  {
+    delete page.buffer;
+    return false;
+  }
+
+  // Map the page buffer memory for the lifetime of the page
+  page.memory = static_cast<char*>(page.buffer->map());
+  if (!page.memory)
+  {
+    delete page.buffer;
+    return false;
+  }
+
+  // Create a descriptor pool that holds exactly the descriptor set of this page
+  VkDescriptorPoolSize descriptorPoolSize;
+  descriptorPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  descriptorPoolSize.descriptorCount = 1u;
+
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+  descriptorPoolCreateInfo.poolSizeCount = 1u;
+  descriptorPoolCreateInfo.pPoolSizes = &descriptorPoolSize;
+  descriptorPoolCreateInfo.maxSets = 1u;
+  if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &page.descriptorPool) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    page.buffer->unmap();
+    delete page.buffer;
+    return false;
+  }
+
+  // Allocate a descriptor set
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+  descriptorSetAllocateInfo.descriptorPool = page.descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1u;
+  descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout;
+  if (vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &page.descriptorSet) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    vkDestroyDescriptorPool(device, page.descriptorPool, nullptr);
+    page.buffer->unmap();
+    delete page.buffer;
+    return false;
+  }
+
+  // Point the descriptor set at the whole page, it never needs to be updated again
+  VkDescriptorBufferInfo descriptorBufferInfo;
+  descriptorBufferInfo.buffer = page.buffer->getBuffer();
+  descriptorBufferInfo.offset = 0u;
+  descriptorBufferInfo.range = VK_WHOLE_SIZE;
+
+  VkWriteDescriptorSet writeDescriptorSet{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+  writeDescriptorSet.dstSet = page.descriptorSet;
+  writeDescriptorSet.dstBinding = 0u;
+  writeDescriptorSet.dstArrayElement = 0u;
+  writeDescriptorSet.descriptorCount = 1u;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  writeDescriptorSet.pBufferInfo = &descriptorBufferInfo;
+  vkUpdateDescriptorSets(device, 1u, &writeDescriptorSet, 0u, nullptr);
+
+  pages.push_back(page);
+  return true;
+}
\ No newline at end of file
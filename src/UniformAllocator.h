@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+class Context;
+class DataBuffer;
+
+/*
+ * The uniform allocator class hands out blocks of persistently mapped, host visible memory for per-frame constants. It
+ * is a linear allocator that bump-allocates aligned blocks and frees all of them at once when it is reset, which is
+ * only safe once the GPU has finished the frame that used them. The memory is split into pages, when a block does not
+ * fit into the current page, the next page is used or a new one is chained on, so existing pages never move. The pages
+ * that the largest frame chained on are kept for all later frames. Each page is exposed as a single storage buffer with
+ * its own descriptor set that is written once on creation. Shaders index into a page with the element offset of a
+ * block, so blocks can be of any size without ever rebuilding descriptor sets. Persistent blocks survive resets, which
+ * allows data that rarely changes to only be rewritten when it does change. They are only freed when the allocator is
+ * cleared, such as to allocate a larger block once the data has outgrown it.
+ */
+class UniformAllocator final
+{
+public:
+  UniformAllocator(const Context* context, VkDescriptorSetLayout descriptorSetLayout, VkDeviceSize pageSize);
+  ~UniformAllocator();
+
+  struct Allocation
+  {
+    void* data = nullptr; // Null if the allocation failed
+    VkDescriptorSet descriptorSet = nullptr;
+    VkDeviceSize offset = 0u; // In bytes from the start of the page
+  };
+
+  Allocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+  Allocation allocatePersistent(VkDeviceSize size, VkDeviceSize alignment); // Call before any per-frame allocation
+  void reset();
+  void clear(); // Also frees the persistent blocks
+
+  bool isValid() const;
+
+private:
+  bool valid = true;
+
+  const Context* context = nullptr;
+  VkDescriptorSetLayout descriptorSetLayout = nullptr;
+  VkDeviceSize pageSize = 0u;
+
+  struct Page
+  {
+    DataBuffer* buffer = nullptr;
+    char* memory = nullptr;
+    VkDeviceSize size = 0u;
+    VkDescriptorPool descriptorPool = nullptr;
+    VkDescriptorSet descriptorSet = nullptr;
+  };
+  std::vector<Page> pages;
+
+  size_t currentPageIndex = 0u, persistentPageIndex = 0u;
+  VkDeviceSize currentOffset = 0u, persistentOffset = 0u; // Into the current and the last persistent page
+
+  bool addPage(VkDeviceSize size);
+};
\ No newline at end of file
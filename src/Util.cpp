@@ -14,12 +14,18 @@ void util::error(Error error, const std::string& details)
 
   switch (error)
   {
+  case Error::ConnectionFailure:
+    s << "Failed to set up a connection between processes";
+    break;
   case Error::FeatureNotSupported:
     s << "Required feature is not supported";
     break;
   case Error::FileMissing:
     s << "Failed to find file";
     break;
+  case Error::FileWriteFailure:
+    s << "Failed to write file";
+    break;
   case Error::GenericGLFW:
     s << "Program encountered a generic GLFW error";
     break;
@@ -205,6 +211,16 @@ glm::mat4 util::poseToMatrix(const XrPosef& pose)
   return translation * rotation;
 }
 
+XrPosef util::matrixToPose(const glm::mat4& matrix)
+{
+  const glm::quat orientation = glm::normalize(glm::quat_cast(matrix));
+
+  XrPosef pose;
+  pose.position = { matrix[3].x, matrix[3].y, matrix[3].z };
+  pose.orientation = { orientation.x, orientation.y, orientation.z, orientation.w };
+  return pose;
+}
+
 glm::mat4 util::createProjectionMatrix(XrFovf fov, float nearClip, float farClip)
 {
   const float l = glm::tan(fov.angleLeft);
@@ -250,5 +266,63 @@ bool util::updateActionStateFloat(XrSession session, XrAction action, XrPath pat
     return false;
   }
 
+  return true;
+}
+
+bool util::isTracked(XrSpaceLocationFlags locationFlags)
+{
+  constexpr XrSpaceLocationFlags checkFlags =
+    XR_SPACE_LOCATION_POSITION_VALID_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT |
+    XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
+  return (locationFlags & checkFlags) == checkFlags;
+}
+
+bool util::locateSpaces(XrSession session,
+                        PFN_xrLocateSpacesKHR xrLocateSpacesKHR,
+                        XrSpace baseSpace,
+                        XrTime time,
+                        const std::vector<XrSpace>& spaces,
+                        std::vector<XrSpaceLocationData>& locations,
+                        size_t& callCount)
+{
+  locations.resize(spaces.size());
+
+  if (xrLocateSpacesKHR)
+  {
+    XrSpacesLocateInfo spacesLocateInfo{ XR_TYPE_SPACES_LOCATE_INFO };
+    spacesLocateInfo.baseSpace = baseSpace;
+    spacesLocateInfo.time = time;
+    spacesLocateInfo.spaceCount = static_cast<uint32_t>(spaces.size());
+    spacesLocateInfo.spaces = spaces.data();
+
+    XrSpaceLocations spaceLocations{ XR_TYPE_SPACE_LOCATIONS };
+    spaceLocations.locationCount = static_cast<uint32_t>(locations.size());
+    spaceLocations.locations = locations.data();
+
+    ++callCount;
+    const XrResult result = xrLocateSpacesKHR(session, &spacesLocateInfo, &spaceLocations);
+    if (XR_FAILED(result))
+    {
+      return false;
+    }
+
+    return true;
+  }
+
+  for (size_t spaceIndex = 0u; spaceIndex < spaces.size(); ++spaceIndex)
+  {
+    XrSpaceLocation spaceLocation{ XR_TYPE_SPACE_LOCATION };
+    ++callCount;
+    const XrResult result = xrLocateSpace(spaces.at(spaceIndex), baseSpace, time, &spaceLocation);
+    if (XR_FAILED(result))
+    {
+      return false;
+    }
+
+    XrSpaceLocationData& location = locations.at(spaceIndex);
+    location.locationFlags = spaceLocation.locationFlags;
+    location.pose = spaceLocation.pose;
+  }
+
   return true;
 }
\ No newline at end of file
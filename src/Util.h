@@ -12,8 +12,10 @@
 // All the things that can go wrong
 enum class Error
 {
+  ConnectionFailure,
   FeatureNotSupported,
   FileMissing,
+  FileWriteFailure,
   GenericGLFW,
   GenericOpenXR,
   GenericVulkan,
@@ -69,6 +71,9 @@ XrPosef makeIdentity();
 // Converts an OpenXR pose to a transformation matrix
 glm::mat4 poseToMatrix(const XrPosef& pose);
 
+// Converts a transformation matrix without scale back to an OpenXR pose
+XrPosef matrixToPose(const glm::mat4& matrix);
+
 // Creates an OpenXR projection matrix
 glm::mat4 createProjectionMatrix(XrFovf fov, float nearClip, float farClip);
 
@@ -77,4 +82,17 @@ bool updateActionStatePose(XrSession session, XrAction action, XrPath path, XrAc
 
 // Updates an action state for a given action and path in float format, returns false on error
 bool updateActionStateFloat(XrSession session, XrAction action, XrPath path, XrActionStateFloat& state);
+
+// Returns whether a located OpenXR position and orientation are both valid and tracked
+bool isTracked(XrSpaceLocationFlags locationFlags);
+
+// Locates OpenXR spaces in a single call if 'xrLocateSpacesKHR' is given or one by one otherwise, adds the number of
+// OpenXR calls to 'callCount', returns false on error
+bool locateSpaces(XrSession session,
+                  PFN_xrLocateSpacesKHR xrLocateSpacesKHR,
+                  XrSpace baseSpace,
+                  XrTime time,
+                  const std::vector<XrSpace>& spaces,
+                  std::vector<XrSpaceLocationData>& locations,
+                  size_t& callCount);
 } // namespace util
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "WindowSwapchain.h"
+
+#include "Util.h"
+
+#include <glfw/glfw3.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace
+{
+constexpr VkFormat colorFormat = VK_FORMAT_B8G8R8A8_SRGB;
+constexpr std::array preferredPresentModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR }; // Or FIFO
+} // namespace
+
+WindowSwapchain::WindowSwapchain(VkPhysicalDevice physicalDevice,
+                                 VkDevice device,
+                                 GLFWwindow* window,
+                                 VkSurfaceKHR surface,
+                                 bool vsync)
+: physicalDevice(physicalDevice), device(device), window(window), surface(surface), vsync(vsync)
+{
+}
+
+WindowSwapchain::~WindowSwapchain()
+{
+  if (swapchain)
+  {
+    vkDestroySwapchainKHR(device, swapchain, nullptr);
+  }
+}
+
+bool WindowSwapchain::recreate()
+{
+  // Get the surface capabilities and extent
+  VkSurfaceCapabilitiesKHR surfaceCapabilities;
+  {
+    if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      return false;
+    }
+
+    if (!(surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+    {
+      util::error(Error::FeatureNotSupported, "Vulkan swapchain transfer destination usage");
+      return false;
+    }
+
+    if (surfaceCapabilities.currentExtent.width != std::numeric_limits<uint32_t>::max() &&
+        surfaceCapabilities.currentExtent.height != std::numeric_limits<uint32_t>::max())
+    {
+      // Use any valid extent
+      resolution = surfaceCapabilities.currentExtent;
+    }
+    else
+    {
+      // Find the closest extent to use instead of an invalid extent
+      int width, height;
+      glfwGetFramebufferSize(window, &width, &height);
+
+      resolution.width = std::clamp(static_cast<uint32_t>(width), surfaceCapabilities.minImageExtent.width,
+                                    surfaceCapabilities.maxImageExtent.width);
+      resolution.height = std::clamp(static_cast<uint32_t>(height), surfaceCapabilities.minImageExtent.height,
+                                     surfaceCapabilities.maxImageExtent.height);
+    }
+
+    // Skip the rest if the window was minimized
+    if (resolution.width == 0u || resolution.height == 0u)
+    {
+      return true;
+    }
+  }
+
+  // Get the surface formats and pick one with the desired color format support
+  VkSurfaceFormatKHR surfaceFormat;
+  {
+    uint32_t surfaceFormatCount = 0u;
+    if (vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &surfaceFormatCount, nullptr) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      return false;
+    }
+
+    std::vector<VkSurfaceFormatKHR> surfaceFormats(surfaceFormatCount);
+    if (vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &surfaceFormatCount, surfaceFormats.data()) !=
+        VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      return false;
+    }
+
+    // Find the surface format to use
+    bool surfaceFormatFound = false;
+    for (const VkSurfaceFormatKHR& surfaceFormatCandidate : surfaceFormats)
+    {
+      if (surfaceFormatCandidate.format == colorFormat)
+      {
+        surfaceFormat = surfaceFormatCandidate;
+        surfaceFormatFound = true;
+        break;
+      }
+    }
+
+    if (!surfaceFormatFound)
+    {
+      util::error(Error::FeatureNotSupported, "Vulkan swapchain color format");
+      return false;
+    }
+  }
+
+  // Pick a present mode that does not block presentation on the vertical blank unless asked to, FIFO always waits for
+  // it and is always supported
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+  if (!vsync)
+  {
+    uint32_t presentModeCount = 0u;
+    if (vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, nullptr) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      return false;
+    }
+
+    std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+    if (vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data()) !=
+        VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      return false;
+    }
+
+    for (const VkPresentModeKHR preferredPresentMode : preferredPresentModes)
+    {
+      if (std::find(presentModes.begin(), presentModes.end(), preferredPresentMode) != presentModes.end())
+      {
+        presentMode = preferredPresentMode;
+        break;
+      }
+    }
+  }
+
+  // Create a new swapchain, the old one is retired by it and destroyed afterwards
+  const VkSwapchainKHR oldSwapchain = swapchain;
+
+  VkSwapchainCreateInfoKHR swapchainCreateInfo{ VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
+  swapchainCreateInfo.surface = surface;
+  swapchainCreateInfo.presentMode = presentMode;
+  swapchainCreateInfo.minImageCount = surfaceCapabilities.minImageCount + 1u;
+  if (surfaceCapabilities.maxImageCount > 0u)
+  {
+    swapchainCreateInfo.minImageCount = std::min(swapchainCreateInfo.minImageCount, surfaceCapabilities.maxImageCount);
+  }
+  swapchainCreateInfo.imageColorSpace = surfaceFormat.colorSpace;
+  swapchainCreateInfo.imageFormat = surfaceFormat.format;
+  swapchainCreateInfo.imageExtent = resolution;
+  swapchainCreateInfo.imageArrayLayers = 1u;
+  swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  swapchainCreateInfo.preTransform = surfaceCapabilities.currentTransform;
+  swapchainCreateInfo.clipped = VK_TRUE;
+  swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+  swapchainCreateInfo.oldSwapchain = oldSwapchain;
+  const VkResult result = vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr, &swapchain);
+
+  if (oldSwapchain)
+  {
+    vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+  }
+
+  if (result != VK_SUCCESS)
+  {
+    swapchain = nullptr;
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  // Retrieve the new swapchain images
+  uint32_t imageCount = 0u;
+  if (vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  images.resize(imageCount);
+  if (vkGetSwapchainImagesKHR(device, swapchain, &imageCount, images.data()) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  return true;
+}
+
+VkSwapchainKHR WindowSwapchain::getSwapchain() const
+{
+  return swapchain;
+}
+
+VkImage WindowSwapchain::getImage(uint32_t imageIndex) const
+{
+  return images.at(imageIndex);
+}
+
+VkExtent2D WindowSwapchain::getResolution() const
+{
+  return resolution;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+struct GLFWwindow;
+
+/*
+ * The window swapchain class creates the swapchain of a window surface and recreates it whenever the window has been
+ * resized. It is shared by the mirror view and the viewer process, which both only ever blit into the swapchain images.
+ * While the window is minimized its resolution is zero and the previous swapchain is kept until it is restored. The
+ * window and the surface are owned by the caller.
+ */
+class WindowSwapchain final
+{
+public:
+  WindowSwapchain(VkPhysicalDevice physicalDevice,
+                  VkDevice device,
+                  GLFWwindow* window,
+                  VkSurfaceKHR surface,
+                  bool vsync); // Whether to wait for the vertical blank, otherwise a mode that doesn't is preferred
+  ~WindowSwapchain();
+
+  bool recreate(); // Call once the swapchain images are no longer in use, returns false on error
+
+  VkSwapchainKHR getSwapchain() const;
+  VkImage getImage(uint32_t imageIndex) const;
+  VkExtent2D getResolution() const; // Zero while the window is minimized
+
+private:
+  VkPhysicalDevice physicalDevice = nullptr;
+  VkDevice device = nullptr;
+  GLFWwindow* window = nullptr;
+  VkSurfaceKHR surface = nullptr;
+  bool vsync = false;
+
+  VkSwapchainKHR swapchain = nullptr;
+  std::vector<VkImage> images;
+  VkExtent2D resolution = { 0u, 0u };
+};
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(size_t workerCount)
+{
+  threads.reserve(workerCount);
+  for (size_t workerIndex = 0u; workerIndex < workerCount; ++workerIndex)
+  {
+    threads.emplace_back(&WorkerPool::workerLoop, this, workerIndex);
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopRequested = true;
+  }
+  jobCondition.notify_all();
+
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+}
+
+void WorkerPool::run(const std::function<void(size_t workerIndex)>& job)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  this->job = &job;
+  pendingWorkerCount = threads.size();
+  ++jobGeneration;
+  jobCondition.notify_all();
+
+  // Wait until every worker has finished the job
+  doneCondition.wait(lock, [this] { return pendingWorkerCount == 0u; });
+  this->job = nullptr;
+}
+
+size_t WorkerPool::getWorkerCount() const
+{
+  return threads.size();
+}
+
+void WorkerPool::workerLoop(size_t workerIndex)
+{
+  size_t lastJobGeneration = 0u;
+  while (true)
+  {
+    const std::function<void(size_t workerIndex)>* currentJob = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobCondition.wait(lock,
+                        [this, lastJobGeneration] { return stopRequested || jobGeneration != lastJobGeneration; });
+      if (stopRequested)
+      {
+        return;
+      }
+
+      lastJobGeneration = jobGeneration;
+      currentJob = job;
+    }
+
+    (*currentJob)(workerIndex);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      --pendingWorkerCount;
+    }
+    doneCondition.notify_one();
+  }
+}
\ No newline at end of file
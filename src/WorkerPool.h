@@ -0,0 +1,34 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * The worker pool class keeps a number of threads alive for the lifetime of the application, so that work can be
+ * spread across cores without creating threads every frame. A job is run on all workers at once, each worker receives
+ * its own index to pick its share of the work. Running a job blocks until all workers have finished it.
+ */
+class WorkerPool final
+{
+public:
+  WorkerPool(size_t workerCount);
+  ~WorkerPool();
+
+  void run(const std::function<void(size_t workerIndex)>& job);
+
+  size_t getWorkerCount() const;
+
+private:
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable jobCondition, doneCondition;
+  const std::function<void(size_t workerIndex)>* job = nullptr;
+  size_t jobGeneration = 0u, pendingWorkerCount = 0u;
+  bool stopRequested = false;
+
+  void workerLoop(size_t workerIndex);
+};
\ No newline at end of file
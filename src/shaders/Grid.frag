@@ -1,4 +1,15 @@
-layout(binding = 2) uniform Time { float value; } time;
+// The per-frame constants live in blocks of the uniform allocator, these are their offsets in elements
+layout(push_constant) uniform Offsets
+{
+  uint worldMatrices;
+  uint viewProjectionMatrices;
+  uint time;
+  uint viewCount;  // Of the view projection matrices, only used for culling
+  uint drawInputs; // Follow the world matrices, only used for culling
+  uint drawCount;  // Of the draw inputs, only used for culling
+} offsets;
+
+layout(set = 2, binding = 0) readonly buffer Time { float values[]; } time;
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
@@ -12,7 +23,7 @@ bool isOnGrid(float position, float threshold)
 
 void main()
 {
-  const float animation = abs(sin(time.value * 2.0 + position.x / 10.0 + position.z / 10.0));
+  const float animation = abs(sin(time.values[offsets.time] * 2.0 + position.x / 10.0 + position.z / 10.0));
   const float crossThickness = 0.005 + animation * 0.01;
   const float crossLength = 0.025 + animation * 0.05;
 
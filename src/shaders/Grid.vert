@@ -1,13 +1,24 @@
 #extension GL_EXT_multiview : enable
 
-layout(binding = 0) uniform World
+// The per-frame constants live in blocks of the uniform allocator, these are their offsets in elements
+layout(push_constant) uniform Offsets
 {
-    mat4 matrix;
+  uint worldMatrices;
+  uint viewProjectionMatrices;
+  uint time;
+  uint viewCount;  // Of the view projection matrices, only used for culling
+  uint drawInputs; // Follow the world matrices, only used for culling
+  uint drawCount;  // Of the draw inputs, only used for culling
+} offsets;
+
+layout(set = 0, binding = 0) readonly buffer World
+{
+    mat4 matrices[];
 } world;
 
-layout(binding = 1) uniform ViewProjection
+layout(set = 1, binding = 0) readonly buffer ViewProjection
 {
-    mat4 matrices[2];
+    mat4 matrices[];
 } viewProjection;
 
 layout(location = 0) in vec3 inPosition;
@@ -18,8 +29,9 @@ layout(location = 1) out vec3 color;
 
 void main()
 {
-  vec4 pos = world.matrix * vec4(inPosition, 1.0);
-  gl_Position = viewProjection.matrices[gl_ViewIndex] * pos;
+  // The instance index is the model index
+  vec4 pos = world.matrices[offsets.worldMatrices + gl_InstanceIndex] * vec4(inPosition, 1.0);
+  gl_Position = viewProjection.matrices[offsets.viewProjectionMatrices + gl_ViewIndex] * pos;
   position = pos.xyz;
 
   color = inColor;
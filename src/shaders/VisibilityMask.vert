@@ -0,0 +1,34 @@
+#extension GL_EXT_multiview : enable
+
+// The per-frame constants live in blocks of the uniform allocator, these are their offsets in elements
+layout(push_constant) uniform Offsets
+{
+  uint worldMatrices;
+  uint viewProjectionMatrices; // Points at the projection matrices for the visibility mask
+  uint time;
+  uint viewCount;
+  uint drawInputs; // Follow the world matrices, only used for culling
+  uint drawCount;  // Of the draw inputs, only used for culling
+} offsets;
+
+layout(set = 1, binding = 0) readonly buffer Projection
+{
+    mat4 matrices[];
+} projection;
+
+layout(location = 0) in vec2 inPosition; // In the view space of the eye on the plane z = -1
+layout(location = 1) in uint inEyeIndex;
+
+void main()
+{
+  // The mask of all eyes is drawn to every view, collapse the triangles that belong to other eyes
+  if (inEyeIndex != gl_ViewIndex)
+  {
+    gl_Position = vec4(0.0);
+    return;
+  }
+
+  // Write the nearest depth so that everything drawn later fails the depth test
+  const vec4 position = projection.matrices[offsets.viewProjectionMatrices + gl_ViewIndex] * vec4(inPosition, -1.0, 1.0);
+  gl_Position = vec4(position.xy, 0.0, position.w);
+}
\ No newline at end of file
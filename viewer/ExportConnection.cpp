@@ -0,0 +1,111 @@
+#include "ExportConnection.h"
+
+#include "Util.h"
+
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+ExportConnection::ExportConnection(const std::string& socketPath)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socketPath.length() >= sizeof(address.sun_path))
+  {
+    util::error(Error::ConnectionFailure, "Socket path \"" + socketPath + "\" too long");
+    valid = false;
+    return;
+  }
+  std::memcpy(address.sun_path, socketPath.c_str(), socketPath.length() + 1u);
+
+  // Connect to the socket of the example
+  socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socket < 0 || connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+  {
+    util::error(Error::ConnectionFailure, "Socket \"" + socketPath + "\"");
+    valid = false;
+    return;
+  }
+
+  // Receive the header along with the file descriptors
+  iovec payload;
+  payload.iov_base = &header;
+  payload.iov_len = sizeof(header);
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fileDescriptors))] = {};
+
+  msghdr message{};
+  message.msg_iov = &payload;
+  message.msg_iovlen = 1u;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  if (recvmsg(socket, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(sizeof(header)))
+  {
+    util::error(Error::ConnectionFailure, "Mirror export header");
+    valid = false;
+    return;
+  }
+
+  const cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+  if (!controlMessage || controlMessage->cmsg_level != SOL_SOCKET || controlMessage->cmsg_type != SCM_RIGHTS ||
+      controlMessage->cmsg_len != CMSG_LEN(sizeof(fileDescriptors)))
+  {
+    util::error(Error::ConnectionFailure, "Mirror export file descriptors");
+    valid = false;
+    return;
+  }
+  std::memcpy(fileDescriptors.data(), CMSG_DATA(controlMessage), sizeof(fileDescriptors));
+
+  if (header.version != MirrorExport::Header().version)
+  {
+    util::error(Error::FeatureNotSupported, "Mirror export header version");
+    valid = false;
+    return;
+  }
+}
+
+ExportConnection::~ExportConnection()
+{
+  for (const int fileDescriptor : fileDescriptors)
+  {
+    if (fileDescriptor >= 0)
+    {
+      close(fileDescriptor);
+    }
+  }
+
+  if (socket >= 0)
+  {
+    close(socket);
+  }
+}
+
+bool ExportConnection::isValid() const
+{
+  return valid;
+}
+
+bool ExportConnection::isClosed() const
+{
+  // Reading zero bytes means that the other end has been closed
+  char byte;
+  return recv(socket, &byte, 1u, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+const MirrorExport::Header& ExportConnection::getHeader() const
+{
+  return header;
+}
+
+int ExportConnection::getFileDescriptor(size_t index) const
+{
+  return fileDescriptors.at(index);
+}
+
+void ExportConnection::releaseFileDescriptor(size_t index)
+{
+  fileDescriptors.at(index) = -1;
+}
\ No newline at end of file
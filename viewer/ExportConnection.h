@@ -0,0 +1,33 @@
+#pragma once
+
+#include "MirrorExport.h"
+
+#include <array>
+#include <string>
+
+/*
+ * The export connection class connects to the socket that the example listens on when it is started with
+ * "--export-mirror <socket path>" and receives the header of the exported mirror image along with the file descriptors
+ * of its memory and of the written and released semaphores. The example only sends these once it has rendered a frame,
+ * so connecting may block for a moment. The example closes the connection when it exits.
+ */
+class ExportConnection final
+{
+public:
+  ExportConnection(const std::string& socketPath);
+  ~ExportConnection();
+
+  bool isValid() const;
+  bool isClosed() const; // Whether the example has closed the connection, never blocks
+
+  const MirrorExport::Header& getHeader() const;
+  int getFileDescriptor(size_t index) const; // 0 = memory, 1 = written semaphore, 2 = released semaphore
+  void releaseFileDescriptor(size_t index);  // Call once an import has taken ownership of the file descriptor
+
+private:
+  bool valid = true;
+
+  int socket = -1;
+  MirrorExport::Header header;
+  std::array<int, 1u + MirrorExport::semaphoreCount> fileDescriptors = { -1, -1, -1 };
+};
\ No newline at end of file
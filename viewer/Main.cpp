@@ -0,0 +1,104 @@
+#include "ExportConnection.h"
+#include "SharedImage.h"
+#include "Util.h"
+#include "ViewerContext.h"
+#include "ViewerWindow.h"
+
+#include <cstdlib>
+
+/*
+ * The viewer is a separate process that shows the mirror image exported by the example when it is started with
+ * "--export-mirror <socket path>". It connects to that socket, imports the image memory and the written and released
+ * timeline semaphores on the same Vulkan device, and blits each new copy into a desktop window. All window system work
+ * happens in this process, so the headset is never held up by it.
+ */
+
+namespace
+{
+constexpr uint64_t waitTimeout = 100000000u; // In nanoseconds, how long to wait for a new copy before polling events
+} // namespace
+
+// Pass the socket path that the example was started with, "--export-mirror <socket path>"
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    util::error(Error::ConnectionFailure, "No socket path given");
+    return EXIT_FAILURE;
+  }
+
+  ExportConnection connection(argv[1]);
+  if (!connection.isValid())
+  {
+    return EXIT_FAILURE;
+  }
+
+  ViewerContext context;
+  if (!context.isValid())
+  {
+    return EXIT_FAILURE;
+  }
+
+  const MirrorExport::Header& header = connection.getHeader();
+  ViewerWindow window(&context, { header.width, header.height });
+  if (!window.isValid())
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!context.createDevice(header, window.getSurface()))
+  {
+    return EXIT_FAILURE;
+  }
+
+  SharedImage sharedImage(&context, &connection);
+  if (!sharedImage.isValid())
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!window.connect(&sharedImage))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Show every new copy, the example skips copies until the previous one has been released
+  int exitCode = EXIT_SUCCESS;
+  uint64_t nextValue = header.writtenValue + 1u;
+  while (!window.isExitRequested())
+  {
+    window.processWindowEvents();
+
+    uint64_t value = 0u;
+    const SharedImage::WaitResult waitResult = sharedImage.waitForCopy(nextValue, waitTimeout, value);
+    if (waitResult == SharedImage::WaitResult::Error)
+    {
+      exitCode = EXIT_FAILURE;
+      break;
+    }
+    else if (waitResult == SharedImage::WaitResult::Timeout)
+    {
+      // Close along with the example
+      if (connection.isClosed())
+      {
+        break;
+      }
+
+      continue;
+    }
+
+    const ViewerWindow::ShowResult showResult = window.show(value);
+    if (showResult == ViewerWindow::ShowResult::Error)
+    {
+      exitCode = EXIT_FAILURE;
+      break;
+    }
+    else if (showResult == ViewerWindow::ShowResult::Released)
+    {
+      nextValue = value + 1u;
+    }
+  }
+
+  context.sync(); // Sync before destroying so that resources are free
+  return exitCode;
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "SharedImage.h"
+
+#include "ExportConnection.h"
+#include "Util.h"
+#include "ViewerContext.h"
+
+#include <array>
+
+SharedImage::SharedImage(const ViewerContext* context, ExportConnection* connection) : context(context)
+{
+  const VkDevice device = context->getVkDevice();
+  const MirrorExport::Header& header = connection->getHeader();
+  resolution = { header.width, header.height };
+
+  // Create an image exactly like the exported one
+  VkExternalMemoryImageCreateInfo externalMemoryImageCreateInfo{
+    VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO
+  };
+  externalMemoryImageCreateInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+  VkImageCreateInfo imageCreateInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+  imageCreateInfo.pNext = &externalMemoryImageCreateInfo;
+  imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageCreateInfo.extent = { header.width, header.height, 1u };
+  imageCreateInfo.mipLevels = 1u;
+  imageCreateInfo.arrayLayers = 1u;
+  imageCreateInfo.format = MirrorExport::format;
+  imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageCreateInfo.usage = MirrorExport::usage;
+  imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  if (vkCreateImage(device, &imageCreateInfo, nullptr, &image) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
+  }
+
+  // Import the image memory, a successful import takes ownership of the file descriptor
+  VkMemoryDedicatedAllocateInfo memoryDedicatedAllocateInfo{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+  memoryDedicatedAllocateInfo.image = image;
+
+  VkImportMemoryFdInfoKHR importMemoryFdInfo{ VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR };
+  importMemoryFdInfo.pNext = &memoryDedicatedAllocateInfo;
+  importMemoryFdInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+  importMemoryFdInfo.fd = connection->getFileDescriptor(0u);
+
+  VkMemoryAllocateInfo memoryAllocateInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+  memoryAllocateInfo.pNext = &importMemoryFdInfo;
+  memoryAllocateInfo.allocationSize = header.allocationSize;
+  memoryAllocateInfo.memoryTypeIndex = header.memoryTypeIndex;
+  if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &deviceMemory) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
+  }
+  connection->releaseFileDescriptor(0u);
+
+  if (vkBindImageMemory(device, image, deviceMemory, 0u) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
+  }
+
+  // Import the semaphores, again a successful import takes ownership of the file descriptor
+  const auto vkImportSemaphoreFdKHR = reinterpret_cast<PFN_vkImportSemaphoreFdKHR>(
+    vkGetDeviceProcAddr(device, "vkImportSemaphoreFdKHR"));
+  if (!vkImportSemaphoreFdKHR)
+  {
+    util::error(Error::FeatureNotSupported, "Vulkan extension function \"vkImportSemaphoreFdKHR\"");
+    valid = false;
+    return;
+  }
+
+  VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+  semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+  semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+  const std::array<VkSemaphore*, MirrorExport::semaphoreCount> semaphores = { &writtenSemaphore, &releasedSemaphore };
+  for (size_t semaphoreIndex = 0u; semaphoreIndex < semaphores.size(); ++semaphoreIndex)
+  {
+    if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, semaphores.at(semaphoreIndex)) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      valid = false;
+      return;
+    }
+
+    const size_t fileDescriptorIndex = 1u + semaphoreIndex;
+
+    VkImportSemaphoreFdInfoKHR importSemaphoreFdInfo{ VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR };
+    importSemaphoreFdInfo.semaphore = *semaphores.at(semaphoreIndex);
+    importSemaphoreFdInfo.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+    importSemaphoreFdInfo.fd = connection->getFileDescriptor(fileDescriptorIndex);
+    if (vkImportSemaphoreFdKHR(device, &importSemaphoreFdInfo) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      valid = false;
+      return;
+    }
+    connection->releaseFileDescriptor(fileDescriptorIndex);
+  }
+}
+
+SharedImage::~SharedImage()
+{
+  const VkDevice device = context->getVkDevice();
+  if (device)
+  {
+    if (releasedSemaphore)
+    {
+      vkDestroySemaphore(device, releasedSemaphore, nullptr);
+    }
+
+    if (writtenSemaphore)
+    {
+      vkDestroySemaphore(device, writtenSemaphore, nullptr);
+    }
+
+    if (image)
+    {
+      vkDestroyImage(device, image, nullptr);
+    }
+
+    if (deviceMemory)
+    {
+      vkFreeMemory(device, deviceMemory, nullptr);
+    }
+  }
+}
+
+SharedImage::WaitResult SharedImage::waitForCopy(uint64_t minValue, uint64_t timeout, uint64_t& value) const
+{
+  const VkDevice device = context->getVkDevice();
+
+  VkSemaphoreWaitInfo semaphoreWaitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+  semaphoreWaitInfo.semaphoreCount = 1u;
+  semaphoreWaitInfo.pSemaphores = &writtenSemaphore;
+  semaphoreWaitInfo.pValues = &minValue;
+  const VkResult result = vkWaitSemaphores(device, &semaphoreWaitInfo, timeout);
+  if (result == VK_TIMEOUT)
+  {
+    return WaitResult::Timeout;
+  }
+
+  // The example may have written several copies since, show the newest one
+  if (result != VK_SUCCESS || vkGetSemaphoreCounterValue(device, writtenSemaphore, &value) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return WaitResult::Error;
+  }
+
+  return WaitResult::Written;
+}
+
+bool SharedImage::releaseOnHost(uint64_t value) const
+{
+  VkSemaphoreSignalInfo semaphoreSignalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO };
+  semaphoreSignalInfo.semaphore = releasedSemaphore;
+  semaphoreSignalInfo.value = value;
+  if (vkSignalSemaphore(context->getVkDevice(), &semaphoreSignalInfo) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  return true;
+}
+
+bool SharedImage::isValid() const
+{
+  return valid;
+}
+
+VkImage SharedImage::getImage() const
+{
+  return image;
+}
+
+VkExtent2D SharedImage::getResolution() const
+{
+  return resolution;
+}
+
+VkSemaphore SharedImage::getWrittenSemaphore() const
+{
+  return writtenSemaphore;
+}
+
+VkSemaphore SharedImage::getReleasedSemaphore() const
+{
+  return releasedSemaphore;
+}
\ No newline at end of file
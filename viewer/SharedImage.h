@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+class ExportConnection;
+class ViewerContext;
+
+/*
+ * The shared image class imports the mirror image that the example exports, along with the written and released
+ * timeline semaphores. The image is created exactly like the exported one and bound to the imported memory. The example
+ * signals the written semaphore whenever it has copied a new frame into the image, and skips its copies until the
+ * viewer has signaled the released semaphore with the same value, either on the GPU once it has shown the copy or on
+ * the host if the copy is not shown at all.
+ */
+class SharedImage final
+{
+public:
+  SharedImage(const ViewerContext* context, ExportConnection* connection); // Takes over the file descriptors
+  ~SharedImage();
+
+  enum class WaitResult
+  {
+    Error,   // An error occurred
+    Written, // A new copy has been written
+    Timeout  // No new copy has been written in time
+  };
+  WaitResult waitForCopy(uint64_t minValue, uint64_t timeout, uint64_t& value) const; // Timeout in nanoseconds
+  bool releaseOnHost(uint64_t value) const; // Releases a copy without showing it, so the example can go on copying
+
+  bool isValid() const;
+  VkImage getImage() const;
+  VkExtent2D getResolution() const;
+  VkSemaphore getWrittenSemaphore() const;
+  VkSemaphore getReleasedSemaphore() const;
+
+private:
+  bool valid = true;
+
+  const ViewerContext* context = nullptr;
+
+  VkExtent2D resolution = { 0u, 0u };
+  VkImage image = nullptr;
+  VkDeviceMemory deviceMemory = nullptr;
+  VkSemaphore writtenSemaphore = nullptr, releasedSemaphore = nullptr;
+};
\ No newline at end of file
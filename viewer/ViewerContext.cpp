@@ -0,0 +1,208 @@
+#include "ViewerContext.h"
+
+#include "Util.h"
+
+#include <glfw/glfw3.h>
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+const std::string applicationName = "OpenXR Vulkan Example Viewer";
+} // namespace
+
+ViewerContext::ViewerContext()
+{
+  // Initialize GLFW
+  if (!glfwInit())
+  {
+    util::error(Error::GenericGLFW);
+    valid = false;
+    return;
+  }
+
+  if (!glfwVulkanSupported())
+  {
+    util::error(Error::VulkanNotSupported);
+    valid = false;
+    return;
+  }
+
+  // Create a Vulkan instance with the extensions that GLFW requires for the window surface
+  uint32_t instanceExtensionCount = 0u;
+  const char** instanceExtensions = glfwGetRequiredInstanceExtensions(&instanceExtensionCount);
+
+  VkApplicationInfo applicationInfo{ VK_STRUCTURE_TYPE_APPLICATION_INFO };
+  applicationInfo.pApplicationName = applicationName.c_str();
+  applicationInfo.apiVersion = VK_API_VERSION_1_2; // For timeline semaphores
+
+  VkInstanceCreateInfo instanceCreateInfo{ VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+  instanceCreateInfo.enabledExtensionCount = instanceExtensionCount;
+  instanceCreateInfo.ppEnabledExtensionNames = instanceExtensions;
+  if (vkCreateInstance(&instanceCreateInfo, nullptr, &instance) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    valid = false;
+    return;
+  }
+}
+
+ViewerContext::~ViewerContext()
+{
+  if (device)
+  {
+    vkDestroyDevice(device, nullptr);
+  }
+
+  if (instance)
+  {
+    vkDestroyInstance(instance, nullptr);
+  }
+}
+
+bool ViewerContext::createDevice(const MirrorExport::Header& header, VkSurfaceKHR surface)
+{
+  // Find the physical device with the same device and driver UUIDs as the one of the example
+  {
+    uint32_t physicalDeviceCount = 0u;
+    if (vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      return false;
+    }
+
+    std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
+    if (vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data()) != VK_SUCCESS)
+    {
+      util::error(Error::GenericVulkan);
+      return false;
+    }
+
+    for (const VkPhysicalDevice physicalDeviceCandidate : physicalDevices)
+    {
+      VkPhysicalDeviceIDProperties physicalDeviceIdProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES };
+      VkPhysicalDeviceProperties2 physicalDeviceProperties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+      physicalDeviceProperties2.pNext = &physicalDeviceIdProperties;
+      vkGetPhysicalDeviceProperties2(physicalDeviceCandidate, &physicalDeviceProperties2);
+
+      if (std::memcmp(physicalDeviceIdProperties.deviceUUID, header.deviceUuid, VK_UUID_SIZE) == 0 &&
+          std::memcmp(physicalDeviceIdProperties.driverUUID, header.driverUuid, VK_UUID_SIZE) == 0)
+      {
+        physicalDevice = physicalDeviceCandidate;
+        break;
+      }
+    }
+
+    if (!physicalDevice)
+    {
+      util::error(Error::FeatureNotSupported, "Vulkan physical device of the example");
+      return false;
+    }
+  }
+
+  // Pick a queue family that supports both drawing and presenting to the window surface
+  {
+    uint32_t queueFamilyCount = 0u;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    bool queueFamilyIndexFound = false;
+    for (uint32_t queueFamilyIndexCandidate = 0u; queueFamilyIndexCandidate < queueFamilyCount;
+         ++queueFamilyIndexCandidate)
+    {
+      const VkQueueFamilyProperties& queueFamilyCandidate = queueFamilies.at(queueFamilyIndexCandidate);
+
+      VkBool32 presentSupport = VK_FALSE;
+      if (vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFamilyIndexCandidate, surface, &presentSupport) !=
+          VK_SUCCESS)
+      {
+        util::error(Error::GenericVulkan);
+        return false;
+      }
+
+      if (queueFamilyCandidate.queueCount > 0u && (queueFamilyCandidate.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+          presentSupport)
+      {
+        queueFamilyIndex = queueFamilyIndexCandidate;
+        queueFamilyIndexFound = true;
+        break;
+      }
+    }
+
+    if (!queueFamilyIndexFound)
+    {
+      util::error(Error::FeatureNotSupported, "Graphics and present queue family index");
+      return false;
+    }
+  }
+
+  // Create a device with timeline semaphores and the extensions to import memory and semaphores
+  constexpr float queuePriority = 1.0f;
+  VkDeviceQueueCreateInfo deviceQueueCreateInfo{ VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
+  deviceQueueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  deviceQueueCreateInfo.queueCount = 1u;
+  deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+
+  constexpr std::array deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+                                            VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME };
+
+  VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+  };
+  physicalDeviceVulkan12Features.timelineSemaphore = VK_TRUE;
+
+  VkDeviceCreateInfo deviceCreateInfo{ VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+  deviceCreateInfo.pNext = &physicalDeviceVulkan12Features;
+  deviceCreateInfo.queueCreateInfoCount = 1u;
+  deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
+  deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+  deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  if (vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  vkGetDeviceQueue(device, queueFamilyIndex, 0u, &queue);
+  return true;
+}
+
+void ViewerContext::sync() const
+{
+  vkDeviceWaitIdle(device);
+}
+
+bool ViewerContext::isValid() const
+{
+  return valid;
+}
+
+VkInstance ViewerContext::getVkInstance() const
+{
+  return instance;
+}
+
+VkPhysicalDevice ViewerContext::getVkPhysicalDevice() const
+{
+  return physicalDevice;
+}
+
+uint32_t ViewerContext::getVkQueueFamilyIndex() const
+{
+  return queueFamilyIndex;
+}
+
+VkDevice ViewerContext::getVkDevice() const
+{
+  return device;
+}
+
+VkQueue ViewerContext::getVkQueue() const
+{
+  return queue;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "MirrorExport.h"
+
+#include <vulkan/vulkan.h>
+
+/*
+ * The viewer context class handles the initial loading of Vulkan for the viewer process, such as the instance, the
+ * device and its queue. Memory and semaphores can only be shared within the same physical device, so the device is
+ * created on the physical device that the example runs on, which is identified by the UUIDs in the header it sends. A
+ * single queue is used for both the blit and presenting to the window.
+ */
+class ViewerContext final
+{
+public:
+  ViewerContext();
+  ~ViewerContext();
+
+  bool createDevice(const MirrorExport::Header& header, VkSurfaceKHR surface);
+  void sync() const;
+
+  bool isValid() const;
+
+  VkInstance getVkInstance() const;
+  VkPhysicalDevice getVkPhysicalDevice() const;
+  uint32_t getVkQueueFamilyIndex() const;
+  VkDevice getVkDevice() const;
+  VkQueue getVkQueue() const;
+
+private:
+  bool valid = true;
+
+  VkInstance instance = nullptr;
+  VkPhysicalDevice physicalDevice = nullptr;
+  uint32_t queueFamilyIndex = 0u;
+  VkDevice device = nullptr;
+  VkQueue queue = nullptr;
+};
\ No newline at end of file
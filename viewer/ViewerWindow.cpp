@@ -0,0 +1,400 @@
+#include "ViewerWindow.h"
+
+#include "SharedImage.h"
+#include "Util.h"
+#include "ViewerContext.h"
+#include "WindowSwapchain.h"
+
+#include <glfw/glfw3.h>
+
+#include <array>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+constexpr const char* windowTitle = "OpenXR Vulkan Example Viewer";
+
+void framebufferSizeCallback(GLFWwindow* window, int width, int height)
+{
+  ViewerWindow* viewerWindow = reinterpret_cast<ViewerWindow*>(glfwGetWindowUserPointer(window));
+  viewerWindow->onWindowResize();
+}
+
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+  if (action == GLFW_RELEASE && key == GLFW_KEY_ESCAPE)
+  {
+    glfwSetWindowShouldClose(window, 1);
+  }
+}
+} // namespace
+
+ViewerWindow::ViewerWindow(const ViewerContext* context, VkExtent2D resolution) : context(context)
+{
+  // Create a window at the resolution of the shared image
+  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+  window = glfwCreateWindow(static_cast<int>(resolution.width), static_cast<int>(resolution.height), windowTitle,
+                            nullptr, nullptr);
+  if (!window)
+  {
+    std::stringstream s;
+    s << resolution.width << "x" << resolution.height << " windowed";
+    util::error(Error::WindowFailure, s.str());
+    valid = false;
+    return;
+  }
+
+  glfwSetWindowUserPointer(window, this);
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  glfwSetKeyCallback(window, keyCallback);
+
+  // Create a surface for the window
+  if (glfwCreateWindowSurface(context->getVkInstance(), window, nullptr, &surface) != VK_SUCCESS)
+  {
+    util::error(Error::GenericGLFW);
+    valid = false;
+    return;
+  }
+}
+
+ViewerWindow::~ViewerWindow()
+{
+  const VkDevice device = context->getVkDevice();
+  if (device)
+  {
+    if (inFlightFence)
+    {
+      vkDestroyFence(device, inFlightFence, nullptr);
+    }
+
+    if (renderFinishedSemaphore)
+    {
+      vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
+    }
+
+    if (imageAvailableSemaphore)
+    {
+      vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
+    }
+
+    if (commandPool)
+    {
+      vkDestroyCommandPool(device, commandPool, nullptr);
+    }
+  }
+
+  delete swapchain;
+
+  const VkInstance instance = context->getVkInstance();
+  if (instance && surface)
+  {
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+  }
+
+  if (window)
+  {
+    glfwDestroyWindow(window);
+  }
+
+  glfwTerminate();
+}
+
+void ViewerWindow::onWindowResize()
+{
+  resizeDetected = true;
+}
+
+bool ViewerWindow::connect(const SharedImage* sharedImage)
+{
+  this->sharedImage = sharedImage;
+
+  const VkDevice device = context->getVkDevice();
+
+  // Create a command pool and a command buffer for the single frame in flight
+  VkCommandPoolCreateInfo commandPoolCreateInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = context->getVkQueueFamilyIndex();
+  if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1u;
+  if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  // Create the synchronization objects for the single frame in flight
+  VkSemaphoreCreateInfo semaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+  if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
+      vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  VkFenceCreateInfo fenceCreateInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+  fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+  if (vkCreateFence(device, &fenceCreateInfo, nullptr, &inFlightFence) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return false;
+  }
+
+  // The viewer can afford to wait for the vertical blank
+  swapchain = new WindowSwapchain(context->getVkPhysicalDevice(), device, window, surface, true);
+  if (!recreateSwapchain())
+  {
+    return false;
+  }
+
+  return true;
+}
+
+void ViewerWindow::processWindowEvents() const
+{
+  glfwPollEvents();
+}
+
+ViewerWindow::ShowResult ViewerWindow::show(uint64_t value)
+{
+  if (resizeDetected)
+  {
+    resizeDetected = false;
+    if (!recreateSwapchain())
+    {
+      return ShowResult::Error;
+    }
+  }
+
+  // Release the copy right away while the window is minimized
+  const VkExtent2D swapchainResolution = swapchain->getResolution();
+  if (swapchainResolution.width == 0u || swapchainResolution.height == 0u)
+  {
+    return sharedImage->releaseOnHost(value) ? ShowResult::Released : ShowResult::Error;
+  }
+
+  const VkDevice device = context->getVkDevice();
+  if (vkWaitForFences(device, 1u, &inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return ShowResult::Error;
+  }
+
+  uint32_t swapchainImageIndex;
+  const VkResult acquireResult =
+    vkAcquireNextImageKHR(device, swapchain->getSwapchain(), std::numeric_limits<uint64_t>::max(),
+                          imageAvailableSemaphore, VK_NULL_HANDLE, &swapchainImageIndex);
+  if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+  {
+    // Try again with the same copy after recreating the swapchain
+    return recreateSwapchain() ? ShowResult::Retry : ShowResult::Error;
+  }
+  else if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR)
+  {
+    util::error(Error::GenericVulkan);
+    return ShowResult::Error;
+  }
+
+  if (vkResetFences(device, 1u, &inFlightFence) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return ShowResult::Error;
+  }
+
+  const VkImage sourceImage = sharedImage->getImage();
+  const VkImage swapchainImage = swapchain->getImage(swapchainImageIndex);
+  const uint32_t queueFamilyIndex = context->getVkQueueFamilyIndex();
+
+  VkCommandBufferBeginInfo commandBufferBeginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+  commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return ShowResult::Error;
+  }
+
+  VkImageSubresourceRange subresourceRange{};
+  subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  subresourceRange.levelCount = 1u;
+  subresourceRange.layerCount = 1u;
+
+  // Take the shared image over from the example, it is left in the transfer source optimal layout, and transition the
+  // swapchain image to the transfer destination optimal layout
+  {
+    std::array<VkImageMemoryBarrier, 2u> imageMemoryBarriers;
+
+    VkImageMemoryBarrier& sourceImageMemoryBarrier = imageMemoryBarriers.at(0u);
+    sourceImageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    sourceImageMemoryBarrier.image = sourceImage;
+    sourceImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sourceImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sourceImageMemoryBarrier.srcAccessMask = VK_ACCESS_NONE;
+    sourceImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    sourceImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL;
+    sourceImageMemoryBarrier.dstQueueFamilyIndex = queueFamilyIndex;
+    sourceImageMemoryBarrier.subresourceRange = subresourceRange;
+
+    VkImageMemoryBarrier& destinationImageMemoryBarrier = imageMemoryBarriers.at(1u);
+    destinationImageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    destinationImageMemoryBarrier.image = swapchainImage;
+    destinationImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    destinationImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    destinationImageMemoryBarrier.srcAccessMask = VK_ACCESS_NONE;
+    destinationImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    destinationImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    destinationImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    destinationImageMemoryBarrier.subresourceRange = subresourceRange;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0u, 0u,
+                         nullptr, 0u, nullptr, static_cast<uint32_t>(imageMemoryBarriers.size()),
+                         imageMemoryBarriers.data());
+  }
+
+  // Crop the shared image to preserve the aspect ratio of the window
+  const VkExtent2D sourceExtent = sharedImage->getResolution();
+  const float sourceWidth = static_cast<float>(sourceExtent.width);
+  const float sourceHeight = static_cast<float>(sourceExtent.height);
+  const float sourceAspectRatio = sourceWidth / sourceHeight;
+  const float destinationAspectRatio =
+    static_cast<float>(swapchainResolution.width) / static_cast<float>(swapchainResolution.height);
+  float cropWidth = sourceWidth, cropHeight = sourceHeight;
+  if (sourceAspectRatio < destinationAspectRatio)
+  {
+    cropHeight = sourceWidth / destinationAspectRatio;
+  }
+  else if (sourceAspectRatio > destinationAspectRatio)
+  {
+    cropWidth = sourceHeight * destinationAspectRatio;
+  }
+  const float cropOffsetX = (sourceWidth - cropWidth) / 2.0f, cropOffsetY = (sourceHeight - cropHeight) / 2.0f;
+
+  // Blit the shared image to the swapchain image
+  VkImageBlit imageBlit{};
+  imageBlit.srcOffsets[0] = { static_cast<int32_t>(cropOffsetX), static_cast<int32_t>(cropOffsetY), 0 };
+  imageBlit.srcOffsets[1] = { static_cast<int32_t>(cropOffsetX + cropWidth),
+                              static_cast<int32_t>(cropOffsetY + cropHeight), 1 };
+  imageBlit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0u, 0u, 1u };
+  imageBlit.dstOffsets[0] = { 0, 0, 0 };
+  imageBlit.dstOffsets[1] = { static_cast<int32_t>(swapchainResolution.width),
+                              static_cast<int32_t>(swapchainResolution.height), 1 };
+  imageBlit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0u, 0u, 1u };
+  vkCmdBlitImage(commandBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchainImage,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1u, &imageBlit, VK_FILTER_LINEAR);
+
+  // Hand the shared image back to the example and transition the swapchain image for presentation
+  {
+    std::array<VkImageMemoryBarrier, 2u> imageMemoryBarriers;
+
+    VkImageMemoryBarrier& sourceImageMemoryBarrier = imageMemoryBarriers.at(0u);
+    sourceImageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    sourceImageMemoryBarrier.image = sourceImage;
+    sourceImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sourceImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sourceImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    sourceImageMemoryBarrier.dstAccessMask = VK_ACCESS_NONE;
+    sourceImageMemoryBarrier.srcQueueFamilyIndex = queueFamilyIndex;
+    sourceImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL;
+    sourceImageMemoryBarrier.subresourceRange = subresourceRange;
+
+    VkImageMemoryBarrier& destinationImageMemoryBarrier = imageMemoryBarriers.at(1u);
+    destinationImageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    destinationImageMemoryBarrier.image = swapchainImage;
+    destinationImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    destinationImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    destinationImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    destinationImageMemoryBarrier.dstAccessMask = VK_ACCESS_NONE;
+    destinationImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    destinationImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    destinationImageMemoryBarrier.subresourceRange = subresourceRange;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0u, 0u,
+                         nullptr, 0u, nullptr, static_cast<uint32_t>(imageMemoryBarriers.size()),
+                         imageMemoryBarriers.data());
+  }
+
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return ShowResult::Error;
+  }
+
+  // Wait for the copy to be written and the swapchain image to be available, then release the copy to the example
+  const std::array waitSemaphores = { sharedImage->getWrittenSemaphore(), imageAvailableSemaphore };
+  const std::array<uint64_t, 2u> waitValues = { value, 0u }; // Binary semaphores ignore the value
+  const std::array<VkPipelineStageFlags, 2u> waitStages = { VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                            VK_PIPELINE_STAGE_TRANSFER_BIT };
+  const std::array signalSemaphores = { sharedImage->getReleasedSemaphore(), renderFinishedSemaphore };
+  const std::array<uint64_t, 2u> signalValues = { value, 0u };
+
+  VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{ VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+  timelineSemaphoreSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+  timelineSemaphoreSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+  timelineSemaphoreSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+  timelineSemaphoreSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+  VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+  submitInfo.pNext = &timelineSemaphoreSubmitInfo;
+  submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+  submitInfo.pWaitSemaphores = waitSemaphores.data();
+  submitInfo.pWaitDstStageMask = waitStages.data();
+  submitInfo.commandBufferCount = 1u;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+  submitInfo.pSignalSemaphores = signalSemaphores.data();
+  if (vkQueueSubmit(context->getVkQueue(), 1u, &submitInfo, inFlightFence) != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return ShowResult::Error;
+  }
+
+  // Present the swapchain image, an out of date swapchain is recreated before the next copy is shown
+  const VkSwapchainKHR presentSwapchain = swapchain->getSwapchain();
+
+  VkPresentInfoKHR presentInfo{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+  presentInfo.waitSemaphoreCount = 1u;
+  presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
+  presentInfo.swapchainCount = 1u;
+  presentInfo.pSwapchains = &presentSwapchain;
+  presentInfo.pImageIndices = &swapchainImageIndex;
+  const VkResult presentResult = vkQueuePresentKHR(context->getVkQueue(), &presentInfo);
+  if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR)
+  {
+    resizeDetected = true;
+  }
+  else if (presentResult != VK_SUCCESS)
+  {
+    util::error(Error::GenericVulkan);
+    return ShowResult::Error;
+  }
+
+  return ShowResult::Released;
+}
+
+bool ViewerWindow::isValid() const
+{
+  return valid;
+}
+
+bool ViewerWindow::isExitRequested() const
+{
+  return static_cast<bool>(glfwWindowShouldClose(window));
+}
+
+VkSurfaceKHR ViewerWindow::getSurface() const
+{
+  return surface;
+}
+
+bool ViewerWindow::recreateSwapchain()
+{
+  context->sync();
+  return swapchain->recreate();
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+struct GLFWwindow;
+class SharedImage;
+class ViewerContext;
+class WindowSwapchain;
+
+/*
+ * The viewer window class handles the desktop window of the viewer process, which shows the copies of the shared image
+ * cropped to the aspect ratio of the window. Unlike the mirror view it can afford to wait for the vertical blank and
+ * for a swapchain image, as all window system work happens in this process and never holds up the headset. There is a
+ * single frame in flight, which releases the copy it shows back to the example once the blit has finished.
+ */
+class ViewerWindow final
+{
+public:
+  ViewerWindow(const ViewerContext* context, VkExtent2D resolution);
+  ~ViewerWindow();
+
+  void onWindowResize();
+
+  bool connect(const SharedImage* sharedImage);
+  void processWindowEvents() const;
+
+  enum class ShowResult
+  {
+    Error,    // An error occurred
+    Released, // The copy was shown, or released right away if the window is minimized
+    Retry     // The swapchain was out of date and has been recreated, show the same copy again
+  };
+  ShowResult show(uint64_t value); // Of the written semaphore for the copy to show
+
+  bool isValid() const;
+  bool isExitRequested() const;
+  VkSurfaceKHR getSurface() const;
+
+private:
+  bool valid = true;
+
+  const ViewerContext* context = nullptr;
+  const SharedImage* sharedImage = nullptr;
+
+  GLFWwindow* window = nullptr;
+
+  VkSurfaceKHR surface = nullptr;
+  WindowSwapchain* swapchain = nullptr;
+  bool resizeDetected = false;
+
+  VkCommandPool commandPool = nullptr;
+  VkCommandBuffer commandBuffer = nullptr;
+  VkSemaphore imageAvailableSemaphore = nullptr, renderFinishedSemaphore = nullptr;
+  VkFence inFlightFence = nullptr;
+
+  bool recreateSwapchain();
+};
\ No newline at end of file